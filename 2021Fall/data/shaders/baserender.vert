@@ -2,9 +2,10 @@
 
 #include "common.glsl"
 #include "object.glsl"
+#include "vertexformat.glsl"
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
+layout(location = 1) in vec2 inNormal;
 
 layout(location = 2) in vec3 offset;
 
@@ -13,13 +14,21 @@ layout(location = 1) out vec3 fragNormal;
 
 layout(location = 2) out vec3 offsetout;
 
+layout(location = 3) out vec4 currentClip;
+layout(location = 4) out vec4 previousClip;
+
 void main()
 {
-	vec3 tempPos = (obj.objectMat * vec4(inPosition, 1.0)).xyz + offset;
+	vec3 position = DecodePosition(inPosition);
+	vec3 tempPos = (obj.objectMat * vec4(position, 1.0)).xyz + offset;
 	fragPosition = (cam.worldToCamera * vec4(tempPos, 1.0)).xyz;
 	gl_Position = cam.cameraToNDC * vec4(fragPosition, 1.0);
 
 	offsetout = offset;
 
-	fragNormal = normalize(mat3(transpose(inverse(cam.worldToCamera * obj.objectMat))) * inNormal);
+	currentClip = cam.worldToNDC * vec4(tempPos, 1.0);
+	previousClip = cam.previousWorldToNDC * vec4((obj.previousObjectMat * vec4(position, 1.0)).xyz + offset, 1.0);
+
+	//the view has no scale, its own 3x3 transforms normals
+	fragNormal = normalize(mat3(cam.worldToCamera) * (mat3(obj.normalMat) * DecodeNormal(inNormal)));
 }
\ No newline at end of file
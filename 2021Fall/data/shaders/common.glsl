@@ -1,8 +1,16 @@
 #define PI 3.141592
 #define MAX_LIGHT 8
 
-layout(binding = 0) uniform Camera {
+layout(set = 0, binding = 0) uniform Camera {
 	mat4 worldToCamera;
 	mat4 cameraToNDC;
+
+	//unjittered
+	mat4 worldToNDC;
+	mat4 previousWorldToNDC;
+
+	//inverses of worldToCamera and the jittered cameraToNDC
+	mat4 cameraToWorld;
+	mat4 NDCToCamera;
 } cam;
 
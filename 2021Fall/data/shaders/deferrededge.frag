@@ -0,0 +1,34 @@
+#version 450
+
+#include "deferredmsaa.glsl"
+
+layout(location = 0) in vec2 fragTexCoord;
+
+//relative view depth difference between samples that still counts as one surface
+const float EDGE_DEPTH_THRESHOLD = 0.01;
+//cosine between sample normals
+const float EDGE_NORMAL_THRESHOLD = 0.95;
+const float EDGE_ALBEDO_THRESHOLD = 0.1;
+
+//only writes stencil, the fragment survives when the samples of the pixel do not belong to one surface
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+
+	float depth = texelFetch(texDepth, texel, 0).r;
+	vec3 normal = decodeNormal(texelFetch(texNormal, texel, 0).rg);
+	vec4 albedo = texelFetch(texAlbedo, texel, 0);
+
+	for(int i = 1; i < textureSamples(texDepth); ++i)
+	{
+		float sampleDepth = texelFetch(texDepth, texel, i).r;
+		vec3 sampleNormal = decodeNormal(texelFetch(texNormal, texel, i).rg);
+		vec4 sampleAlbedo = texelFetch(texAlbedo, texel, i);
+
+		if(abs(sampleDepth - depth) > EDGE_DEPTH_THRESHOLD * max(sampleDepth, depth)) return;
+		if(dot(sampleNormal, normal) < EDGE_NORMAL_THRESHOLD) return;
+		if(any(greaterThan(abs(sampleAlbedo - albedo), vec4(EDGE_ALBEDO_THRESHOLD)))) return;
+	}
+
+	discard;
+}
\ No newline at end of file
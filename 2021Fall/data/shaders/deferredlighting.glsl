@@ -0,0 +1,51 @@
+//lighting of one resolved gbuffer texel, shared by deferred.frag and deferredsubpass.frag
+#include "settings.glsl"
+#include "lightingvariant.glsl"
+#include "light.glsl"
+#include "gbuffer.glsl"
+
+vec4 shadeGBuffer(vec2 uv, float depth, vec4 normaltex, vec4 albedotex)
+{
+	vec3 pos = reconstructPosition(uv, depth, cam.cameraToNDC);
+	vec3 norm = decodeNormal(normaltex.rg);
+	float roughness = normaltex.b;
+	vec3 albedo = albedotex.rgb;
+	float metal = albedotex.a;
+
+	if(deferredType() == 0)	
+	{
+		return (depth > 0.0) ? vec4(pos, metal) : vec4(0.0);
+	}
+	else if(deferredType() == 1) 
+	{
+		return (depth > 0.0) ? vec4(norm, roughness) : vec4(0.0);
+	}
+	else if(deferredType() == 2)
+	{
+		return vec4(albedo, 1.0);
+	}
+
+	albedo = pow(albedo, vec3(2.2));
+
+	//cleared to 0, nothing was drawn here, same as the clear color so per sample averages stay correct
+	if(depth <= 0.0)
+	{
+		return vec4(0.0, 0.0, 0.0, 1.0);
+	}
+
+	vec3 color;
+
+	if(computationType() == 0)
+	{
+		color = ComputePBR(pos, norm, metal, roughness, albedo);
+	}
+	else
+	{
+		color = computeLight(pos, norm);
+	}
+
+	color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0/2.2));  
+
+	return vec4(color, 1.0);
+}
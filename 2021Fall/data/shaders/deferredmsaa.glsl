@@ -0,0 +1,11 @@
+//msaa gbuffer read per sample, shared by the edge lighting programs
+#include "deferredlighting.glsl"
+
+layout (set = 1, binding = 0) uniform sampler2DMS texDepth;
+layout (set = 1, binding = 1) uniform sampler2DMS texNormal;
+layout (set = 1, binding = 2) uniform sampler2DMS texAlbedo;
+
+vec4 shadeSample(ivec2 texel, vec2 uv, int index)
+{
+	return shadeGBuffer(uv, texelFetch(texDepth, texel, index).r, texelFetch(texNormal, texel, index), texelFetch(texAlbedo, texel, index));
+}
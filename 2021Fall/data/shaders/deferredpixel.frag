@@ -0,0 +1,13 @@
+#version 450
+
+#include "deferredmsaa.glsl"
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+//every sample is on the same surface, one of them is enough
+void main()
+{
+	outColor = shadeSample(ivec2(gl_FragCoord.xy), fragTexCoord, 0);
+}
\ No newline at end of file
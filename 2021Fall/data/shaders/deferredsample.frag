@@ -0,0 +1,28 @@
+#version 450
+
+#include "deferredmsaa.glsl"
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+//edge pixel, light every sample and resolve the lit result
+void main()
+{
+	if(deferredType() == 4)
+	{
+		outColor = vec4(1.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	int count = textureSamples(texDepth);
+
+	vec4 color = vec4(0.0);
+	for(int i = 0; i < count; ++i)
+	{
+		color += shadeSample(texel, fragTexCoord, i);
+	}
+
+	outColor = color / float(count);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 450
+
+#include "deferredlighting.glsl"
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+//written by the gbuffer subpass of the same renderpass, only this pixel can be read
+layout (input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inDepth;
+layout (input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput inNormal;
+layout (input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inAlbedo;
+
+void main()
+{
+	outColor = shadeGBuffer(fragTexCoord, subpassLoad(inDepth).r, subpassLoad(inNormal), subpassLoad(inAlbedo));
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+//per draw values pushed while the command buffer is recorded, DrawPushConstants in Descriptor.hpp
+layout(push_constant) uniform DrawConstants {
+	//bounds of the mesh its packed positions are relative to, see vertexformat.glsl
+	vec3 positionOffset;
+	//element of the object storage buffer, see object.glsl
+	uint objectIndex;
+	vec3 positionScale;
+	//light the shadow pass renders
+	uint lightIndex;
+} draw;
\ No newline at end of file
@@ -0,0 +1,39 @@
+//compact gbuffer, written by every program of the gbuffer pass and read by deferred.frag
+//location 0 : R32_SFLOAT view space depth, 0 where nothing was drawn
+//location 1 : A2B10G10R10 octahedral view space normal, roughness
+//location 2 : R8G8B8A8 albedo, metal
+//location 3 : R16G16 uv from the last frame to this one, only bound with taa
+
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//unit vector -> 0~1 on the octahedron folded onto a square
+vec2 encodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 oct = (n.z >= 0.0) ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return oct * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 encoded)
+{
+	vec2 oct = encoded * 2.0 - 1.0;
+	vec3 n = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+	if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return normalize(n);
+}
+
+//uv offset of the same surface point between the frames, both clip positions without jitter
+vec2 screenVelocity(vec4 currentClip, vec4 previousClip)
+{
+	return (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
+}
+
+//cameraToNDC is a perspective with an optional subpixel jitter, scale and jitter terms are enough to undo it
+vec3 reconstructPosition(vec2 uv, float viewDepth, mat4 cameraToNDC)
+{
+	vec2 ndc = uv * 2.0 - 1.0 - vec2(cameraToNDC[2][0], cameraToNDC[2][1]);
+	return vec3(ndc.x * viewDepth / cameraToNDC[0][0], ndc.y * viewDepth / cameraToNDC[1][1], viewDepth);
+}
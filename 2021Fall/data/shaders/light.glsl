@@ -19,12 +19,20 @@ struct lightData {
 	int type;
 };
 
-layout(binding = 2) uniform lights {
+layout(set = 0, binding = 2) uniform lights {
 	lightData lightsources[MAX_LIGHT];
 	int lightNum;
 };
 
-layout (binding = 6) uniform samplerCube depthCubemap[MAX_LIGHT];
+layout (set = 1, binding = 3) uniform samplerCube depthCubemap[MAX_LIGHT];
+//same cubemaps with a compare sampler
+layout (set = 1, binding = 4) uniform samplerCubeShadow shadowCubemap[MAX_LIGHT];
+//blurred and mipmapped moments, only written with Settings::shadowMoments
+layout (set = 1, binding = 5) uniform samplerCube momentCubemap[MAX_LIGHT];
+
+#include "shadowmoment.glsl"
+
+#define MAX_SHADOW_TAPS 32
 
 const vec3 sampleOffsetDirections[20] = vec3[]
 (
@@ -37,26 +45,123 @@ const vec3 sampleOffsetDirections[20] = vec3[]
 
 const int samples = 20;
 
-float computeShadow(vec3 view, float offset, int lightindex)
+//unit disk, ordered so that any prefix is still spread over the disk
+const vec2 poissonDisk[MAX_SHADOW_TAPS] = vec2[]
+(
+	vec2(-0.613392, 0.617481), vec2(0.170019, -0.040254), vec2(-0.299417, 0.791925), vec2(0.645680, 0.493210),
+	vec2(-0.651784, 0.717887), vec2(0.421003, 0.027070), vec2(-0.817194, -0.271096), vec2(-0.705374, -0.668203),
+	vec2(0.977050, -0.108615), vec2(0.063326, 0.142369), vec2(0.203528, 0.214331), vec2(-0.667531, 0.326090),
+	vec2(-0.098422, -0.295755), vec2(-0.885922, 0.215369), vec2(0.566637, 0.605213), vec2(0.039766, -0.396100),
+	vec2(0.751946, 0.453352), vec2(0.078707, -0.715323), vec2(-0.075838, -0.529344), vec2(0.724479, -0.580798),
+	vec2(0.222999, -0.215125), vec2(-0.467574, -0.405438), vec2(-0.248268, -0.814753), vec2(0.354411, -0.887570),
+	vec2(0.175817, 0.382366), vec2(0.487472, -0.063082), vec2(-0.084078, 0.898312), vec2(0.488876, -0.783441),
+	vec2(0.470016, 0.217933), vec2(-0.696890, -0.549791), vec2(-0.149693, 0.605762), vec2(0.034211, 0.979980)
+);
+
+//distance along the cube face axis of dir -> depth written by the shadow projection
+float shadowDepth(vec3 fragToLight, vec3 dir)
 {
-	vec3 fragToLight = view - lightsources[lightindex].position;
-	
-	float currentDepth = length(fragToLight);
+	vec3 axis = abs(dir);
+	vec3 distance = abs(fragToLight);
+	float z = (axis.x > axis.y && axis.x > axis.z) ? distance.x : ((axis.y > axis.z) ? distance.y : distance.z);
+
+	z = max(z - setting.shadowbias, SHADOW_NEAR_PLANE);
 
-	fragToLight = inverse(mat3(transpose(inverse(cam.worldToCamera)))) * fragToLight;
+	float far = setting.shadowfar_plane;
+	return far / (far - SHADOW_NEAR_PLANE) * (1.0 - SHADOW_NEAR_PLANE / z);
+}
 
+float computeShadowManual(vec3 fragToLight, float offset, int lightindex)
+{
 	float shadow = 0.0;
 
 	for(int j = 0; j < samples; ++j)
 	{
-		float closestDepth = texture(depthCubemap[lightindex], fragToLight + sampleOffsetDirections[j] * offset).r;
+		vec3 dir = fragToLight + sampleOffsetDirections[j] * offset;
+		float closestDepth = texture(depthCubemap[lightindex], dir).r;
+
+		shadow += shadowDepth(fragToLight, dir) > closestDepth ? 1.0 : 0.0;
+	}
+
+	return shadow / float(samples);
+}
+
+float computeShadowCompare(vec3 fragToLight, float offset, int lightindex)
+{
+	//disk perpendicular to the lookup, rotated per pixel so the taps turn into noise instead of banding
+	vec3 dir = normalize(fragToLight);
+	vec3 up = abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, dir));
+	vec3 bitangent = cross(dir, tangent);
+
+	//interleaved gradient noise
+	float angle = 2.0 * PI * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+	int taps = clamp(setting.shadowTaps, 1, MAX_SHADOW_TAPS);
+	float lit = 0.0;
+
+	for(int j = 0; j < taps; ++j)
+	{
+		vec2 disk = rotation * poissonDisk[j] * offset;
+		vec3 tapdir = fragToLight + tangent * disk.x + bitangent * disk.y;
+
+		lit += texture(shadowCubemap[lightindex], vec4(tapdir, shadowDepth(fragToLight, tapdir)));
+	}
+
+	return 1.0 - lit / float(taps);
+}
+
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance)
+{
+	if(depth <= moments.x) return 1.0;
+
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float distance = depth - moments.x;
+	float pmax = variance / (variance + distance * distance);
+
+	//the tail of the bound is what bleeds through where occluders overlap
+	return clamp((pmax - setting.momentBleedReduction) / (1.0 - setting.momentBleedReduction), 0.0, 1.0);
+}
+
+//one trilinear lookup, the filtering was done by the blur and the mips
+float computeShadowMoments(vec3 fragToLight, int lightindex)
+{
+	//the cube stores the distance along the face axis, for the receiver that is its major axis
+	vec3 distance = abs(fragToLight);
+	float depth = max(max(distance.x, distance.y), distance.z) / setting.shadowfar_plane;
+
+	vec4 moments = texture(momentCubemap[lightindex], fragToLight);
+
+	float lit;
+	if(momentType() == 0)
+	{
+		lit = chebyshevUpperBound(moments.xy, depth, setting.momentMinVariance);
+	}
+	else
+	{
+		vec4 warped = computeMoments(depth, 1);
+
+		//variance floor follows the slope of each warp
+		vec2 depthScale = setting.momentMinVariance * evsmExponents() * vec2(warped.x, -warped.z);
+		vec2 minVariance = depthScale * depthScale;
 
-		closestDepth *= setting.shadowfar_plane;
-				
-		shadow += (currentDepth -  setting.shadowbias) > closestDepth ? 1.0 : 0.0;
+		lit = min(chebyshevUpperBound(moments.xy, warped.x, minVariance.x), chebyshevUpperBound(moments.zw, warped.z, minVariance.y));
 	}
 
-	return shadow / float(samples);	
+	return 1.0 - lit;
+}
+
+float computeShadow(vec3 view, float offset, int lightindex)
+{
+	vec3 fragToLight = view - lightsources[lightindex].position;
+
+	fragToLight = mat3(cam.cameraToWorld) * fragToLight;
+
+	if(shadowFilter() == 1) return computeShadowCompare(fragToLight, offset, lightindex);
+	if(shadowFilter() == 2) return computeShadowMoments(fragToLight, lightindex);
+
+	return computeShadowManual(fragToLight, offset, lightindex);
 }
 
 vec3 computePointLight(vec3 surfacePos, vec3 normal, vec3 lightPos, lightData lightsource)
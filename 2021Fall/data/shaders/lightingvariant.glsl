@@ -0,0 +1,26 @@
+//specialized per lighting pipeline by Graphic::GetLightingConstants, settings.glsl has to be included first
+//-1 is left when Settings::shaderVariants is off and reads the runtime setting instead
+layout(constant_id = 0) const int DEFERRED_TYPE = -1;
+layout(constant_id = 1) const int COMPUTATION_TYPE = -1;
+layout(constant_id = 2) const int SHADOW_FILTER = -1;
+layout(constant_id = 3) const int MOMENT_TYPE = -1;
+
+int deferredType()
+{
+	return (DEFERRED_TYPE >= 0) ? DEFERRED_TYPE : setting.deferredType;
+}
+
+int computationType()
+{
+	return (COMPUTATION_TYPE >= 0) ? COMPUTATION_TYPE : setting.computationType;
+}
+
+int shadowFilter()
+{
+	return (SHADOW_FILTER >= 0) ? SHADOW_FILTER : setting.shadowFilter;
+}
+
+int momentType()
+{
+	return (MOMENT_TYPE >= 0) ? MOMENT_TYPE : setting.momentType;
+}
\ No newline at end of file
@@ -1,7 +1,23 @@
-layout(binding = 1) uniform object {
+#include "drawconstants.glsl"
+
+//one element per object at OBJECT_UNIFORM_STRIDE
+struct ObjectData {
 	mat4 objectMat;
 
 	vec3 color;
-	float roughness;
 	float metal;
-} obj;
+	float roughness;
+
+	mat4 previousObjectMat;
+	//inverse transpose of objectMat, only the 3x3 is used
+	mat4 normalMat;
+
+	vec4 padding[2];
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer object {
+	ObjectData objects[];
+};
+
+//the object of the current draw, selected by push constant instead of a dynamic offset
+#define obj objects[draw.objectIndex]
\ No newline at end of file
@@ -1,8 +1,18 @@
-layout(binding = 1) uniform GUI {
+layout(set = 0, binding = 1) uniform GUI {
 	int deferredType;
 	int computationType;
 
 	float shadowbias;
 	float shadowfar_plane;
 	float shaodwdiskRadius;
+	int shadowFilter;
+	int shadowTaps;
+	int momentType;
+	int momentBlurRadius;
+	float momentBleedReduction;
+	float momentMinVariance;
+	float evsmPositiveExponent;
+	float evsmNegativeExponent;
+
+	float taaFeedback;
 } setting;
\ No newline at end of file
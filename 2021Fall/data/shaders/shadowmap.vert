@@ -2,6 +2,7 @@
 
 #include "common.glsl"
 #include "object.glsl"
+#include "vertexformat.glsl"
 
 layout(location = 0) in vec3 inPosition;
 
@@ -9,5 +10,5 @@ layout(location = 2) in vec3 offset;
 
 void main()
 {
-	gl_Position = vec4((obj.objectMat * vec4(inPosition, 1.0)).xyz + offset, 1.0);
+	gl_Position = vec4((obj.objectMat * vec4(DecodePosition(inPosition), 1.0)).xyz + offset, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+//moments shared by the moment compute passes and light.glsl, settings.glsl has to be included first
+
+//near plane of the shadow projection in PointLight::update, far plane is setting.shadowfar_plane
+#define SHADOW_NEAR_PLANE 0.1
+//rgba16f moments overflow above it
+#define EVSM_MAX_EXPONENT 5.54
+#define MAX_MOMENT_BLUR_RADIUS 8
+
+//hardware depth of the shadow projection -> distance along the cube face axis in 0~1 of the far plane
+float linearShadowDepth(float depth)
+{
+	float far = setting.shadowfar_plane;
+	return SHADOW_NEAR_PLANE / (far - depth * (far - SHADOW_NEAR_PLANE));
+}
+
+vec2 evsmExponents()
+{
+	return clamp(vec2(setting.evsmPositiveExponent, setting.evsmNegativeExponent), vec2(0.0), vec2(EVSM_MAX_EXPONENT));
+}
+
+//vsm keeps depth and depth^2, evsm the same of a positive and a negative exponential warp
+vec4 computeMoments(float depth, int type)
+{
+	if(type == 0) return vec4(depth, depth * depth, 0.0, 0.0);
+
+	vec2 exponents = evsmExponents();
+	//-1~1 so both warps use the whole range
+	depth = 2.0 * depth - 1.0;
+	float positive = exp(exponents.x * depth);
+	float negative = -exp(-exponents.y * depth);
+
+	return vec4(positive, positive * positive, negative, negative * negative);
+}
+
+int momentBlurRadius()
+{
+	return clamp(setting.momentBlurRadius, 0, MAX_MOMENT_BLUR_RADIUS);
+}
+
+//gaussian reaching 2 sigma at the radius
+float momentBlurWeight(int offset, int radius)
+{
+	float sigma = max(float(radius) * 0.5, 0.5);
+	return exp(-float(offset * offset) / (2.0 * sigma * sigma));
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#version 450
+
+#include "settings.glsl"
+
+layout(set = 1, binding = 0) uniform sampler2D sceneColor;
+layout(set = 1, binding = 1) uniform sampler2D history;
+layout(set = 1, binding = 2) uniform sampler2D velocity;
+layout(set = 1, binding = 3) uniform sampler2D viewDepth;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outHistory;
+
+void main()
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(sceneColor, 0));
+
+	vec3 current = texture(sceneColor, fragTexCoord).rgb;
+	vec3 neighborMin = current;
+	vec3 neighborMax = current;
+
+	//motion of the closest surface around the pixel, so edges are not reprojected with the background motion
+	float closestDepth = 1e30;
+	vec2 closestOffset = vec2(0.0);
+
+	for(int y = -1; y <= 1; ++y)
+	{
+		for(int x = -1; x <= 1; ++x)
+		{
+			vec2 offset = vec2(x, y) * texelSize;
+
+			vec3 neighbor = texture(sceneColor, fragTexCoord + offset).rgb;
+			neighborMin = min(neighborMin, neighbor);
+			neighborMax = max(neighborMax, neighbor);
+
+			//0 where nothing was drawn
+			float depth = texture(viewDepth, fragTexCoord + offset).r;
+			if(depth > 0.0 && depth < closestDepth)
+			{
+				closestDepth = depth;
+				closestOffset = offset;
+			}
+		}
+	}
+
+	vec2 previousUV = fragTexCoord - texture(velocity, fragTexCoord + closestOffset).rg;
+
+	float feedback = setting.taaFeedback;
+	if(any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0)))) feedback = 0.0;
+
+	//history outside the neighborhood belongs to a surface that is not visible anymore
+	vec3 result = current;
+	if(feedback > 0.0)
+	{
+		vec3 previous = clamp(texture(history, previousUV).rgb, neighborMin, neighborMax);
+		result = mix(current, previous, feedback);
+	}
+
+	outColor = vec4(result, 1.0);
+	outHistory = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+//PackedPosition and PackedNormal in VertexInfo.hpp, the mesh bounds come from drawconstants.glsl
+
+//unorm16 position relative to the mesh bounds back to object space
+vec3 DecodePosition(vec3 packedPosition)
+{
+	return draw.positionOffset + packedPosition * draw.positionScale;
+}
+
+//octahedral snorm16, the lower half is folded over the diagonals
+vec3 DecodeNormal(vec2 packedNormal)
+{
+	vec3 normal = vec3(packedNormal, 1.0 - abs(packedNormal.x) - abs(packedNormal.y));
+	float fold = max(-normal.z, 0.0);
+	normal.x += (normal.x >= 0.0) ? -fold : fold;
+	normal.y += (normal.y >= 0.0) ? -fold : fold;
+
+	return normalize(normal);
+}
\ No newline at end of file
@@ -2,11 +2,14 @@
 #include <iostream>
 
 #include "Engine/Common/Application.hpp"
+#include "Engine/Common/Benchmark.hpp"
 #include "Engine/Graphic/Graphic.hpp"
 #include "Engine/Level/LevelManager.hpp"
 #include "Engine/Input/Input.hpp"
+#include "Engine/Misc/settings.hpp"
 
 //for memory debug
+#ifdef _MSC_VER
 #define _CRTDBG_MAP_ALLOC
 #include <stdlib.h>
 #include <crtdbg.h>
@@ -15,11 +18,19 @@
 #define new new(_NORMAL_BLOCK, __FILE__, __LINE__)
 
 #include <crtdbg.h>
+#endif
 
-int main() 
+int main(int argc, char** argv) 
 {
+#ifdef _MSC_VER
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
     //_CrtSetBreakAlloc(1353837);
+#endif
+
+    if (!Settings::ParseCommandLine(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
 
     Application* app = Application::APP();
 
@@ -27,6 +38,11 @@ int main()
         app->init();
 
         app->AddSystem<Input>();
+        //places the camera before the level updates
+        if (Settings::benchmark || !Settings::recordInputFile.empty() || !Settings::replayInputFile.empty())
+        {
+            app->AddSystem<Benchmark>();
+        }
         app->AddSystem<LevelManager>();
         app->AddSystem<Graphic>();
 
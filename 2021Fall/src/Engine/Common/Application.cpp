@@ -15,7 +15,12 @@
 #include "Application.hpp"
 #include "Engine/Misc/settings.hpp"
 #include "System.hpp"
-#include "Engine/Misc/helper.hpp"
+#include "Engine/Misc/ThreadPool.hpp"
+#include "FrameClock.hpp"
+
+//callback function
+static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+static void guiWindowResizeCallback(GLFWwindow* window, int width, int height);
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -25,6 +30,14 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+//headless mode never creates a swapchain
+static const std::vector<const char*>& GetDeviceExtensions()
+{
+    static const std::vector<const char*> headlessExtensions;
+
+    return Settings::headless ? headlessExtensions : deviceExtensions;
+}
+
 #ifdef NDEBUG
     const bool enableValidationLayers = false;
 #else
@@ -39,6 +52,16 @@ Application::Application() {}
 
 void Application::init()
 {
+    threadPool = new ThreadPool();
+    frameClock = new FrameClock();
+
+    if (Settings::headless)
+    {
+        initVulkan();
+
+        return;
+    }
+
     //initialize glfw
     if (!glfwInit())
     {
@@ -90,20 +113,15 @@ void Application::postinit()
 
 void Application::update(float /*dt*/)
 {
-    while (!glfwWindowShouldClose(window) && !glfwWindowShouldClose(guiWindow) && !shouldshutdown)
+    if (Settings::headless)
     {
-        static uint32_t frameCount = 0;
-        float timestamp = Helper::GetDeltaTime(false);
-        ++frameCount;
-
-        if (timestamp > 1000.0f)
-        {
-            timestamp = Helper::GetDeltaTime(true);
-
-            lastFPS = static_cast<uint32_t>((float)frameCount * (1000.0f / timestamp));
+        updateHeadless();
+        return;
+    }
 
-            frameCount = 0;
-        }
+    while (!glfwWindowShouldClose(window) && !glfwWindowShouldClose(guiWindow) && !shouldshutdown)
+    {
+        frameClock->BeginFrame();
 
         //main window
         {
@@ -111,9 +129,17 @@ void Application::update(float /*dt*/)
 
             glfwPollEvents();
 
+            while (frameClock->StepFixed())
+            {
+                for (auto sys : engineSystems)
+                {
+                    sys->fixedupdate(frameClock->GetFixedDeltaTime());
+                }
+            }
+
             for (auto sys : engineSystems)
             {
-                sys->update(0.016f); //should be changed
+                sys->update(frameClock->GetDeltaTime());
             }
         }
 
@@ -132,6 +158,34 @@ void Application::update(float /*dt*/)
 
             RenderGui();
         }
+
+        bool focused = glfwGetWindowAttrib(window, GLFW_FOCUSED) || glfwGetWindowAttrib(guiWindow, GLFW_FOCUSED);
+        frameClock->EndFrame(Settings::idleWhenUnfocused && !focused);
+    }
+
+    vkDeviceWaitIdle(vulkanDevice);
+}
+
+void Application::updateHeadless()
+{
+    while (frameClock->GetFrameCount() < Settings::headlessFrameCount && !shouldshutdown)
+    {
+        frameClock->BeginFrame();
+
+        while (frameClock->StepFixed())
+        {
+            for (auto sys : engineSystems)
+            {
+                sys->fixedupdate(frameClock->GetFixedDeltaTime());
+            }
+        }
+
+        for (auto sys : engineSystems)
+        {
+            sys->update(frameClock->GetDeltaTime());
+        }
+
+        frameClock->EndFrame(false);
     }
 
     vkDeviceWaitIdle(vulkanDevice);
@@ -145,6 +199,17 @@ void Application::close()
         delete sys;
     }
 
+    delete threadPool;
+    delete frameClock;
+
+    if (Settings::headless)
+    {
+        closeVulkan();
+
+        delete applicationPtr;
+        return;
+    }
+
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -183,7 +248,10 @@ void Application::initVulkan()
     setVulkandebug();
 
     //surface
-    CreateSurface(window, vulkanSurface);
+    if (!Settings::headless)
+    {
+        CreateSurface(window, vulkanSurface);
+    }
 
     //pick physical
     {
@@ -227,8 +295,8 @@ void Application::initVulkan()
             VkDeviceQueueCreateInfo queueCreateInfo{};
             queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
             queueCreateInfo.queueFamilyIndex = queueFamily;
-            //one queue is for imgui
-            queueCreateInfo.queueCount = 2;
+            //one queue is for imgui, software rasterizers often expose a single queue
+            queueCreateInfo.queueCount = Settings::headless ? 1 : 2;
             queueCreateInfo.pQueuePriorities = queuePriority;
             queueCreateInfos.push_back(queueCreateInfo);
         }
@@ -240,15 +308,26 @@ void Application::initVulkan()
         //enable geometry shader
         if (vulkanDeviceFeatures.geometryShader != VK_TRUE) throw std::runtime_error("not support geometry shader");
         deviceFeatures.geometryShader = VK_TRUE;
+        //optional, used by gpu profiler
+        deviceFeatures.pipelineStatisticsQuery = vulkanDeviceFeatures.pipelineStatisticsQuery;
+        //per light image arrays indexed by the light, e.g. the shadow cubemaps and the moment passes
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = vulkanDeviceFeatures.shaderSampledImageArrayDynamicIndexing;
+        deviceFeatures.shaderStorageImageArrayDynamicIndexing = vulkanDeviceFeatures.shaderStorageImageArrayDynamicIndexing;
+
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        //framebuffers do not hold image views, swapchain recreation keeps renderpass/pipeline
+        vulkan12Features.imagelessFramebuffer = VK_TRUE;
 
         VkDeviceCreateInfo deviceCreateInfo{};
         deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceCreateInfo.pNext = &vulkan12Features;
 
         deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
         deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
-        deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(GetDeviceExtensions().size());
+        deviceCreateInfo.ppEnabledExtensionNames = GetDeviceExtensions().data();
 
         if (enableValidationLayers)
         {
@@ -267,7 +346,10 @@ void Application::initVulkan()
 
         vkGetDeviceQueue(vulkanDevice, indices.graphicsFamily.value(), 0, &vulkanGraphicsQueue);
         //for imgui note : assume this queue has same family index with gui queue
-        vkGetDeviceQueue(vulkanDevice, indices.graphicsFamily.value(), 1, &guiQueue);
+        if (!Settings::headless)
+        {
+            vkGetDeviceQueue(vulkanDevice, indices.graphicsFamily.value(), 1, &guiQueue);
+        }
         vkGetDeviceQueue(vulkanDevice, indices.presentFamily.value(), 0, &vulkanPresentQueue);
     }
 
@@ -278,7 +360,8 @@ void Application::initVulkan()
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = 0;
+        //command buffers are recorded again when a pipeline compiled in background becomes ready
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
         if (vkCreateCommandPool(vulkanDevice, &poolInfo, nullptr, &vulkanCommandPool) != VK_SUCCESS)
         {
@@ -302,9 +385,12 @@ void Application::setVulkandebug()
 
 void Application::closeVulkan()
 {
-    ImGui_ImplVulkanH_DestroyWindow(vulkanInstance, vulkanDevice, &guivulkanWindow, nullptr);
+    if (!Settings::headless)
+    {
+        ImGui_ImplVulkanH_DestroyWindow(vulkanInstance, vulkanDevice, &guivulkanWindow, nullptr);
 
-    vkDestroyDescriptorPool(vulkanDevice, guiDescriptorPool, nullptr);
+        vkDestroyDescriptorPool(vulkanDevice, guiDescriptorPool, nullptr);
+    }
 
     vkDestroyCommandPool(vulkanDevice, vulkanCommandPool, nullptr);
 
@@ -353,11 +439,17 @@ bool Application::checkValidationLayerSupport()
 
 std::vector<const char*> Application::getRequiredExtensions()
 {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
+
+    //glfw is never initialized in headless mode
+    if (!Settings::headless)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) 
     {
@@ -445,8 +537,8 @@ bool Application::isDeviceSuitable(VkPhysicalDevice device)
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) 
+    bool swapChainAdequate = Settings::headless;
+    if (extensionsSupported && !Settings::headless) 
     {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -454,7 +546,14 @@ bool Application::isDeviceSuitable(VkPhysicalDevice device)
 
     vkGetPhysicalDeviceFeatures(device, &vulkanDeviceFeatures);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && vulkanDeviceFeatures.samplerAnisotropy;
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && vulkanDeviceFeatures.samplerAnisotropy && vulkan12Features.imagelessFramebuffer;
 }
 
 bool Application::checkDeviceExtensionSupport(VkPhysicalDevice device)
@@ -465,7 +564,7 @@ bool Application::checkDeviceExtensionSupport(VkPhysicalDevice device)
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(GetDeviceExtensions().begin(), GetDeviceExtensions().end());
 
     for (const auto& extension : availableExtensions)
     {
@@ -498,7 +597,15 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device, VkSur
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
+        else
+        {
+            //headless, frames only have to reach the offscreen ring on the graphic queue
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+        }
 
         if (presentSupport)
         {
@@ -655,12 +762,22 @@ GLFWwindow* Application::GetWindowPointer() const
     return window;
 }
 
+ThreadPool* Application::GetThreadPool() const
+{
+    return threadPool;
+}
+
+FrameClock* Application::GetFrameClock() const
+{
+    return frameClock;
+}
+
 void Application::SetShutdown()
 {
     shouldshutdown = true;
 }
 
-VkSwapchainKHR Application::CreateSwapChain(uint32_t& imageCount, VkFormat& swapChainImageFormat, VkExtent2D& swapChainExtent)
+VkSwapchainKHR Application::CreateSwapChain(uint32_t& imageCount, VkFormat& swapChainImageFormat, VkExtent2D& swapChainExtent, VkSwapchainKHR oldSwapChain)
 {
     VkSwapchainKHR swapChain;
 
@@ -717,6 +834,7 @@ VkSwapchainKHR Application::CreateSwapChain(uint32_t& imageCount, VkFormat& swap
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = oldSwapChain;
 
     if (vkCreateSwapchainKHR(vulkanDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
     {
@@ -953,7 +1071,7 @@ void Application::UpdateGui()
 
     if (ImGui::Begin("Info"))
     {
-        ImGui::Text("FPS : %u", lastFPS);
+        frameClock->drawGUI();
 
         //for (uint32_t i = 0; i < size; ++i)
         //{
@@ -3,10 +3,14 @@
 
 //third party library
 #define GLFW_INCLUDE_VULKAN
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 #include <vulkan/vulkan.h>
 #include <imgui/imgui_impl_vulkan.h>
 
@@ -16,6 +20,8 @@
 #include <concepts>
 
 class System;
+class ThreadPool;
+class FrameClock;
 
 struct QueueFamilyIndices
 {
@@ -68,11 +74,13 @@ public:
 	}
 
 	GLFWwindow* GetWindowPointer() const;
+	ThreadPool* GetThreadPool() const;
+	FrameClock* GetFrameClock() const;
 	void SetShutdown();
 
 //vulkan method
 public:
-	VkSwapchainKHR CreateSwapChain(uint32_t& imageCount, VkFormat& swapChainImageFormat, VkExtent2D& swapChainExtent);
+	VkSwapchainKHR CreateSwapChain(uint32_t& imageCount, VkFormat& swapChainImageFormat, VkExtent2D& swapChainExtent, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 	VkCommandPool GetCommandPool() const;
 	VkQueue GetGraphicQueue() const;
 	VkQueue GetPresentQueue() const;
@@ -87,7 +95,6 @@ public:
 	bool framebufferSizeUpdate = false;
 	bool guirecreateswapchain = false;
 
-	uint32_t lastFPS = 0;
 	bool shouldshutdown = false;
 
 //vulkan method
@@ -100,6 +107,9 @@ private:
 	
 	void closeVulkan();
 
+	//fixed number of frames without window or gui
+	void updateHeadless();
+
 	bool checkValidationLayerSupport();
 
 	std::vector<const char*> getRequiredExtensions();
@@ -158,6 +168,9 @@ private:
 
 	std::vector<System*> engineSystems;
 
+	ThreadPool* threadPool = nullptr;
+	FrameClock* frameClock = nullptr;
+
 	static Application* applicationPtr;
 };
 
@@ -170,7 +183,3 @@ VkResult CreateDebugUtilsMessengerEXT(VkInstance instance,
 void DestroyDebugUtilsMessengerEXT(VkInstance instance, 
 	VkDebugUtilsMessengerEXT debugMessenger,
 	const VkAllocationCallbacks* pAllocator);
-
-//callback function
-static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
-static void guiWindowResizeCallback(GLFWwindow* window, int width, int height);
\ No newline at end of file
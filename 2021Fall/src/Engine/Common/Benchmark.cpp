@@ -0,0 +1,413 @@
+#include "Benchmark.hpp"
+#include "Application.hpp"
+#include "FrameClock.hpp"
+#include "Engine/Graphic/Graphic.hpp"
+#include "Engine/Graphic/GPUProfiler.hpp"
+#include "Engine/Level/LevelManager.hpp"
+#include "Engine/Entity/Camera.hpp"
+#include "Engine/Misc/settings.hpp"
+
+//standard library
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+//3rd party library
+#include <glm/gtc/constants.hpp>
+#include <imgui/imgui.h>
+
+namespace
+{
+	//file names end up in the summary, windows paths have backslashes
+	std::string escapeJSON(const std::string& text)
+	{
+		std::string result;
+		for (char c : text)
+		{
+			if (c == '\\' || c == '"') result += '\\';
+			result += c;
+		}
+		return result;
+	}
+
+	void writeStat(std::ofstream& file, const char* name, const std::vector<float>& samples)
+	{
+		BenchmarkStat stat = Benchmark::Summarize(samples);
+
+		file << "\t\"" << name << "\": { ";
+		file << "\"mean\": " << stat.mean << ", \"p50\": " << stat.p50 << ", \"p95\": " << stat.p95 << ", \"p99\": " << stat.p99;
+		file << ", \"min\": " << stat.min << ", \"max\": " << stat.max << " },\n";
+	}
+
+	void writeSamples(std::ofstream& file, const char* name, const std::vector<float>& samples, bool last)
+	{
+		file << "\t\t\"" << name << "\": [";
+		for (size_t i = 0; i < samples.size(); ++i)
+		{
+			file << (i == 0 ? "" : ", ") << samples[i];
+		}
+		file << (last ? "]\n" : "],\n");
+	}
+
+	void writeKeys(std::ofstream& file, const std::bitset<GLFW_KEY_LAST + GLFW_MOUSE_BUTTON_LAST>& keys)
+	{
+		file << ' ' << keys.count();
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			if (keys[i]) file << ' ' << i;
+		}
+	}
+
+	bool readKeys(std::istringstream& line, std::bitset<GLFW_KEY_LAST + GLFW_MOUSE_BUTTON_LAST>& keys)
+	{
+		size_t count = 0;
+		if (!(line >> count)) return false;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t key = 0;
+			if (!(line >> key) || key >= keys.size()) return false;
+			keys[key] = true;
+		}
+
+		return true;
+	}
+}
+
+CameraPath CameraPath::Orbit(float radius, uint32_t keycount)
+{
+	CameraPath path;
+	path.closed = true;
+
+	for (uint32_t i = 0; i < keycount; ++i)
+	{
+		float angle = glm::two_pi<float>() * i / keycount;
+		float distance = radius * ((i % 2 == 0) ? 1.0f : 0.6f);
+		float height = 3.0f + radius * 0.25f * (1.0f + std::sin(angle * 2.0f));
+
+		path.keys.push_back({ glm::vec3(std::cos(angle) * distance, height, std::sin(angle) * distance), glm::vec3(0.0f) });
+	}
+
+	return path;
+}
+
+bool CameraPath::Load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open()) return false;
+
+	keys.clear();
+	closed = false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream values(line);
+		CameraKey key;
+		if (values >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z)
+		{
+			keys.push_back(key);
+		}
+	}
+
+	return keys.size() >= 2;
+}
+
+CameraKey CameraPath::Evaluate(float u) const
+{
+	int segmentcount = static_cast<int>(closed ? keys.size() : keys.size() - 1);
+
+	float s = std::clamp(u, 0.0f, 1.0f) * segmentcount;
+	int segment = std::min(static_cast<int>(s), segmentcount - 1);
+	float t = s - segment;
+
+	const CameraKey& k0 = getKey(segment - 1);
+	const CameraKey& k1 = getKey(segment);
+	const CameraKey& k2 = getKey(segment + 1);
+	const CameraKey& k3 = getKey(segment + 2);
+
+	auto catmullrom = [t](glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
+	{
+		return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t * t + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t * t * t);
+	};
+
+	return CameraKey{ catmullrom(k0.position, k1.position, k2.position, k3.position), catmullrom(k0.target, k1.target, k2.target, k3.target) };
+}
+
+const CameraKey& CameraPath::getKey(int index) const
+{
+	int count = static_cast<int>(keys.size());
+
+	//closed path wraps around, open path repeats its end points
+	if (closed) return keys[((index % count) + count) % count];
+
+	return keys[std::clamp(index, 0, count - 1)];
+}
+
+Benchmark::Benchmark(VkDevice device, Application* app) : System(device, app, "Benchmark") {}
+
+void Benchmark::init()
+{
+	if (!Settings::replayInputFile.empty())
+	{
+		if (!loadInput(Settings::replayInputFile))
+		{
+			throw std::runtime_error("failed to load input replay " + Settings::replayInputFile);
+		}
+
+		cameraSource = "replay:" + Settings::replayInputFile;
+	}
+	else if (!Settings::benchmarkCameraPath.empty())
+	{
+		if (!cameraPath.Load(Settings::benchmarkCameraPath))
+		{
+			throw std::runtime_error("failed to load camera path " + Settings::benchmarkCameraPath);
+		}
+
+		cameraSource = "path:" + Settings::benchmarkCameraPath;
+	}
+}
+
+void Benchmark::postinit()
+{
+	//the orbit is sized from the generated scene, the level does not exist before LevelManager::init
+	if (Settings::benchmark && cameraSource.empty())
+	{
+		cameraPath = CameraPath::Orbit(LevelManager::GetCurrentLevel()->GetSceneExtent() * 1.5f + 5.0f);
+		cameraSource = "orbit";
+	}
+}
+
+void Benchmark::update(float /*dt*/)
+{
+	uint64_t frame = application->GetFrameClock()->GetFrameCount() - 1;
+	uint64_t warmup = Settings::benchmarkWarmupFrames;
+	uint64_t measured = Settings::benchmarkFrameCount;
+
+	if (!Settings::recordInputFile.empty())
+	{
+		inputFrames.push_back(Input::GetFrame());
+	}
+	else if (!Settings::replayInputFile.empty())
+	{
+		Input::SetFrame(frame < inputFrames.size() ? inputFrames[frame] : InputFrame{});
+	}
+	else if (Settings::benchmark)
+	{
+		//live input would pull the camera off the path
+		Input::SetFrame(InputFrame{});
+
+		//warmup frames stay on the first control point
+		float u = static_cast<float>(std::min(frame - std::min(frame, warmup), measured)) / measured;
+		CameraKey key = cameraPath.Evaluate(u);
+
+		glm::vec3 direction = key.target - key.position;
+		Camera* camera = LevelManager::GetCurrentLevel()->GetCamera();
+		camera->GetTransform().SetPosition(key.position);
+		if (glm::length(direction) > 0.0001f)
+		{
+			camera->GetTransform().SetRotation(glm::inverse(glm::quatLookAtLH(glm::normalize(direction), glm::vec3(0.0f, 1.0f, 0.0f))));
+		}
+		//the path is sampled per frame, interpolating toward it would depend on the frame timing
+		camera->ResetInterpolation();
+	}
+
+	if (!Settings::benchmark || finished) return;
+
+	//frame clock holds the time of the previous frame
+	if (frame > warmup)
+	{
+		cpuFrameTimes.push_back(application->GetFrameClock()->GetLastFrameTime());
+		cpuWorkTimes.push_back(application->GetFrameClock()->GetLastWorkTime());
+	}
+
+	if (frame == warmup)
+	{
+		application->GetSystem<Graphic>()->GetProfiler()->BeginRecording(frame);
+	}
+
+	if (frame == warmup + measured)
+	{
+		finish();
+	}
+}
+
+void Benchmark::close()
+{
+	if (!Settings::recordInputFile.empty())
+	{
+		saveInput(Settings::recordInputFile);
+	}
+
+	if (Settings::benchmark && !finished)
+	{
+		std::cout << "benchmark stopped after " << cpuFrameTimes.size() << " of " << Settings::benchmarkFrameCount << " frames, no summary written" << std::endl;
+	}
+}
+
+void Benchmark::drawGUI()
+{
+	if (!Settings::benchmark)
+	{
+		ImGui::Text("%s input : %zu frames", Settings::recordInputFile.empty() ? "Replaying" : "Recording", inputFrames.size());
+		return;
+	}
+
+	ImGui::Text("Camera : %s", cameraSource.c_str());
+	ImGui::Text("Measured : %zu / %u", cpuFrameTimes.size(), Settings::benchmarkFrameCount);
+}
+
+BenchmarkStat Benchmark::Summarize(std::vector<float> samples)
+{
+	BenchmarkStat stat;
+	if (samples.empty()) return stat;
+
+	std::sort(samples.begin(), samples.end());
+
+	double sum = 0.0;
+	for (float sample : samples) sum += sample;
+
+	//nearest rank
+	auto percentile = [&samples](float p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+		return samples[std::clamp(rank, size_t(1), samples.size()) - 1];
+	};
+
+	stat.mean = static_cast<float>(sum / samples.size());
+	stat.p50 = percentile(0.50f);
+	stat.p95 = percentile(0.95f);
+	stat.p99 = percentile(0.99f);
+	stat.min = samples.front();
+	stat.max = samples.back();
+
+	return stat;
+}
+
+void Benchmark::finish()
+{
+	finished = true;
+
+	//the last measured frames are still in flight
+	vkDeviceWaitIdle(vulkanDevice);
+
+	GPUProfiler* profiler = application->GetSystem<Graphic>()->GetProfiler();
+	profiler->Collect();
+	profiler->EndRecording();
+
+	writeSummary(Settings::benchmarkOutput);
+
+	application->SetShutdown();
+}
+
+void Benchmark::writeSummary(const std::string& filename) const
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "failed to write benchmark summary " << filename << std::endl;
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(application->GetPhysicalDevice(), &properties);
+
+	GPUProfiler* profiler = application->GetSystem<Graphic>()->GetProfiler();
+
+	std::vector<float> gpuFrameTimes = profiler->GetRecordedFrames();
+	if (gpuFrameTimes.size() > cpuFrameTimes.size()) gpuFrameTimes.resize(cpuFrameTimes.size());
+
+	file << "{\n";
+	file << "\t\"scene\": { \"objects\": " << Settings::benchmarkObjectCount << ", \"instances\": " << Settings::modelInstanceCount;
+	file << ", \"lights\": " << Settings::benchmarkLightCount << ", \"mesh\": \"" << Settings::benchmarkMesh << "\", \"seed\": " << Settings::benchmarkSeed << " },\n";
+	file << "\t\"camera\": \"" << escapeJSON(cameraSource) << "\",\n";
+	file << "\t\"resolution\": [" << Settings::windowWidth << ", " << Settings::windowHeight << "],\n";
+	file << "\t\"headless\": " << (Settings::headless ? "true" : "false") << ",\n";
+	file << "\t\"device\": \"" << escapeJSON(properties.deviceName) << "\",\n";
+	file << "\t\"driver_version\": " << properties.driverVersion << ",\n";
+	file << "\t\"dt\": " << Settings::fixedFrameDelta << ",\n";
+	file << "\t\"warmup\": " << Settings::benchmarkWarmupFrames << ",\n";
+	file << "\t\"frames\": " << cpuFrameTimes.size() << ",\n";
+
+	writeStat(file, "cpu_frame_ms", cpuFrameTimes);
+	writeStat(file, "cpu_work_ms", cpuWorkTimes);
+
+	//no timestamp support -> empty samples, the key stays so summaries always have the same shape
+	writeStat(file, "gpu_frame_ms", gpuFrameTimes);
+
+	file << "\t\"gpu_scopes\": {";
+	const std::vector<ProfileScope>& scopes = profiler->GetScopes();
+	for (size_t i = 0; i < scopes.size(); ++i)
+	{
+		BenchmarkStat stat = Summarize(scopes[i].recorded);
+
+		file << (i == 0 ? "\n" : ",\n");
+		file << "\t\t\"" << scopes[i].name << "\": { \"mean\": " << stat.mean << ", \"p50\": " << stat.p50;
+		file << ", \"p95\": " << stat.p95 << ", \"p99\": " << stat.p99 << " }";
+	}
+	file << "\n\t},\n";
+
+	file << "\t\"samples\": {\n";
+	writeSamples(file, "cpu_frame_ms", cpuFrameTimes, false);
+	writeSamples(file, "cpu_work_ms", cpuWorkTimes, false);
+	writeSamples(file, "gpu_frame_ms", gpuFrameTimes, true);
+	file << "\t}\n}\n";
+
+	std::cout << "benchmark summary written to " << filename << std::endl;
+}
+
+bool Benchmark::loadInput(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open()) return false;
+
+	inputFrames.clear();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream values(line);
+		InputFrame frame;
+
+		if (!(values >> frame.mouseMove.x >> frame.mouseMove.y)) return false;
+		if (!readKeys(values, frame.pressedKey) || !readKeys(values, frame.triggeredKey)) return false;
+
+		inputFrames.push_back(frame);
+	}
+
+	return true;
+}
+
+void Benchmark::saveInput(const std::string& filename) const
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "failed to write input recording " << filename << std::endl;
+		return;
+	}
+
+	//one frame per line : mouse move, pressed key count and codes, triggered key count and codes
+	//9 digits so the replayed mouse move is bit exact
+	file << std::setprecision(9);
+	for (const InputFrame& frame : inputFrames)
+	{
+		file << frame.mouseMove.x << ' ' << frame.mouseMove.y;
+		writeKeys(file, frame.pressedKey);
+		writeKeys(file, frame.triggeredKey);
+		file << '\n';
+	}
+
+	std::cout << "input recording written to " << filename << std::endl;
+}
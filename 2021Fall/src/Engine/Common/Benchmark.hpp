@@ -0,0 +1,81 @@
+#pragma once
+#include "System.hpp"
+#include "Engine/Input/Input.hpp"
+
+//standard library
+#include <string>
+#include <vector>
+
+//3rd party library
+#include <glm/glm.hpp>
+
+struct CameraKey
+{
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+//uniform catmull-rom spline through camera control points
+class CameraPath
+{
+public:
+	//closed loop around the origin, the radius alternates so the view is not a plain circle
+	static CameraPath Orbit(float radius, uint32_t keycount = 8);
+
+	//one control point per line "px py pz tx ty tz", false when fewer than two points are read
+	bool Load(const std::string& filename);
+
+	//u 0~1 over the whole path
+	CameraKey Evaluate(float u) const;
+
+private:
+	const CameraKey& getKey(int index) const;
+
+	std::vector<CameraKey> keys;
+	bool closed = false;
+};
+
+struct BenchmarkStat
+{
+	float mean = 0.0f;
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float min = 0.0f;
+	float max = 0.0f;
+};
+
+//drives the camera from a path or recorded input with a fixed simulated dt and records per frame cpu/gpu times
+//has to be added after Input and before LevelManager so the camera is placed before the level updates
+class Benchmark : public System
+{
+public:
+	Benchmark(VkDevice device, Application* app);
+
+	virtual void init() override;
+	virtual void postinit() override;
+
+	virtual void update(float dt) override;
+	virtual void close() override;
+	virtual void drawGUI() override;
+
+	static BenchmarkStat Summarize(std::vector<float> samples);
+
+private:
+	void finish();
+	void writeSummary(const std::string& filename) const;
+
+	bool loadInput(const std::string& filename);
+	void saveInput(const std::string& filename) const;
+
+	CameraPath cameraPath;
+	std::string cameraSource;
+
+	std::vector<InputFrame> inputFrames;
+
+	//ms, one sample per measured frame
+	std::vector<float> cpuFrameTimes;
+	std::vector<float> cpuWorkTimes;
+
+	bool finished = false;
+};
@@ -0,0 +1,203 @@
+#include "FrameClock.hpp"
+#include "Engine/Misc/settings.hpp"
+
+//standard library
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <cmath>
+#include <cfloat>
+
+//3rd party library
+#include <imgui/imgui.h>
+
+//a breakpoint or window drag should not turn into seconds of simulation at once
+constexpr double FRAMECLOCK_MAX_DELTA = 0.25;
+constexpr uint32_t FRAMECLOCK_MAX_FIXED_STEP = 8;
+
+FrameClock::FrameClock() : frameStart(Clock::now()), workEnd(frameStart) {}
+
+void FrameClock::BeginFrame()
+{
+	Clock::time_point now = Clock::now();
+
+	if (frameCount > 0)
+	{
+		double frame = std::chrono::duration<double>(now - frameStart).count();
+
+		uint32_t index = historyCount % FRAMECLOCK_HISTORY_SIZE;
+		frameTimes[index] = static_cast<float>(frame * 1000.0);
+		workTimes[index] = static_cast<float>(std::chrono::duration<double, std::milli>(workEnd - frameStart).count());
+		++historyCount;
+
+		deltaTime = std::min(frame, FRAMECLOCK_MAX_DELTA);
+	}
+	else
+	{
+		deltaTime = GetFixedDeltaTime();
+	}
+
+	//simulated time step, the simulation does not depend on how fast the frames really are
+	if (Settings::fixedFrameDelta > 0.0f) deltaTime = Settings::fixedFrameDelta;
+
+	frameStart = now;
+	++frameCount;
+
+	accumulator += deltaTime;
+	fixedStepCount = 0;
+}
+
+bool FrameClock::StepFixed()
+{
+	double step = GetFixedDeltaTime();
+
+	if (accumulator < step) return false;
+
+	if (fixedStepCount >= FRAMECLOCK_MAX_FIXED_STEP)
+	{
+		//simulation can not keep up, drop the backlog instead of spiraling
+		accumulator = std::fmod(accumulator, step);
+		return false;
+	}
+
+	accumulator -= step;
+	++fixedStepCount;
+
+	return true;
+}
+
+void FrameClock::EndFrame(bool isidle)
+{
+	workEnd = Clock::now();
+	idle = isidle;
+
+	unsigned int framerate = idle ? Settings::idleFrameRate : Settings::targetFrameRate;
+	if (framerate == 0) return;
+
+	Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framerate));
+	sleepUntil(frameStart + period);
+}
+
+float FrameClock::GetDeltaTime() const
+{
+	return static_cast<float>(deltaTime);
+}
+
+float FrameClock::GetFixedDeltaTime() const
+{
+	unsigned int rate = (Settings::fixedUpdateRate == 0) ? 60 : Settings::fixedUpdateRate;
+
+	return 1.0f / static_cast<float>(rate);
+}
+
+float FrameClock::GetAlpha() const
+{
+	return std::clamp(static_cast<float>(accumulator / GetFixedDeltaTime()), 0.0f, 1.0f);
+}
+
+float FrameClock::GetLastFrameTime() const
+{
+	if (historyCount == 0) return 0.0f;
+
+	return frameTimes[(historyCount - 1) % FRAMECLOCK_HISTORY_SIZE];
+}
+
+float FrameClock::GetLastWorkTime() const
+{
+	if (historyCount == 0) return 0.0f;
+
+	return workTimes[(historyCount - 1) % FRAMECLOCK_HISTORY_SIZE];
+}
+
+uint64_t FrameClock::GetFrameCount() const
+{
+	return frameCount;
+}
+
+bool FrameClock::IsIdle() const
+{
+	return idle;
+}
+
+FrameTimeStat FrameClock::GetStat() const
+{
+	FrameTimeStat stat;
+
+	uint32_t count = std::min(historyCount, FRAMECLOCK_HISTORY_SIZE);
+	if (count == 0) return stat;
+
+	std::vector<float> sorted(frameTimes.begin(), frameTimes.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+
+	float sum = 0.0f;
+	for (float sample : sorted) sum += sample;
+
+	stat.avg = sum / count;
+	stat.p50 = sorted[count / 2];
+	stat.p99 = sorted[std::min(static_cast<uint32_t>(std::ceil(count * 0.99f)) - 1, count - 1)];
+	stat.max = sorted.back();
+	stat.fps = (stat.avg > 0.0f) ? 1000.0f / stat.avg : 0.0f;
+
+	return stat;
+}
+
+void FrameClock::drawGUI()
+{
+	FrameTimeStat stat = GetStat();
+	uint32_t count = std::min(historyCount, FRAMECLOCK_HISTORY_SIZE);
+
+	float worksum = 0.0f;
+	for (uint32_t i = 0; i < count; ++i) worksum += workTimes[i];
+
+	ImGui::Text("FPS : %.1f (%.2f ms)", stat.fps, stat.avg);
+	ImGui::Text("p50 : %.2f ms, p99 : %.2f ms, max : %.2f ms", stat.p50, stat.p99, stat.max);
+	ImGui::Text("CPU : %.2f ms", (count > 0) ? worksum / count : 0.0f);
+	if (idle) ImGui::Text("Idle");
+
+	int offset = (historyCount > FRAMECLOCK_HISTORY_SIZE) ? static_cast<int>(historyCount % FRAMECLOCK_HISTORY_SIZE) : 0;
+	ImGui::PlotLines("Frame(ms)##FrameClock", frameTimes.data(), static_cast<int>(count), offset, nullptr, 0.0f, stat.max, ImVec2(0, 50));
+
+	std::array<float, FRAMECLOCK_HISTOGRAM_BUCKET> histogram{};
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t bucket = static_cast<uint32_t>(frameTimes[i] / FRAMECLOCK_HISTOGRAM_WIDTH);
+		histogram[std::min(bucket, FRAMECLOCK_HISTOGRAM_BUCKET - 1)] += 1.0f;
+	}
+	ImGui::PlotHistogram("Histogram##FrameClock", histogram.data(), FRAMECLOCK_HISTOGRAM_BUCKET, 0, "0 ~ 40ms", 0.0f, FLT_MAX, ImVec2(0, 50));
+
+	int targetframerate = static_cast<int>(Settings::targetFrameRate);
+	if (ImGui::DragInt("Frame Cap(0 = off)##FrameClock", &targetframerate, 1.0f, 0, 1000)) Settings::targetFrameRate = static_cast<unsigned int>(targetframerate);
+
+	int idleframerate = static_cast<int>(Settings::idleFrameRate);
+	if (ImGui::DragInt("Idle Cap##FrameClock", &idleframerate, 1.0f, 1, 1000)) Settings::idleFrameRate = static_cast<unsigned int>(idleframerate);
+
+	int fixedupdaterate = static_cast<int>(Settings::fixedUpdateRate);
+	if (ImGui::DragInt("Fixed Step(Hz)##FrameClock", &fixedupdaterate, 1.0f, 1, 1000)) Settings::fixedUpdateRate = static_cast<unsigned int>(fixedupdaterate);
+
+	ImGui::Checkbox("Idle When Unfocused##FrameClock", &Settings::idleWhenUnfocused);
+}
+
+void FrameClock::sleepUntil(Clock::time_point target)
+{
+	//sleep while the remaining time is safely above the real sleep granularity, spin the rest
+	while (true)
+	{
+		Clock::time_point now = Clock::now();
+		double remaining = std::chrono::duration<double>(target - now).count();
+
+		if (remaining <= 0.0) return;
+
+		if (remaining > sleepEstimate)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			double slept = std::chrono::duration<double>(Clock::now() - now).count();
+			//jump up on an oversleep, decay slowly so a single hiccup does not keep us spinning
+			sleepEstimate = std::max(slept, sleepEstimate * 0.99);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+//standard library
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+constexpr uint32_t FRAMECLOCK_HISTORY_SIZE = 512;
+constexpr uint32_t FRAMECLOCK_HISTOGRAM_BUCKET = 40;
+//ms per histogram bucket, last bucket holds everything slower
+constexpr float FRAMECLOCK_HISTOGRAM_WIDTH = 1.0f;
+
+struct FrameTimeStat
+{
+	float avg = 0.0f;
+	float p50 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+	float fps = 0.0f;
+};
+
+//monotonic frame timing, fixed step accumulator and frame limiter
+//every frame : BeginFrame -> while(StepFixed()) fixedupdate -> update -> EndFrame
+class FrameClock
+{
+public:
+	FrameClock();
+
+	void BeginFrame();
+	//true while another fixed step is due this frame
+	bool StepFixed();
+	//sleeps until the frame cap (idle cap when idle) is reached
+	void EndFrame(bool idle);
+
+	//second
+	float GetDeltaTime() const;
+	float GetFixedDeltaTime() const;
+	//0~1, how far the rendered frame is between the last two fixed steps
+	float GetAlpha() const;
+
+	//ms, previous frame
+	float GetLastFrameTime() const;
+	float GetLastWorkTime() const;
+
+	uint64_t GetFrameCount() const;
+	bool IsIdle() const;
+
+	FrameTimeStat GetStat() const;
+
+	void drawGUI();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	void sleepUntil(Clock::time_point target);
+
+	Clock::time_point frameStart;
+	Clock::time_point workEnd;
+
+	double deltaTime = 0.0;
+	double accumulator = 0.0;
+	uint32_t fixedStepCount = 0;
+
+	uint64_t frameCount = 0;
+	bool idle = false;
+
+	//how long sleep_for(1ms) really takes, spin for the rest of the frame below this
+	double sleepEstimate = 0.002;
+
+	//ms, start to start so sleep and vsync waits are included
+	std::array<float, FRAMECLOCK_HISTORY_SIZE> frameTimes{};
+	//ms, cpu time from BeginFrame to EndFrame without the limiter sleep
+	std::array<float, FRAMECLOCK_HISTORY_SIZE> workTimes{};
+	uint32_t historyCount = 0;
+};
@@ -0,0 +1,62 @@
+#include "MatrixBatch.hpp"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATRIXBATCH_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef MATRIXBATCH_SSE
+namespace
+{
+	//xyz cross product, w of the result is 0
+	__m128 Cross(__m128 a, __m128 b)
+	{
+		__m128 ayzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 byzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 result = _mm_sub_ps(_mm_mul_ps(a, byzx), _mm_mul_ps(ayzx, b));
+
+		return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	//dot of all four lanes in every lane
+	__m128 Dot(__m128 a, __m128 b)
+	{
+		__m128 product = _mm_mul_ps(a, b);
+		__m128 swapped = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(product, swapped);
+		swapped = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+
+		return _mm_add_ps(sums, swapped);
+	}
+}
+#endif
+
+void MatrixBatch::NormalMatrices(const glm::mat4* const* models, glm::mat4* const* normals, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const glm::mat4& model = *models[i];
+		glm::mat4& normal = *normals[i];
+
+#ifdef MATRIXBATCH_SSE
+		//w of the columns is dropped so the crosses and the determinant only see the 3x3
+		const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		__m128 a = _mm_and_ps(_mm_loadu_ps(&model[0][0]), mask);
+		__m128 b = _mm_and_ps(_mm_loadu_ps(&model[1][0]), mask);
+		__m128 c = _mm_and_ps(_mm_loadu_ps(&model[2][0]), mask);
+
+		//the inverse has the crosses of the other two columns as rows, so its transpose has them as columns
+		__m128 bc = Cross(b, c);
+		__m128 ca = Cross(c, a);
+		__m128 ab = Cross(a, b);
+		__m128 invdet = _mm_div_ps(_mm_set1_ps(1.0f), Dot(a, bc));
+
+		_mm_storeu_ps(&normal[0][0], _mm_mul_ps(bc, invdet));
+		_mm_storeu_ps(&normal[1][0], _mm_mul_ps(ca, invdet));
+		_mm_storeu_ps(&normal[2][0], _mm_mul_ps(ab, invdet));
+		_mm_storeu_ps(&normal[3][0], _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+#else
+		normal = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+#endif
+	}
+}
\ No newline at end of file
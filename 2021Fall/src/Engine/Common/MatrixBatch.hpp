@@ -0,0 +1,15 @@
+#pragma once
+
+//3rd party library
+#include <glm/glm.hpp>
+
+//standard library
+#include <cstddef>
+
+//derived matrices for many objects at once, sse on x86 and glm elsewhere
+namespace MatrixBatch
+{
+	//inverse transpose of the upper 3x3 of every model matrix, the normal matrix of the object in world space
+	//written as a mat4 with (0,0,0,1) in the last column, the layout the shaders read
+	void NormalMatrices(const glm::mat4* const* models, glm::mat4* const* normals, size_t count);
+}
\ No newline at end of file
@@ -18,6 +18,8 @@ public:
 	virtual void postinit() override = 0;
 
 	virtual void update(float dt) override = 0;
+	//called zero or more times per frame with a constant dt before update
+	virtual void fixedupdate(float /*dt*/) {}
 	virtual void drawGUI() = 0;
 	virtual void close() override = 0;
 	virtual ~System() override {};
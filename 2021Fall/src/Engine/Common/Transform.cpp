@@ -82,3 +82,19 @@ void Transform::Rotate(glm::quat qt)
 {
 	rotation = rotation * qt;
 }
+
+glm::mat4 Transform::GetMatrix() const
+{
+	return glm::translate(glm::mat4(1.0f), position) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+Transform Transform::Interpolate(const Transform& from, const Transform& to, float alpha)
+{
+	Transform result;
+
+	result.position = glm::mix(from.position, to.position, alpha);
+	result.rotation = glm::slerp(from.rotation, to.rotation, alpha);
+	result.scale = glm::mix(from.scale, to.scale, alpha);
+
+	return result;
+}
\ No newline at end of file
@@ -32,6 +32,11 @@ public:
 	void Rotate(float pitch, float yaw, float roll);
 	void Rotate(glm::quat qt);
 
+	glm::mat4 GetMatrix() const;
+
+	//lerp position/scale, slerp rotation
+	static Transform Interpolate(const Transform& from, const Transform& to, float alpha);
+
 private:
 	glm::vec3 position = glm::vec3(0, 0, 0);
 	glm::quat rotation = glm::quat(glm::vec3(0,0,0));
@@ -2,9 +2,30 @@
 #include "Engine/Misc/settings.hpp"
 #include "Engine/Memory/Buffer.hpp"
 #include "Engine/Graphic/Graphic.hpp"
+#include "Engine/Common/Application.hpp"
+#include "Engine/Common/FrameClock.hpp"
 
 glm::vec3 Global_Up = glm::vec3(0.0f, 1.0f, 0.0f);
 
+//jitter sequence length, the history forgets older frames long before it repeats
+constexpr uint32_t TAA_JITTER_COUNT = 8;
+
+//radical inverse of index in base, 0~1
+static float Halton(uint32_t index, uint32_t base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+
+	while (index > 0)
+	{
+		fraction /= base;
+		result += fraction * (index % base);
+		index /= base;
+	}
+
+	return result;
+}
+
 Camera::Camera(Level* level, unsigned int objid, std::string objname) : Object(level, objid, objname) {}
 
 void Camera::init()
@@ -17,11 +38,37 @@ void Camera::postinit()
 
 void Camera::update(float dt)
 {
-	camTransform.worldToCamera = glm::lookAtLH(transform.GetPosition(), transform.GetPosition() + transform.GetDirectionVector(), Global_Up);
+	//movement runs in the fixed step, looking around follows the mouse every frame
+	float alpha = Application::APP()->GetFrameClock()->GetAlpha();
+	glm::vec3 position = Transform::Interpolate(previousTransform, transform, alpha).GetPosition();
+
+	camTransform.worldToCamera = glm::lookAtLH(position, position + transform.GetDirectionVector(), Global_Up);
 	camTransform.cameraToNDC = glm::perspectiveLH_NO(glm::radians(45.0f), Settings::GetAspectRatio(), 0.1f, 500.0f);
 	camTransform.cameraToNDC[1][1] *= -1;
 
+	camTransform.previousWorldToNDC = camTransform.worldToNDC;
+	camTransform.worldToNDC = camTransform.cameraToNDC * camTransform.worldToCamera;
+
+	//subpixel offset every frame, the resolve accumulates the samples over time
+	if (Settings::temporalAA)
+	{
+		uint32_t index = static_cast<uint32_t>(Application::APP()->GetFrameClock()->GetFrameCount() % TAA_JITTER_COUNT) + 1;
+		glm::vec2 jitter = glm::vec2(Halton(index, 2), Halton(index, 3)) - 0.5f;
+
+		//offset in ndc, a pixel is 2 / size wide
+		camTransform.cameraToNDC[2][0] += jitter.x * 2.0f / Settings::windowWidth;
+		camTransform.cameraToNDC[2][1] += jitter.y * 2.0f / Settings::windowHeight;
+	}
+
+	//view is rotation and translation only
+	camTransform.cameraToWorld = glm::affineInverse(camTransform.worldToCamera);
+	camTransform.NDCToCamera = glm::inverse(camTransform.cameraToNDC);
+
 	VulkanMemoryManager::MapMemory(UNIFORM_CAMERA_TRANSFORM, &camTransform);
+
+	//the y scale of the projection is 1 / tan(fovy / 2), flipped above for vulkan
+	float projectionscale = Settings::windowHeight * 0.5f * std::fabs(camTransform.cameraToNDC[1][1]);
+	Application::APP()->GetSystem<Graphic>()->SetLODView(LOD_VIEW_CAMERA, position, projectionscale);
 }
 
 void Camera::close()
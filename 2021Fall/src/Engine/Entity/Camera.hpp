@@ -6,11 +6,20 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 
 struct Cameratransform
 {
 	glm::mat4 worldToCamera;
 	glm::mat4 cameraToNDC;
+
+	//without jitter, current and last frame for the velocity of Settings::temporalAA
+	glm::mat4 worldToNDC = glm::mat4(1.0f);
+	glm::mat4 previousWorldToNDC = glm::mat4(1.0f);
+
+	//inverses of worldToCamera and cameraToNDC (with jitter), computed here so no shader inverts them
+	glm::mat4 cameraToWorld = glm::mat4(1.0f);
+	glm::mat4 NDCToCamera = glm::mat4(1.0f);
 };
 
 class Camera : public Object
@@ -4,6 +4,8 @@
 #include "Engine/Level/Level.hpp"
 #include "Engine/Level/ObjectManager.hpp"
 #include "Camera.hpp"
+#include "Engine/Common/Application.hpp"
+#include "Engine/Misc/settings.hpp"
 
 Light::Light(Level* level, unsigned int objid, std::string objname) : Object(level, objid, objname) {}
 
@@ -41,7 +43,8 @@ void PointLight::update(float dt)
 {
 	lightproj.far_plane = 100.0f;
 	lightproj.position = transform.GetPosition();
-	glm::mat4 shadowproj = glm::perspectiveLH_NO(glm::radians(90.0f), 1.0f, 0.1f, lightproj.far_plane);
+	//hardware depth in 0~1, light.glsl rebuilds it from the distance with the same near plane
+	glm::mat4 shadowproj = glm::perspectiveLH_ZO(glm::radians(90.0f), 1.0f, 0.1f, lightproj.far_plane);
 	shadowproj[1][1] *= -1.0f;
 	lightproj.projection[0] = shadowproj * glm::lookAtLH(lightproj.position, lightproj.position + glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
 	lightproj.projection[1] = shadowproj * glm::lookAtLH(lightproj.position, lightproj.position + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
@@ -60,6 +63,10 @@ void PointLight::update(float dt)
 	if(endIndex) VulkanMemoryManager::MapMemory(UNIFORM_LIGHTDATA, &data, sizeof(int), MAX_LIGHT * LIGHTDATA_ALLIGNMENT);
 
 	VulkanMemoryManager::MapMemory(UNIFORM_LIGHTPROJ, &lightproj, sizeof(LightProj), lightIndex * LIGHTPROJ_ALLIGNMENT);
+
+	//cube faces have a 90 degree fov, tan(45) is 1
+	float shadowsize = static_cast<float>(Settings::shadowMoments ? Settings::shadowMomentSize : Settings::shadowmapSize);
+	Application::APP()->GetSystem<Graphic>()->SetLODView(LOD_VIEW_LIGHT + lightIndex, lightproj.position, shadowsize * 0.5f);
 }
 
 void PointLight::close()
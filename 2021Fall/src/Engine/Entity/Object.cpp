@@ -2,6 +2,7 @@
 #include "Engine/Memory/Buffer.hpp"
 #include "Engine/Common/Application.hpp"
 #include "Engine/Graphic/Graphic.hpp"
+#include "Engine/Common/FrameClock.hpp"
 
 //3rd party library
 #include <glm/glm.hpp>
@@ -13,13 +14,26 @@ void Object::init()
 
 void Object::update(float dt)
 {
-	uniform.objectMat = glm::translate(glm::mat4(1.0f), transform.position) * glm::toMat4(transform.rotation) * glm::scale(glm::mat4(1.0f), transform.scale);
+	float alpha = Application::APP()->GetFrameClock()->GetAlpha();
+	uniform.previousObjectMat = uniform.objectMat;
+	uniform.objectMat = Transform::Interpolate(previousTransform, transform, alpha).GetMatrix();
+	if (uniform.objectMat != uniform.previousObjectMat) normalMatDirty = true;
 
 	//VulkanMemoryManager::MapMemory(UNIFORM_OBJECT_MATRIX, &uniform, sizeof(ObjectUniform));
 
 	Graphic* graphic = Application::APP()->GetSystem<Graphic>();
 
-	graphic->AddDrawInfo({ &uniform, sizeof(ObjectUniform), 128 }, uniformID);
+	graphic->AddDrawInfo({ &uniform, sizeof(ObjectUniform), OBJECT_UNIFORM_STRIDE }, uniformID);
+}
+
+void Object::fixedupdate(float /*dt*/)
+{
+	previousTransform = transform;
+}
+
+void Object::ResetInterpolation()
+{
+	previousTransform = transform;
 }
 
 void Object::close()
@@ -46,6 +60,7 @@ Transform& Object::GetTransform()
 void Object::SetUniform(ObjectUniform objuniform)
 {
 	uniform = objuniform;
+	normalMatDirty = true;
 }
 
 void* Object::GetUniformPointer()
@@ -77,5 +92,5 @@ void Object::postinit()
 {
 	Graphic* graphic = Application::APP()->GetSystem<Graphic>();
 	
-	graphic->RegisterObject(descriptorsetID, programID, drawtargetIndex);
+	graphic->RegisterObject(descriptorsetID, programID, drawtargetIndex, &uniform.objectMat);
 }
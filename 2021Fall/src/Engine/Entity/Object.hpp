@@ -12,6 +12,7 @@
 
 class Level;
 
+//ObjectData in object.glsl, std430 puts the matrices after the surface parameters on 16 bytes
 struct ObjectUniform
 {
 	glm::mat4 objectMat = glm::mat4(1.0f);
@@ -19,7 +20,14 @@ struct ObjectUniform
 	glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
 	float metal = 0.5f;
 	float roughness = 0.5f;
+
+	//objectMat of the last rendered frame, for the velocity of Settings::temporalAA
+	alignas(16) glm::mat4 previousObjectMat = glm::mat4(1.0f);
+
+	//inverse transpose of objectMat, filled by ObjectManager::update whenever objectMat changes
+	glm::mat4 normalMat = glm::mat4(1.0f);
 };
+static_assert(sizeof(ObjectUniform) <= OBJECT_UNIFORM_STRIDE, "ObjectUniform does not fit its storage buffer element");
 
 class Object : public Interface
 {
@@ -30,6 +38,10 @@ public:
 	virtual void postinit() override;
 
 	virtual void update(float dt) override;
+	//simulation step, overrides have to call Object::fixedupdate first to keep interpolation working
+	virtual void fixedupdate(float dt);
+	//next frame renders transform as it is, for moves outside the simulation that should not be interpolated
+	void ResetInterpolation();
 	virtual void close() override;
 
 	virtual ~Object() override;
@@ -53,8 +65,12 @@ protected:
 	std::string name = "";
 
 	Transform transform;
+	//transform at the start of the last fixed step, rendering interpolates toward transform
+	Transform previousTransform;
 
 	ObjectUniform uniform;
+	//objectMat changed since normalMat was computed
+	bool normalMatDirty = true;
 
 	Level* ownerLevel = nullptr;
 
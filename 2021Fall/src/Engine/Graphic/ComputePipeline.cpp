@@ -0,0 +1,30 @@
+#include "ComputePipeline.hpp"
+
+//standard library
+#include <stdexcept>
+
+ComputePipeline::ComputePipeline(VkDevice device, VkPipelineCache pipelinecache) : vulkanDevice(device), vulkanpipelinecache(pipelinecache) {}
+
+void ComputePipeline::init(VkPipelineLayout pipelinelayout, const VkPipelineShaderStageCreateInfo& shaderStage)
+{
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStage;
+	pipelineInfo.layout = pipelinelayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	if (vkCreateComputePipelines(vulkanDevice, vulkanpipelinecache, 1, &pipelineInfo, nullptr, &vulkanPipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+}
+
+void ComputePipeline::close()
+{
+	vkDestroyPipeline(vulkanDevice, vulkanPipeline, nullptr);
+}
+
+VkPipeline ComputePipeline::GetPipeline() const
+{
+	return vulkanPipeline;
+}
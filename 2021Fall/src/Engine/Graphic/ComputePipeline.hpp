@@ -0,0 +1,22 @@
+#pragma once
+
+//3rd party library
+#include <vulkan/vulkan.h>
+
+class ComputePipeline
+{
+public:
+	ComputePipeline(VkDevice device, VkPipelineCache pipelinecache);
+
+	void init(VkPipelineLayout pipelinelayout, const VkPipelineShaderStageCreateInfo& shaderStage);
+	void close();
+
+	VkPipeline GetPipeline() const;
+private:
+	VkDevice vulkanDevice;
+
+	VkPipeline vulkanPipeline;
+
+	//owned by PipelineCache, shared between every pipeline
+	VkPipelineCache vulkanpipelinecache = VK_NULL_HANDLE;
+};
\ No newline at end of file
@@ -2,78 +2,133 @@
 #include "Engine/Misc/helper.hpp"
 #include "DescriptorSet.hpp"
 #include "Graphic.hpp"
+#include "Engine/Misc/settings.hpp"
+#include "ShaderCompiler.hpp"
+#include "DescriptorAllocator.hpp"
 
 //standard library
 #include <stdexcept>
+#include <map>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+
+namespace
+{
+	//one element of the packed data a descriptor update template reads
+	union DescriptorWrite
+	{
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+	};
+
+	//every pipeline layout has this range so switching programs never disturbs the pushed values or the bound sets
+	constexpr VkPushConstantRange DRAW_PUSH_CONSTANT_RANGE = { VK_SHADER_STAGE_ALL, 0, sizeof(DrawPushConstants) };
+	//smallest maxPushConstantsSize a device may report
+	static_assert(sizeof(DrawPushConstants) <= 128, "DrawPushConstants does not fit the guaranteed push constant size");
+	static_assert(offsetof(DrawPushConstants, positionScale) == 16 && sizeof(DrawPushConstants) == 32, "DrawPushConstants does not match drawconstants.glsl");
+
+	//tiers with one layout for every program, its bindings are visible to every stage
+	constexpr std::array<DESCRIPTOR_SET_TIER, 2> SHARED_TIERS = { DESCRIPTOR_SET_TIER_GLOBAL, DESCRIPTOR_SET_TIER_MATERIAL };
+
+	//programs drawn with one pass set, each pass layout of a group holds the bindings of all of them
+	const std::vector<std::vector<PROGRAM_ID>> SHARED_LAYOUT_PROGRAMS = {
+		//msaa edge lighting binds DESCRIPTORSET_ID_DEFERRED for all three, the edge pass reads only the gbuffer
+		{ PROGRAM_ID::PROGRAM_ID_DEFERRED, PROGRAM_ID::PROGRAM_ID_DEFERRED_EDGE, PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE },
+	};
+}
+
+size_t LayoutKeyHash::operator()(const std::vector<uint32_t>& key) const
+{
+	//fnv-1a over the words
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (uint32_t word : key)
+	{
+		hash ^= word;
+		hash *= 0x100000001B3ull;
+	}
+
+	return static_cast<size_t>(hash);
+}
 
 DescriptorManager::DescriptorManager(VkDevice device) : vulkanDevice(device) {}
 
-void DescriptorManager::init()
+void DescriptorManager::init(bool edgeLighting, uint32_t framecount)
 {
-	shaders[SHADER_ID_BASERENDER_VERTEX] = { CreateShaderModule("data/shaders/baserendervert.spv"), VK_SHADER_STAGE_VERTEX_BIT,
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}
-		} };
-	shaders[SHADER_ID_BASERENDER_FRAG] = { CreateShaderModule("data/shaders/baserenderfrag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT,
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}
-		} };
-	shaders[SHADER_ID_DEFERRED_VERTEX] = { CreateShaderModule("data/shaders/deferredvert.spv"), VK_SHADER_STAGE_VERTEX_BIT, {} };
-	shaders[SHADER_ID_DEFERRED_FRAG] = { CreateShaderModule("data/shaders/deferredfrag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT,
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5},
-
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6, MAX_LIGHT},
-		} };
-	shaders[SHADER_ID_DIFFUSE_VERTEX] = { CreateShaderModule("data/shaders/cuberendervert.spv"), VK_SHADER_STAGE_VERTEX_BIT, 
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}
-		} };
-	shaders[SHADER_ID_DIFFUSE_FRAG] = { CreateShaderModule("data/shaders/cuberenderfrag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT,
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}
-		} };
-	shaders[SHADER_ID_SHADOWMAP_VERTEX] = { CreateShaderModule("data/shaders/shadowmapvert.spv"), VK_SHADER_STAGE_VERTEX_BIT,
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}
-		} };
-	shaders[SHADER_ID_SHADOWMAP_GEOM] = { CreateShaderModule("data/shaders/shadowmapgeom.spv"), VK_SHADER_STAGE_GEOMETRY_BIT,
-		{
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 3}
-		} };
-	shaders[SHADER_ID_SHADOWMAP_FRAG] = { CreateShaderModule("data/shaders/shadowmapfrag.spv"), VK_SHADER_STAGE_FRAGMENT_BIT,
-		{
-		} };
+	shaders[SHADER_ID_BASERENDER_VERTEX] = LoadShader("data/shaders/baserender.vert");
+	shaders[SHADER_ID_BASERENDER_FRAG] = LoadShader("data/shaders/baserender.frag");
+	shaders[SHADER_ID_DEFERRED_VERTEX] = LoadShader("data/shaders/deferred.vert");
+	//msaa gbuffer is read with sampler2DMS, the resolved one with sampler2D
+	shaders[SHADER_ID_DEFERRED_FRAG] = LoadShader(edgeLighting ? "data/shaders/deferredpixel.frag" : "data/shaders/deferred.frag");
+	shaders[SHADER_ID_DIFFUSE_VERTEX] = LoadShader("data/shaders/cuberender.vert");
+	shaders[SHADER_ID_DIFFUSE_FRAG] = LoadShader("data/shaders/cuberender.frag");
+	shaders[SHADER_ID_SHADOWMAP_VERTEX] = LoadShader("data/shaders/shadowmap.vert");
+	shaders[SHADER_ID_SHADOWMAP_GEOM] = LoadShader("data/shaders/shadowmap.geom");
+
+	if (Settings::mergedDeferred)
+	{
+		shaders[SHADER_ID_DEFERRED_SUBPASS_FRAG] = LoadShader("data/shaders/deferredsubpass.frag");
+
+		programs[PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS] = { SHADER_ID_DEFERRED_VERTEX, SHADER_ID_DEFERRED_SUBPASS_FRAG };
+	}
+
+	if (edgeLighting)
+	{
+		shaders[SHADER_ID_DEFERRED_EDGE_FRAG] = LoadShader("data/shaders/deferrededge.frag");
+		shaders[SHADER_ID_DEFERRED_SAMPLE_FRAG] = LoadShader("data/shaders/deferredsample.frag");
+
+		programs[PROGRAM_ID::PROGRAM_ID_DEFERRED_EDGE] = { SHADER_ID_DEFERRED_VERTEX, SHADER_ID_DEFERRED_EDGE_FRAG };
+		programs[PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE] = { SHADER_ID_DEFERRED_VERTEX, SHADER_ID_DEFERRED_SAMPLE_FRAG };
+	}
+
+	if (Settings::temporalAA)
+	{
+		shaders[SHADER_ID_TAA_FRAG] = LoadShader("data/shaders/taa.frag");
+
+		programs[PROGRAM_ID::PROGRAM_ID_TAA] = { SHADER_ID_DEFERRED_VERTEX, SHADER_ID_TAA_FRAG };
+	}
+
+	if (Settings::shadowMoments)
+	{
+		shaders[SHADER_ID_SHADOWMOMENT_WARP_COMP] = LoadShader("data/shaders/shadowmomentwarp.comp");
+		shaders[SHADER_ID_SHADOWMOMENT_BLUR_COMP] = LoadShader("data/shaders/shadowmomentblur.comp");
+
+		programs[PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_WARP] = { SHADER_ID_SHADOWMOMENT_WARP_COMP };
+		programs[PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_BLUR] = { SHADER_ID_SHADOWMOMENT_BLUR_COMP };
+	}
 
 	programs[PROGRAM_ID::PROGRAM_ID_BASERENDER] = { SHADER_ID_BASERENDER_VERTEX, SHADER_ID_BASERENDER_FRAG };
 	programs[PROGRAM_ID::PROGRAM_ID_DEFERRED] = { SHADER_ID_DEFERRED_VERTEX, SHADER_ID_DEFERRED_FRAG };
 	programs[PROGRAM_ID::PROGRAM_ID_DIFFUSE] = { SHADER_ID_DIFFUSE_VERTEX, SHADER_ID_DIFFUSE_FRAG };
-	programs[PROGRAM_ID::PROGRAM_ID_SHADOWMAP] = { SHADER_ID_SHADOWMAP_VERTEX, SHADER_ID_SHADOWMAP_GEOM, SHADER_ID_SHADOWMAP_FRAG };
+	programs[PROGRAM_ID::PROGRAM_ID_SHADOWMAP] = { SHADER_ID_SHADOWMAP_VERTEX, SHADER_ID_SHADOWMAP_GEOM };
 
-	SetupShaderPrograms(programs);
+	SetupShaderPrograms(programs, framecount);
 }
 
 void DescriptorManager::close()
 {
-	vkDestroyDescriptorPool(vulkanDevice, vulkanDescriptorPool, nullptr);
+	descriptorAllocator->close();
+	delete descriptorAllocator;
+	descriptorAllocator = nullptr;
 
-	for (auto setlayout : vulkanDescriptorSetLayouts)
+	for (auto& [setlayout, updatetemplate] : updateTemplateCache)
+	{
+		vkDestroyDescriptorUpdateTemplate(vulkanDevice, updatetemplate, nullptr);
+	}
+	updateTemplateCache.clear();
+
+	for (auto& [key, setlayout] : descriptorSetLayoutCache)
 	{
 		vkDestroyDescriptorSetLayout(vulkanDevice, setlayout, nullptr);
 	}
-	vulkanDescriptorSetLayouts.clear();
+	descriptorSetLayoutCache.clear();
+	vulkanDescriptorSetLayouts = {};
 
-	for (auto pipelinelayout : vulkanPipelineLayouts)
+	for (auto& [key, pipelinelayout] : pipelineLayoutCache)
 	{
 		vkDestroyPipelineLayout(vulkanDevice, pipelinelayout, nullptr);
 	}
+	pipelineLayoutCache.clear();
 	vulkanPipelineLayouts.clear();
 
 	for (auto shader : shaders)
@@ -82,16 +137,14 @@ void DescriptorManager::close()
 	}
 }
 
-void DescriptorManager::SetupShaderPrograms(const std::array<std::vector<SHADER_ID>, PROGRAM_ID::PROGRAM_ID_MAX>& programs)
+void DescriptorManager::SetupShaderPrograms(const std::array<std::vector<SHADER_ID>, PROGRAM_ID::PROGRAM_ID_MAX>& programs, uint32_t framecount)
 {
-	std::vector<VkDescriptorPoolSize> poolSizes{};
+	//bindings of every program and tier ordered by binding, CreateDescriptorSet reads its data in this order
+	std::array<std::array<std::map<uint32_t, VkDescriptorSetLayoutBinding>, DESCRIPTOR_SET_TIER_MAX>, PROGRAM_ID_MAX> programBindings;
 
-	uint32_t programindex = 0;
-	for (auto program : programs)
+	for (uint32_t programindex = 0; programindex < PROGRAM_ID_MAX; ++programindex)
 	{
-		std::vector<VkDescriptorSetLayoutBinding> layoutbindings;
-
-		for (auto ID : program)
+		for (auto ID : programs[programindex])
 		{
 			VkShaderStageFlags stagebits = shaders[ID].stage;
 
@@ -102,103 +155,251 @@ void DescriptorManager::SetupShaderPrograms(const std::array<std::vector<SHADER_
 			shaderStageInfo.pName = "main";
 			programShaderStageCreateInfo[programindex].push_back(shaderStageInfo);
 
+			if (stagebits == VK_SHADER_STAGE_VERTEX_BIT) programVertexInputs[programindex] = shaders[ID].vertexInputs;
+
 			for (auto descriptor : shaders[ID].descriptors)
 			{
-				bool repeated = false;
-				for (auto& binding : layoutbindings)
-				{
-					if (descriptor.binding == binding.binding && descriptor.type == binding.descriptorType)
-					{
-						binding.stageFlags |= stagebits;
-						repeated = true;
-						break;
-					}
-				}
+				VkDescriptorSetLayoutBinding binding{};
+				binding.binding = descriptor.binding;
+				binding.descriptorCount = descriptor.count;
+				binding.descriptorType = descriptor.type;
+				binding.stageFlags = stagebits;
+				binding.pImmutableSamplers = nullptr;
+
+				programTiers[programindex] |= 1u << descriptor.set;
 
-				bool countzero = true;
-				for (auto& pool : poolSizes)
+				auto [found, inserted] = programBindings[programindex][descriptor.set].try_emplace(descriptor.binding, binding);
+				if (inserted) continue;
+
+				if (found->second.descriptorType != descriptor.type || found->second.descriptorCount != descriptor.count)
 				{
-					if (pool.type == descriptor.type)
-					{
-						++pool.descriptorCount;
-						countzero = false;
-						break;
-					}
+					throw std::runtime_error("binding " + std::to_string(descriptor.binding) + " of set " + std::to_string(descriptor.set) + " is declared differently by the stages of a program!");
 				}
-				if (countzero)
+				found->second.stageFlags |= stagebits;
+			}
+
+			//the block has to be DrawPushConstants or a prefix of it, anything else would read past the pushed bytes
+			if (shaders[ID].pushConstantSize > DRAW_PUSH_CONSTANT_RANGE.size)
+			{
+				throw std::runtime_error("push constant block of shader " + std::to_string(ID) + " is " + std::to_string(shaders[ID].pushConstantSize) +
+					" bytes, the pipeline layouts only have " + std::to_string(DRAW_PUSH_CONSTANT_RANGE.size) + "!");
+			}
+		}
+	}
+
+	for (DESCRIPTOR_SET_TIER tier : SHARED_TIERS)
+	{
+		std::map<uint32_t, VkDescriptorSetLayoutBinding> merged;
+		for (uint32_t programindex = 0; programindex < PROGRAM_ID_MAX; ++programindex)
+		{
+			for (const auto& [index, binding] : programBindings[programindex][tier])
+			{
+				auto [found, inserted] = merged.try_emplace(index, binding);
+				if (!inserted && (found->second.descriptorType != binding.descriptorType || found->second.descriptorCount != binding.descriptorCount))
 				{
-					VkDescriptorPoolSize poolsize;
-					poolsize.type = descriptor.type;
-					poolsize.descriptorCount = 1;
-					poolSizes.push_back(poolsize);
+					throw std::runtime_error("binding " + std::to_string(index) + " of set " + std::to_string(tier) + " is declared differently by two programs!");
 				}
+				found->second.stageFlags = VK_SHADER_STAGE_ALL;
+			}
+		}
 
-				if (repeated) continue;
+		for (uint32_t programindex = 0; programindex < PROGRAM_ID_MAX; ++programindex)
+		{
+			if (!programs[programindex].empty()) programBindings[programindex][tier] = merged;
+		}
+	}
 
-				VkDescriptorSetLayoutBinding binding;
-				binding.binding = descriptor.binding;
-				binding.descriptorCount = descriptor.count;
-				binding.descriptorType = descriptor.type;
-				binding.stageFlags = stagebits;
-				binding.pImmutableSamplers = nullptr;
-				layoutbindings.push_back(binding);
-				programsDescriptor[programindex].push_back({ descriptor.type, descriptor.binding, descriptor.count });
+	for (const auto& group : SHARED_LAYOUT_PROGRAMS)
+	{
+		std::map<uint32_t, VkDescriptorSetLayoutBinding> merged;
+		for (PROGRAM_ID id : group)
+		{
+			for (const auto& [index, binding] : programBindings[id][DESCRIPTOR_SET_TIER_PASS])
+			{
+				auto [found, inserted] = merged.try_emplace(index, binding);
+				if (!inserted) found->second.stageFlags |= binding.stageFlags;
 			}
 		}
 
-		VkDescriptorSetLayoutCreateInfo layoutInfo{};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutInfo.bindingCount = static_cast<uint32_t>(layoutbindings.size());
-		layoutInfo.pBindings = layoutbindings.data();
+		for (PROGRAM_ID id : group)
+		{
+			if (!programs[id].empty()) programBindings[id][DESCRIPTOR_SET_TIER_PASS] = merged;
+		}
+	}
 
-		if (vkCreateDescriptorSetLayout(vulkanDevice, &layoutInfo, nullptr, &setlayout) != VK_SUCCESS)
+	for (uint32_t programindex = 0; programindex < PROGRAM_ID_MAX; ++programindex)
+	{
+		for (uint32_t tier = 0; tier < DESCRIPTOR_SET_TIER_MAX; ++tier)
 		{
-			throw std::runtime_error("failed to create descriptor set layout!");
+			std::vector<VkDescriptorSetLayoutBinding> layoutbindings;
+			for (const auto& [index, binding] : programBindings[programindex][tier])
+			{
+				layoutbindings.push_back(binding);
+				programsDescriptor[programindex][tier].push_back({ binding.descriptorType, binding.binding, binding.descriptorCount, tier });
+			}
+
+			VkDescriptorSetLayout setlayout = GetCachedSetLayout(layoutbindings);
+			vulkanDescriptorSetLayouts[programindex][tier] = setlayout;
+			updateTemplates[programindex][tier] = GetCachedUpdateTemplate(setlayout, programsDescriptor[programindex][tier]);
 		}
 
-		vulkanDescriptorSetLayouts.push_back(setlayout);
+		vulkanPipelineLayouts.push_back(GetCachedPipelineLayout(vulkanDescriptorSetLayouts[programindex]));
+	}
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;// static_cast<uint32_t>(vulkanDescriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = &setlayout;// vulkanDescriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 0;
-		pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	//first pool holds one set per DESCRIPTORSET_LAYOUTS entry whose program is loaded, the allocator grows from there
+	std::vector<VkDescriptorPoolSize> poolSizes{};
+	uint32_t setcount = 0;
 
-		VkPipelineLayout pipelineLayout;
+	for (const auto& [id, tier] : DESCRIPTORSET_LAYOUTS)
+	{
+		if (programs[id].empty()) continue;
+		++setcount;
 
-		if (vkCreatePipelineLayout(vulkanDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		for (const auto& descriptor : programsDescriptor[id][tier])
 		{
-			throw std::runtime_error("Failed to create pipelinelayout");
+			auto pool = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == descriptor.type; });
+			if (pool != poolSizes.end())
+			{
+				pool->descriptorCount += descriptor.count;
+			}
+			else
+			{
+				poolSizes.push_back({ descriptor.type, descriptor.count });
+			}
 		}
+	}
 
-		vulkanPipelineLayouts.push_back(pipelineLayout);
+	descriptorAllocator = new DescriptorAllocator(vulkanDevice);
+	descriptorAllocator->init(poolSizes, setcount, framecount);
+}
 
-		++programindex;
+VkDescriptorSetLayout DescriptorManager::GetCachedSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	std::vector<uint32_t> key;
+	for (const auto& binding : bindings)
+	{
+		key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
 	}
 
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = 16; //hardcoded for now
+	if (auto found = descriptorSetLayoutCache.find(key); found != descriptorSetLayoutCache.end()) return found->second;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout setlayout;
 
-	if (vkCreateDescriptorPool(vulkanDevice, &poolInfo, nullptr, &vulkanDescriptorPool) != VK_SUCCESS)
+	if (vkCreateDescriptorSetLayout(vulkanDevice, &layoutInfo, nullptr, &setlayout) != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to create descriptor pool!");
+		throw std::runtime_error("failed to create descriptor set layout!");
 	}
+
+	descriptorSetLayoutCache[key] = setlayout;
+
+	return setlayout;
 }
 
-VkShaderModule DescriptorManager::CreateShaderModule(const char* filename)
+VkPipelineLayout DescriptorManager::GetCachedPipelineLayout(const std::array<VkDescriptorSetLayout, DESCRIPTOR_SET_TIER_MAX>& setlayouts)
 {
-	VkShaderModule shaderModule;
+	std::vector<uint32_t> key;
+	for (VkDescriptorSetLayout setlayout : setlayouts)
+	{
+		uint64_t handle = reinterpret_cast<uint64_t>(setlayout);
+		key.insert(key.end(), { static_cast<uint32_t>(handle), static_cast<uint32_t>(handle >> 32) });
+	}
+
+	if (auto found = pipelineLayoutCache.find(key); found != pipelineLayoutCache.end()) return found->second;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setlayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setlayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &DRAW_PUSH_CONSTANT_RANGE;
+
+	VkPipelineLayout pipelineLayout;
+
+	if (vkCreatePipelineLayout(vulkanDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create pipelinelayout");
+	}
+
+	pipelineLayoutCache[key] = pipelineLayout;
+
+	return pipelineLayout;
+}
+
+VkDescriptorUpdateTemplate DescriptorManager::GetCachedUpdateTemplate(VkDescriptorSetLayout setlayout, const std::vector<Descriptor>& descriptors)
+{
+	if (descriptors.empty()) return VK_NULL_HANDLE;
+
+	if (auto found = updateTemplateCache.find(setlayout); found != updateTemplateCache.end()) return found->second;
+
+	std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	size_t dataindex = 0;
+	for (const auto& descriptor : descriptors)
+	{
+		VkDescriptorUpdateTemplateEntry entry{};
+		entry.dstBinding = descriptor.binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = descriptor.count;
+		entry.descriptorType = descriptor.type;
+		entry.offset = dataindex * sizeof(DescriptorWrite);
+		entry.stride = sizeof(DescriptorWrite);
+		entries.push_back(entry);
+
+		dataindex += descriptor.count;
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateInfo.pDescriptorUpdateEntries = entries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = setlayout;
+
+	VkDescriptorUpdateTemplate updatetemplate;
+
+	if (vkCreateDescriptorUpdateTemplate(vulkanDevice, &templateInfo, nullptr, &updatetemplate) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor update template!");
+	}
+
+	updateTemplateCache[setlayout] = updatetemplate;
+
+	return updatetemplate;
+}
+
+Shader DescriptorManager::LoadShader(const std::string& filename)
+{
+	std::vector<uint32_t> code = ShaderCompiler::LoadSPIRV(filename);
+	ShaderReflectionData reflection = ShaderReflection::Reflect(code);
+
+	Shader shader;
+	shader.shadermodule = CreateShaderModule(code);
+	shader.stage = reflection.stage;
+	shader.pushConstantSize = reflection.pushConstantSize;
+	shader.vertexInputs = reflection.vertexInputs;
+
+	for (const auto& descriptor : reflection.descriptors)
+	{
+		if (descriptor.set >= DESCRIPTOR_SET_TIER_MAX) throw std::runtime_error(filename + " uses descriptor set " + std::to_string(descriptor.set) + ", there are only " + std::to_string(DESCRIPTOR_SET_TIER_MAX) + " tiers!");
+
+		shader.descriptors.push_back({ descriptor.type, descriptor.binding, descriptor.count, descriptor.set });
+	}
+
+	return shader;
+}
 
-	std::vector<char> code = Helper::readFile(filename);
+VkShaderModule DescriptorManager::CreateShaderModule(const std::vector<uint32_t>& code)
+{
+	VkShaderModule shaderModule;
 
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	createInfo.codeSize = code.size() * sizeof(uint32_t);
+	createInfo.pCode = code.data();
 
 	if (vkCreateShaderModule(vulkanDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
 	{
@@ -215,60 +416,79 @@ VkPipelineLayout DescriptorManager::GetpipeLineLayout(const PROGRAM_ID& id) cons
 	return vulkanPipelineLayouts[id];
 }
 
-VkDescriptorPool DescriptorManager::GetdescriptorPool() const
+DescriptorSet* DescriptorManager::CreateDescriptorSet(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier, const std::vector<DescriptorData> data) const
 {
-	return vulkanDescriptorPool;
+	DescriptorSet* descriptorset = new DescriptorSet(vulkanDevice);
+	descriptorset->descriptorSet = descriptorAllocator->Allocate(vulkanDescriptorSetLayouts[id][tier]);
+	descriptorset->tier = tier;
+
+	WriteDescriptorSet(id, tier, descriptorset->descriptorSet, data);
+
+	return descriptorset;
 }
 
-DescriptorSet* DescriptorManager::CreateDescriptorSet(const PROGRAM_ID& id, const std::vector<DescriptorData> data) const
+VkDescriptorSet DescriptorManager::CreateTransientDescriptorSet(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier, const std::vector<DescriptorData>& data) const
 {
-	DescriptorSet* descriptorset = new DescriptorSet(vulkanDevice);
+	VkDescriptorSet descriptorset = descriptorAllocator->AllocateTransient(vulkanDescriptorSetLayouts[id][tier]);
+
+	WriteDescriptorSet(id, tier, descriptorset, data);
+
+	return descriptorset;
+}
 
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = vulkanDescriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = &(vulkanDescriptorSetLayouts[static_cast<int>(id)]);
+void DescriptorManager::BeginFrame(uint32_t frame)
+{
+	descriptorAllocator->BeginFrame(frame);
+}
 
-	if (vkAllocateDescriptorSets(vulkanDevice, &allocInfo, &descriptorset->descriptorSet) != VK_SUCCESS)
+void DescriptorManager::WriteDescriptorSet(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier, VkDescriptorSet descriptorset, const std::vector<DescriptorData>& data) const
+{
+	uint32_t descriptorcount = 0;
+	for (const auto& descriptor : programsDescriptor[id][tier])
 	{
-		throw std::runtime_error("failed to allocate descriptor sets!");
+		descriptorcount += descriptor.count;
+	}
+	//the layout comes from the SPIR-V, a mismatch here usually means the .spv is older than its source
+	if (descriptorcount != data.size())
+	{
+		throw std::runtime_error("set " + std::to_string(tier) + " of program " + std::to_string(id) + " reflects " + std::to_string(descriptorcount) +
+			" descriptors but " + std::to_string(data.size()) + " were given, rebuild the shaders if the .spv files are stale!");
 	}
 
-	std::vector<VkWriteDescriptorSet> descriptorWrites{};
+	if (descriptorcount == 0) return;
 
-	//if (programsDescriptor[id].size() != data.size()) throw std::runtime_error("the descriptor size of target shader program is different with data size");
+	//packed in binding order, the template of the program says where each binding starts
+	std::vector<DescriptorWrite> writes(data.size());
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		if (data[i].bufferinfo.has_value()) writes[i].buffer = data[i].bufferinfo.value();
+		else if (data[i].imageinfo.has_value()) writes[i].image = data[i].imageinfo.value();
+	}
+
+	vkUpdateDescriptorSetWithTemplate(vulkanDevice, descriptorset, updateTemplates[id][tier], writes.data());
+}
 
-	uint32_t dataindex = 0;
-	for (auto descriptor : programsDescriptor[id])
+void DescriptorManager::UpdateDescriptorSet(const PROGRAM_ID& id, DescriptorSet* descriptorset, uint32_t binding, const DescriptorData& data) const
+{
+	for (auto descriptor : programsDescriptor[id][descriptorset->tier])
 	{
-		VkWriteDescriptorSet descriptorwrite;
+		if (descriptor.binding != binding) continue;
+
+		VkWriteDescriptorSet descriptorwrite{};
 		descriptorwrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorwrite.dstSet = descriptorset->descriptorSet;
 		descriptorwrite.dstBinding = descriptor.binding;
+		descriptorwrite.dstArrayElement = 0;
 		descriptorwrite.descriptorType = descriptor.type;
 		descriptorwrite.descriptorCount = 1;
-		descriptorwrite.pTexelBufferView = nullptr;
-		descriptorwrite.pNext = nullptr;
+		descriptorwrite.pBufferInfo = (data.bufferinfo.has_value() ? &data.bufferinfo.value() : nullptr);
+		descriptorwrite.pImageInfo = (data.imageinfo.has_value() ? &data.imageinfo.value() : nullptr);
 
-		for (uint32_t i = 0; i < descriptor.count; ++i)
-		{
-			descriptorwrite.dstArrayElement = i;
-			descriptorwrite.pBufferInfo = (data[dataindex].bufferinfo.has_value() ? &data[dataindex].bufferinfo.value() : nullptr);
-			descriptorwrite.pImageInfo = (data[dataindex].imageinfo.has_value() ? &data[dataindex].imageinfo.value() : nullptr);
-			if (descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
-			{
-				++(descriptorset->dynamic_count);
-				descriptorset->dynamic_offset.push_back(static_cast<uint32_t>(descriptorwrite.pBufferInfo->range));
-			}
-			descriptorWrites.push_back(descriptorwrite);
-			++dataindex;
-		}
+		vkUpdateDescriptorSets(vulkanDevice, 1, &descriptorwrite, 0, nullptr);
+		return;
 	}
 
-	vkUpdateDescriptorSets(vulkanDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-
-	return descriptorset;
+	throw std::runtime_error("the binding does not exist in target shader program!");
 }
 
 std::vector<VkPipelineShaderStageCreateInfo> DescriptorManager::Getshadermodule(const PROGRAM_ID& id) const
@@ -276,9 +496,37 @@ std::vector<VkPipelineShaderStageCreateInfo> DescriptorManager::Getshadermodule(
 	return programShaderStageCreateInfo[id];
 }
 
-VkDescriptorSetLayout DescriptorManager::GetdescriptorSetLayout(const PROGRAM_ID& id) const
+VkDescriptorSetLayout DescriptorManager::GetdescriptorSetLayout(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier) const
 {
 	if (id >= PROGRAM_ID_MAX || id < 0) throw std::runtime_error("the index of pipelineLayout is incorrect!");
 
-	return vulkanDescriptorSetLayouts[id];
+	return vulkanDescriptorSetLayouts[id][tier];
+}
+
+bool DescriptorManager::UsesTier(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier) const
+{
+	return (programTiers[id] & (1u << tier)) != 0;
+}
+
+uint32_t DescriptorManager::GetCompatibleTierCount(const PROGRAM_ID& from, const PROGRAM_ID& to) const
+{
+	if (vulkanPipelineLayouts[from] == vulkanPipelineLayouts[to]) return DESCRIPTOR_SET_TIER_MAX;
+
+	//push constant ranges are the same everywhere, only the set layouts decide
+	uint32_t tier = 0;
+	while (tier < DESCRIPTOR_SET_TIER_MAX && vulkanDescriptorSetLayouts[from][tier] == vulkanDescriptorSetLayouts[to][tier]) ++tier;
+
+	return tier;
+}
+
+void DescriptorManager::ValidateVertexInput(const PROGRAM_ID& id, const std::vector<VkVertexInputAttributeDescription>& attributes) const
+{
+	for (const auto& input : programVertexInputs[id])
+	{
+		auto found = std::find_if(attributes.begin(), attributes.end(), [&](const VkVertexInputAttributeDescription& attribute) { return attribute.location == input.location; });
+		if (found == attributes.end())
+		{
+			throw std::runtime_error("vertex input location " + std::to_string(input.location) + " of program " + std::to_string(id) + " has no attribute!");
+		}
+	}
 }
@@ -1,12 +1,17 @@
 #pragma once
 
+#include "ShaderReflection.hpp"
+
 //3rd party library
 #include <vulkan/vulkan.h>
+#include <glm/vec3.hpp>
 
 //standard library
 #include <vector>
 #include <array>
 #include <optional>
+#include <string>
+#include <unordered_map>
 
 enum SHADER_ID
 {
@@ -18,7 +23,12 @@ enum SHADER_ID
 	SHADER_ID_DIFFUSE_FRAG,
 	SHADER_ID_SHADOWMAP_VERTEX,
 	SHADER_ID_SHADOWMAP_GEOM,
-	SHADER_ID_SHADOWMAP_FRAG,
+	SHADER_ID_DEFERRED_SUBPASS_FRAG,
+	SHADER_ID_DEFERRED_EDGE_FRAG,
+	SHADER_ID_DEFERRED_SAMPLE_FRAG,
+	SHADER_ID_TAA_FRAG,
+	SHADER_ID_SHADOWMOMENT_WARP_COMP,
+	SHADER_ID_SHADOWMOMENT_BLUR_COMP,
 	SHADER_ID_MAX,
 };
 
@@ -28,23 +38,75 @@ enum PROGRAM_ID
 	PROGRAM_ID_DEFERRED = 1,
 	PROGRAM_ID_DIFFUSE = 2,
 	PROGRAM_ID_SHADOWMAP = 3,
+	//lighting subpass of the merged renderpass, only loaded with Settings::mergedDeferred
+	PROGRAM_ID_DEFERRED_SUBPASS = 4,
+	//msaa gbuffer lighting with Settings::msaaEdgeLighting, marks edge pixels in stencil and lights them per sample
+	//PROGRAM_ID_DEFERRED lights the remaining pixels once, all three share the pass set DESCRIPTORSET_ID_DEFERRED
+	PROGRAM_ID_DEFERRED_EDGE = 5,
+	PROGRAM_ID_DEFERRED_SAMPLE = 6,
+	//history resolve into the swapchain, only loaded with Settings::temporalAA
+	PROGRAM_ID_TAA = 7,
+	//compute, only loaded with Settings::shadowMoments
+	//depth -> moments with the horizontal blur, then the vertical blur into the moment cubemaps
+	PROGRAM_ID_SHADOWMOMENT_WARP = 8,
+	PROGRAM_ID_SHADOWMOMENT_BLUR = 9,
 	PROGRAM_ID_MAX,
 };
 
+//descriptor sets by update frequency, the set number in the shaders
+//every pipeline layout has all of them, a tier the program does not use is an empty layout
+enum DESCRIPTOR_SET_TIER
+{
+	//camera, settings and lights, one layout for every program so the set stays bound for the whole command buffer
+	DESCRIPTOR_SET_TIER_GLOBAL = 0,
+	//attachments, shadow maps and light projections of one pass
+	DESCRIPTOR_SET_TIER_PASS = 1,
+	//surface parameters, one layout for every program
+	//they still live in ObjectUniform, so this is the object storage buffer, a draw picks its element with DrawPushConstants
+	DESCRIPTOR_SET_TIER_MATERIAL = 2,
+	DESCRIPTOR_SET_TIER_MAX,
+};
+
 struct Descriptor
 {
 	VkDescriptorType type;
 	uint32_t binding;
 
 	uint32_t count = 1;
+	uint32_t set = DESCRIPTOR_SET_TIER_GLOBAL;
 };
 
+//per draw values, the one push constant range of every pipeline layout, drawconstants.glsl in the shaders
+//the material has no table of its own yet, objectIndex selects it together with the transform
+//members are ordered so the std430 block has no padding
+struct DrawPushConstants
+{
+	//object space position of a packed vertex is positionOffset + position * positionScale, see PackedPosition
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+	uint32_t objectIndex = 0;
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	//light the shadow pass renders
+	uint32_t lightIndex = 0;
+
+	bool operator==(const DrawPushConstants& other) const = default;
+};
+
+//descriptors, push constants and vertex inputs are reflected from the spir-v
 struct Shader
 {
-	VkShaderModule shadermodule;
+	VkShaderModule shadermodule = VK_NULL_HANDLE;
 
 	VkShaderStageFlags stage;
 	std::vector<Descriptor> descriptors;
+
+	uint32_t pushConstantSize = 0;
+	std::vector<ReflectedVertexInput> vertexInputs;
+};
+
+//serialized layout, equal layouts share one vulkan object
+struct LayoutKeyHash
+{
+	size_t operator()(const std::vector<uint32_t>& key) const;
 };
 
 struct DescriptorData
@@ -61,40 +123,73 @@ struct Program
 };
 
 class DescriptorSet;
+class DescriptorAllocator;
 
 class DescriptorManager
 {
 public:
 	DescriptorManager(VkDevice device);
 
-	void init();
+	//edgeLighting selects the msaa gbuffer lighting programs, see PROGRAM_ID_DEFERRED_EDGE
+	//framecount is the number of transient descriptor frame slots
+	void init(bool edgeLighting, uint32_t framecount);
 	void close();
 
 	VkPipelineLayout GetpipeLineLayout(const PROGRAM_ID& id) const;
-	VkDescriptorSetLayout GetdescriptorSetLayout(const PROGRAM_ID& id) const;
-
-	VkDescriptorPool GetdescriptorPool() const;
-
-	DescriptorSet* CreateDescriptorSet(const PROGRAM_ID& id, const std::vector<DescriptorData> data) const;
+	VkDescriptorSetLayout GetdescriptorSetLayout(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier) const;
+	//whether a shader of the program reads the tier, sets of other tiers do not have to be bound for it
+	bool UsesTier(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier) const;
+	//sets below the returned tier stay valid when the pipeline layout changes from one program to the other
+	uint32_t GetCompatibleTierCount(const PROGRAM_ID& from, const PROGRAM_ID& to) const;
+
+	//data of the tier ordered by binding
+	DescriptorSet* CreateDescriptorSet(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier, const std::vector<DescriptorData> data) const;
+	//for per frame or per draw sets, valid until BeginFrame is called with the current frame slot again
+	VkDescriptorSet CreateTransientDescriptorSet(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier, const std::vector<DescriptorData>& data) const;
+	//once the fence of the frame slot has signaled, frees its transient sets at once
+	void BeginFrame(uint32_t frame);
+	//rewrite one binding of existing set, used when size dependent image is recreated
+	void UpdateDescriptorSet(const PROGRAM_ID& id, DescriptorSet* descriptorset, uint32_t binding, const DescriptorData& data) const;
 
 	std::vector<VkPipelineShaderStageCreateInfo> Getshadermodule(const PROGRAM_ID& id) const;
-private:
-	VkDescriptorSetLayout setlayout;
 
-	std::vector<VkDescriptorSetLayout> vulkanDescriptorSetLayouts;
+	//throws when the vertex shader of the program reads a location the attributes do not provide
+	void ValidateVertexInput(const PROGRAM_ID& id, const std::vector<VkVertexInputAttributeDescription>& attributes) const;
+private:
+	//per program and tier, programs with the same layout share the handle
+	std::array<std::array<VkDescriptorSetLayout, DESCRIPTOR_SET_TIER_MAX>, PROGRAM_ID_MAX> vulkanDescriptorSetLayouts{};
 	std::vector<VkPipelineLayout> vulkanPipelineLayouts;
+	//bit per tier read by the shaders of the program
+	std::array<uint32_t, PROGRAM_ID_MAX> programTiers{};
+
+	//owners of every layout, destroyed once each
+	std::unordered_map<std::vector<uint32_t>, VkDescriptorSetLayout, LayoutKeyHash> descriptorSetLayoutCache;
+	std::unordered_map<std::vector<uint32_t>, VkPipelineLayout, LayoutKeyHash> pipelineLayoutCache;
 
-	VkDescriptorPool vulkanDescriptorPool;
+	DescriptorAllocator* descriptorAllocator = nullptr;
+
+	//sets are written through these, programs with the same set layout share one
+	std::array<std::array<VkDescriptorUpdateTemplate, DESCRIPTOR_SET_TIER_MAX>, PROGRAM_ID_MAX> updateTemplates{};
+	std::unordered_map<VkDescriptorSetLayout, VkDescriptorUpdateTemplate> updateTemplateCache;
 	std::array<Shader, SHADER_ID_MAX> shaders;
-	std::array<std::vector<Descriptor>, PROGRAM_ID_MAX> programsDescriptor;
+	std::array<std::array<std::vector<Descriptor>, DESCRIPTOR_SET_TIER_MAX>, PROGRAM_ID_MAX> programsDescriptor;
 
 	std::array<std::vector<VkPipelineShaderStageCreateInfo>, PROGRAM_ID_MAX> programShaderStageCreateInfo;
+	std::array<std::vector<ReflectedVertexInput>, PROGRAM_ID_MAX> programVertexInputs;
 
 	std::array<std::vector<SHADER_ID>, PROGRAM_ID::PROGRAM_ID_MAX> programs;
 
 	VkDevice vulkanDevice;
 	
-	void SetupShaderPrograms(const std::array<std::vector<SHADER_ID>, PROGRAM_ID::PROGRAM_ID_MAX>& programs);
+	void SetupShaderPrograms(const std::array<std::vector<SHADER_ID>, PROGRAM_ID::PROGRAM_ID_MAX>& programs, uint32_t framecount);
+	//the data handed to CreateDescriptorSet, packed and written with the update template of the program
+	void WriteDescriptorSet(const PROGRAM_ID& id, DESCRIPTOR_SET_TIER tier, VkDescriptorSet descriptorset, const std::vector<DescriptorData>& data) const;
+
+	VkDescriptorSetLayout GetCachedSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	VkPipelineLayout GetCachedPipelineLayout(const std::array<VkDescriptorSetLayout, DESCRIPTOR_SET_TIER_MAX>& setlayouts);
+	VkDescriptorUpdateTemplate GetCachedUpdateTemplate(VkDescriptorSetLayout setlayout, const std::vector<Descriptor>& descriptors);
 
-	VkShaderModule CreateShaderModule(const char* filename);
+	//filename is the glsl source, see ShaderCompiler
+	Shader LoadShader(const std::string& filename);
+	VkShaderModule CreateShaderModule(const std::vector<uint32_t>& code);
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "DescriptorAllocator.hpp"
+
+//standard library
+#include <stdexcept>
+#include <algorithm>
+
+//pools stop doubling here, 64 times the first one
+constexpr uint32_t DESCRIPTORPOOL_MAX_SCALE = 64;
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device) : vulkanDevice(device) {}
+
+void DescriptorAllocator::init(const std::vector<VkDescriptorPoolSize>& poolsizes, uint32_t maxsets, uint32_t framecount)
+{
+	poolSizes = poolsizes;
+	maxSets = std::max(maxsets, 1u);
+
+	//transient pools are created on first use, a frame without transient sets costs nothing
+	framePools.resize(framecount);
+}
+
+void DescriptorAllocator::close()
+{
+	for (auto pool : persistentPools.pools)
+	{
+		vkDestroyDescriptorPool(vulkanDevice, pool, nullptr);
+	}
+	persistentPools = PoolChain();
+
+	for (auto& chain : framePools)
+	{
+		for (auto pool : chain.pools)
+		{
+			vkDestroyDescriptorPool(vulkanDevice, pool, nullptr);
+		}
+	}
+	framePools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	return allocate(persistentPools, layout);
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(VkDescriptorSetLayout layout)
+{
+	return allocate(framePools[currentFrame], layout);
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frame)
+{
+	currentFrame = frame;
+
+	PoolChain& chain = framePools[currentFrame];
+	for (auto pool : chain.pools)
+	{
+		vkResetDescriptorPool(vulkanDevice, pool, 0);
+	}
+	chain.current = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout)
+{
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	while (true)
+	{
+		bool newpool = (chain.current == chain.pools.size());
+		if (newpool)
+		{
+			uint32_t scale = std::min(1u << std::min(chain.current, 31u), DESCRIPTORPOOL_MAX_SCALE);
+			chain.pools.push_back(createPool(scale));
+		}
+
+		allocInfo.descriptorPool = chain.pools[chain.current];
+
+		VkDescriptorSet descriptorset;
+		VkResult result = vkAllocateDescriptorSets(vulkanDevice, &allocInfo, &descriptorset);
+
+		if (result == VK_SUCCESS) return descriptorset;
+
+		//a pool that was just created is empty, so the layout needs a type the pools are not sized for
+		if (newpool || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+		{
+			throw std::runtime_error("failed to allocate descriptor sets!");
+		}
+
+		++chain.current;
+	}
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t scale) const
+{
+	std::vector<VkDescriptorPoolSize> sizes = poolSizes;
+	for (auto& size : sizes)
+	{
+		size.descriptorCount *= scale;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+	poolInfo.pPoolSizes = sizes.data();
+	poolInfo.maxSets = maxSets * scale;
+
+	VkDescriptorPool pool;
+
+	if (vkCreateDescriptorPool(vulkanDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+
+	return pool;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//3rd party library
+#include <vulkan/vulkan.h>
+
+//standard library
+#include <vector>
+
+//descriptor pools that grow instead of failing
+//persistent sets live until close, transient sets until their frame slot comes around again
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator(VkDevice device);
+
+	//poolsizes/maxsets describe the first pool of every chain, each pool added later is twice as large as the one before
+	void init(const std::vector<VkDescriptorPoolSize>& poolsizes, uint32_t maxsets, uint32_t framecount);
+	void close();
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+	VkDescriptorSet AllocateTransient(VkDescriptorSetLayout layout);
+
+	//resets every pool of the frame slot at once, the gpu has to be done with the sets allocated the last time it was current
+	void BeginFrame(uint32_t frame);
+
+private:
+	struct PoolChain
+	{
+		std::vector<VkDescriptorPool> pools;
+		//pools before it are full
+		uint32_t current = 0;
+	};
+
+	VkDescriptorSet allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+	VkDescriptorPool createPool(uint32_t scale) const;
+
+	VkDevice vulkanDevice;
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	uint32_t maxSets = 0;
+
+	PoolChain persistentPools;
+	std::vector<PoolChain> framePools;
+	uint32_t currentFrame = 0;
+};
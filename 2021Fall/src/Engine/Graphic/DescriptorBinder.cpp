@@ -0,0 +1,77 @@
+#include "DescriptorBinder.hpp"
+#include "DescriptorSet.hpp"
+
+//standard library
+#include <stdexcept>
+#include <string>
+
+DescriptorBinder::DescriptorBinder(const DescriptorManager* manager, VkPipelineBindPoint bindPoint) : descriptorManager(manager), vulkanBindPoint(bindPoint) {}
+
+void DescriptorBinder::Begin(VkCommandBuffer commandBuffer)
+{
+	vulkanCommandBuffer = commandBuffer;
+
+	currentPipeline = VK_NULL_HANDLE;
+	currentProgram.reset();
+
+	pendingSets = {};
+	boundSets = {};
+	pushedConstants.reset();
+}
+
+void DescriptorBinder::BindPipeline(PROGRAM_ID id, VkPipeline pipeline)
+{
+	if (pipeline != currentPipeline)
+	{
+		vkCmdBindPipeline(vulkanCommandBuffer, vulkanBindPoint, pipeline);
+		currentPipeline = pipeline;
+	}
+
+	//sets from the first tier whose layout differs are disturbed
+	if (currentProgram.has_value())
+	{
+		for (uint32_t tier = descriptorManager->GetCompatibleTierCount(currentProgram.value(), id); tier < DESCRIPTOR_SET_TIER_MAX; ++tier)
+		{
+			boundSets[tier] = nullptr;
+		}
+	}
+	currentProgram = id;
+}
+
+void DescriptorBinder::SetDescriptorSet(const DescriptorSet* set)
+{
+	pendingSets[set->tier] = set;
+}
+
+void DescriptorBinder::Flush()
+{
+	if (!currentProgram.has_value()) throw std::runtime_error("descriptor sets are flushed before a pipeline is bound!");
+
+	PROGRAM_ID id = currentProgram.value();
+
+	for (uint32_t tier = 0; tier < DESCRIPTOR_SET_TIER_MAX; ++tier)
+	{
+		if (!descriptorManager->UsesTier(id, static_cast<DESCRIPTOR_SET_TIER>(tier))) continue;
+
+		const DescriptorSet* pending = pendingSets[tier];
+		if (pending == nullptr) throw std::runtime_error("program " + std::to_string(id) + " reads set " + std::to_string(tier) + " but none is set!");
+
+		if (pending == boundSets[tier]) continue;
+
+		vkCmdBindDescriptorSets(vulkanCommandBuffer, vulkanBindPoint, descriptorManager->GetpipeLineLayout(id),
+			tier, 1, &pending->descriptorSet, 0, nullptr);
+
+		boundSets[tier] = pending;
+	}
+}
+
+void DescriptorBinder::PushDrawConstants(const DrawPushConstants& constants)
+{
+	if (!currentProgram.has_value()) throw std::runtime_error("push constants are pushed before a pipeline is bound!");
+
+	if (pushedConstants == constants) return;
+
+	vkCmdPushConstants(vulkanCommandBuffer, descriptorManager->GetpipeLineLayout(currentProgram.value()), VK_SHADER_STAGE_ALL, 0, sizeof(DrawPushConstants), &constants);
+
+	pushedConstants = constants;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Descriptor.hpp"
+
+//3rd party library
+#include <vulkan/vulkan.h>
+
+//standard library
+#include <array>
+#include <optional>
+
+class DescriptorSet;
+
+//what is bound on the command buffer being recorded for one bind point
+//sets are only bound right before a draw, and only the ones that changed or were disturbed by an incompatible pipeline layout
+//so recording costs grow with state changes instead of with the object count
+class DescriptorBinder
+{
+public:
+	DescriptorBinder(const DescriptorManager* manager, VkPipelineBindPoint bindPoint);
+
+	//nothing is bound on a command buffer that just began recording
+	void Begin(VkCommandBuffer commandBuffer);
+
+	void BindPipeline(PROGRAM_ID id, VkPipeline pipeline);
+	//set for its tier, per draw data is pushed so a set never needs offsets
+	void SetDescriptorSet(const DescriptorSet* set);
+	//binds the sets the current program reads that are not bound yet, call before every draw or dispatch
+	void Flush();
+	//per draw values, only pushed when they differ from the last ones
+	void PushDrawConstants(const DrawPushConstants& constants);
+
+private:
+	const DescriptorManager* descriptorManager;
+	VkPipelineBindPoint vulkanBindPoint;
+	VkCommandBuffer vulkanCommandBuffer = VK_NULL_HANDLE;
+
+	VkPipeline currentPipeline = VK_NULL_HANDLE;
+	std::optional<PROGRAM_ID> currentProgram;
+
+	std::array<const DescriptorSet*, DESCRIPTOR_SET_TIER_MAX> pendingSets{};
+	std::array<const DescriptorSet*, DESCRIPTOR_SET_TIER_MAX> boundSets{};
+	//every layout has the same push constant range, so they outlive pipeline changes
+	std::optional<DrawPushConstants> pushedConstants;
+};
\ No newline at end of file
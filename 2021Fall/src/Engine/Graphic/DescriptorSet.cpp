@@ -1,10 +1,6 @@
 #include "DescriptorSet.hpp"
 #include "Descriptor.hpp"
 
-//standard library
-#include <stdexcept>
-#include <array>
-
 DescriptorSet::DescriptorSet(VkDevice device) : vulkanDevice(device) {}
 
 void DescriptorSet::init()
@@ -13,38 +9,14 @@ void DescriptorSet::init()
 
 void DescriptorSet::close()
 {
-    dynamic_offset.clear();
 }
 
-void DescriptorSet::BindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, std::vector<uint32_t> offset)
+uint32_t DescriptorSet::NextIndex()
 {
-    std::vector<uint32_t> memoffset;
-
-    if (offset.size() != dynamic_offset.size())
-    {
-        throw std::runtime_error("offset index is not correct!");
-    }
-
-    for (uint32_t i = 0; i < offset.size(); ++i)
-    {
-        memoffset.push_back(offset[i] * dynamic_offset[i]);
-    }
-
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-        0, 1, &descriptorSet, dynamic_count, memoffset.data());
+    return currentindex++;
 }
 
-void DescriptorSet::BindDescriptorSetNoIndex(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+void DescriptorSet::ResetIndex()
 {
-    std::vector<uint32_t> memoffset;
-
-    for (uint32_t i = 0; i < dynamic_offset.size(); ++i)
-    {
-        memoffset.push_back(currentindex * dynamic_offset[i]);
-    }
-
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-        0, 1, &descriptorSet, dynamic_count, memoffset.data());
-
-    ++currentindex;
-}
+    currentindex = 0;
+}
\ No newline at end of file
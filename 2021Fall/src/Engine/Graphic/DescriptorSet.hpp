@@ -3,12 +3,10 @@
 //3rd party library
 #include <vulkan/vulkan.h>
 
-//standard library
-#include <vector>
-
 struct Descriptor;
 
 class DescriptorManager;
+class DescriptorBinder;
 
 class DescriptorSet
 {
@@ -19,17 +17,19 @@ public:
 	void close();
 
 public:
-	void BindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, std::vector<uint32_t> offset);
-	void BindDescriptorSetNoIndex(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+	//objects take the next element of the object buffer every time they are recorded
+	uint32_t NextIndex();
+	//start from first object again when command buffers are recorded once more
+	void ResetIndex();
 
 private:
 	friend class DescriptorManager;
+	friend class DescriptorBinder;
 
 	VkDevice vulkanDevice;
 	VkDescriptorSet descriptorSet;
-
-	uint32_t dynamic_count = 0;
-	std::vector<uint32_t> dynamic_offset;
+	//DESCRIPTOR_SET_TIER of the layout it was allocated with
+	uint32_t tier = 0;
 
 	uint32_t currentindex = 0;
 };
\ No newline at end of file
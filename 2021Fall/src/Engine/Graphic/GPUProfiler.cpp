@@ -0,0 +1,551 @@
+#include "GPUProfiler.hpp"
+
+//standard library
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+//3rd party library
+#include <imgui/imgui.h>
+
+constexpr const char* PROFILER_DIRECTORY = "data/profile/";
+
+constexpr uint32_t NO_RANGE = UINT32_MAX;
+
+constexpr VkQueryPipelineStatisticFlags PROFILER_STATISTIC_FLAGS =
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+//same order as PIPELINE_STATISTIC_INDEX, vulkan writes the results in bit order
+constexpr std::array<const char*, STATISTIC_MAX> STATISTIC_NAMES = {
+	"ia_primitives",
+	"vs_invocations",
+	"gs_invocations",
+	"clipping_primitives",
+	"fs_invocations",
+};
+
+GPUProfiler::GPUProfiler(VkDevice device) : vulkanDevice(device) {}
+
+void GPUProfiler::init(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+
+	//graphic queue is the first family with graphic bit, same as Application::findQueueFamilies
+	uint32_t validBits = 0;
+	{
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		for (const auto& queueFamily : queueFamilies)
+		{
+			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			{
+				validBits = queueFamily.timestampValidBits;
+				break;
+			}
+		}
+	}
+
+	timestampSupported = (validBits != 0) && (properties.limits.timestampPeriod > 0.0f);
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+
+	statisticsSupported = timestampSupported && (features.pipelineStatisticsQuery == VK_TRUE);
+
+	if (!timestampSupported)
+	{
+		std::cout << "gpu profiler disabled (timestamp query not supported on graphic queue)" << std::endl;
+	}
+}
+
+void GPUProfiler::close()
+{
+	destroyQueryPools();
+	slots.clear();
+}
+
+void GPUProfiler::SetSlotCount(uint32_t count)
+{
+	destroyQueryPools();
+
+	slots.clear();
+	slots.resize(count);
+
+	createQueryPools();
+}
+
+void GPUProfiler::BeginRecord(uint32_t slot, VkCommandBuffer cmdBuffer)
+{
+	if (!timestampSupported) return;
+
+	//previous recording is being replaced, keep its result if it is already there
+	collectSlot(slot);
+
+	ProfileSlot& profileslot = slots[slot];
+	profileslot.ranges.clear();
+	profileslot.openRanges.clear();
+	profileslot.statisticsCount = 0;
+	profileslot.pending = false;
+
+	vkCmdResetQueryPool(cmdBuffer, timestampPool, slot * PROFILER_MAX_SCOPE_PER_SLOT * 2, PROFILER_MAX_SCOPE_PER_SLOT * 2);
+	if (statisticsSupported)
+	{
+		vkCmdResetQueryPool(cmdBuffer, statisticsPool, slot * PROFILER_MAX_SCOPE_PER_SLOT, PROFILER_MAX_SCOPE_PER_SLOT);
+	}
+}
+
+void GPUProfiler::BeginScope(uint32_t slot, VkCommandBuffer cmdBuffer, const std::string& name, bool pipelineStatistics)
+{
+	if (!timestampSupported) return;
+
+	ProfileSlot& profileslot = slots[slot];
+
+	if (profileslot.ranges.size() >= PROFILER_MAX_SCOPE_PER_SLOT)
+	{
+		//keep begin/end balanced, this scope is just not measured
+		profileslot.openRanges.push_back(NO_RANGE);
+		return;
+	}
+
+	uint32_t rangeindex = static_cast<uint32_t>(profileslot.ranges.size());
+
+	ProfileSlot::Range range;
+	range.scope = findScope(name);
+	range.topLevel = profileslot.openRanges.empty();
+
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, (slot * PROFILER_MAX_SCOPE_PER_SLOT + rangeindex) * 2);
+
+	if (pipelineStatistics && statisticsSupported)
+	{
+		range.statisticsQuery = profileslot.statisticsCount++;
+		vkCmdBeginQuery(cmdBuffer, statisticsPool, slot * PROFILER_MAX_SCOPE_PER_SLOT + range.statisticsQuery.value(), 0);
+	}
+
+	profileslot.ranges.push_back(range);
+	profileslot.openRanges.push_back(rangeindex);
+}
+
+void GPUProfiler::EndScope(uint32_t slot, VkCommandBuffer cmdBuffer)
+{
+	if (!timestampSupported) return;
+
+	ProfileSlot& profileslot = slots[slot];
+
+	if (profileslot.openRanges.empty())
+	{
+		throw std::runtime_error("EndScope without matching BeginScope!");
+	}
+
+	uint32_t rangeindex = profileslot.openRanges.back();
+	profileslot.openRanges.pop_back();
+
+	if (rangeindex == NO_RANGE) return;
+
+	const ProfileSlot::Range& range = profileslot.ranges[rangeindex];
+
+	if (range.statisticsQuery.has_value())
+	{
+		vkCmdEndQuery(cmdBuffer, statisticsPool, slot * PROFILER_MAX_SCOPE_PER_SLOT + range.statisticsQuery.value());
+	}
+
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, (slot * PROFILER_MAX_SCOPE_PER_SLOT + rangeindex) * 2 + 1);
+}
+
+void GPUProfiler::Submit(uint32_t slot)
+{
+	if (!timestampSupported) return;
+
+	//the previous submission of this command buffer has finished before it can be submitted again
+	collectSlot(slot);
+
+	slots[slot].pending = true;
+	slots[slot].submitFrame = currentFrame;
+}
+
+void GPUProfiler::SetFrame(uint64_t frame)
+{
+	currentFrame = frame;
+}
+
+void GPUProfiler::BeginRecording(uint64_t frame)
+{
+	recordStart = frame;
+	recordedFrames.clear();
+
+	for (ProfileScope& scope : scopes)
+	{
+		scope.recorded.clear();
+	}
+}
+
+void GPUProfiler::EndRecording()
+{
+	recordStart.reset();
+}
+
+const std::vector<float>& GPUProfiler::GetRecordedFrames() const
+{
+	return recordedFrames;
+}
+
+const std::vector<ProfileScope>& GPUProfiler::GetScopes() const
+{
+	return scopes;
+}
+
+void GPUProfiler::Collect()
+{
+	if (!timestampSupported) return;
+
+	for (uint32_t slot = 0; slot < slots.size(); ++slot)
+	{
+		collectSlot(slot);
+	}
+}
+
+bool GPUProfiler::IsEnabled() const
+{
+	return timestampSupported;
+}
+
+bool GPUProfiler::IsStatisticsSupported() const
+{
+	return statisticsSupported;
+}
+
+ProfileScopeStat GPUProfiler::GetStat(const ProfileScope& scope) const
+{
+	ProfileScopeStat stat;
+
+	uint32_t count = std::min(scope.sampleCount, PROFILER_HISTORY_SIZE);
+	if (count == 0) return stat;
+
+	std::vector<float> sorted(scope.history.begin(), scope.history.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+
+	float sum = 0.0f;
+	for (float sample : sorted) sum += sample;
+
+	stat.last = scope.history[(scope.sampleCount - 1) % PROFILER_HISTORY_SIZE];
+	stat.min = sorted.front();
+	stat.avg = sum / count;
+	uint32_t p99index = static_cast<uint32_t>(std::ceil(count * 0.99f)) - 1;
+	stat.p99 = sorted[std::min(p99index, count - 1)];
+
+	return stat;
+}
+
+void GPUProfiler::drawGUI()
+{
+	if (!timestampSupported)
+	{
+		ImGui::Text("timestamp query not supported");
+		return;
+	}
+
+	ImGui::Checkbox("Pause##GPUProfiler", &paused);
+	ImGui::SameLine();
+
+	std::string basename = PROFILER_DIRECTORY + std::string("gpu_") +
+		std::to_string(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+	if (ImGui::Button("Export CSV##GPUProfiler"))
+	{
+		ExportCSV(basename + ".csv");
+	} ImGui::SameLine();
+	if (ImGui::Button("Export JSON##GPUProfiler"))
+	{
+		ExportJSON(basename + ".json");
+	}
+
+	if (ImGui::BeginTable("Timing##GPUProfiler", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("Last(ms)");
+		ImGui::TableSetupColumn("Min(ms)");
+		ImGui::TableSetupColumn("Avg(ms)");
+		ImGui::TableSetupColumn("P99(ms)");
+		ImGui::TableHeadersRow();
+
+		for (const auto& scope : scopes)
+		{
+			ProfileScopeStat stat = GetStat(scope);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", scope.name.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", stat.last);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", stat.min);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", stat.avg);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", stat.p99);
+		}
+
+		ImGui::EndTable();
+	}
+
+	if (ImGui::TreeNode("History##GPUProfiler"))
+	{
+		for (const auto& scope : scopes)
+		{
+			uint32_t count = std::min(scope.sampleCount, PROFILER_HISTORY_SIZE);
+			//oldest sample is right after the newest once the ring is full
+			int offset = (scope.sampleCount > PROFILER_HISTORY_SIZE) ? static_cast<int>(scope.sampleCount % PROFILER_HISTORY_SIZE) : 0;
+			ImGui::PlotLines(scope.name.c_str(), scope.history.data(), static_cast<int>(count), offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+		}
+		ImGui::TreePop();
+	}
+
+	if (statisticsSupported && ImGui::TreeNode("Pipeline Statistics##GPUProfiler"))
+	{
+		for (const auto& scope : scopes)
+		{
+			if (!scope.statistics.has_value()) continue;
+
+			ImGui::Text("%s", scope.name.c_str());
+			for (uint32_t i = 0; i < STATISTIC_MAX; ++i)
+			{
+				ImGui::BulletText("%s : %llu", STATISTIC_NAMES[i], static_cast<unsigned long long>(scope.statistics.value()[i]));
+			}
+		}
+		ImGui::TreePop();
+	}
+}
+
+void GPUProfiler::ExportCSV(const std::string& filename) const
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "failed to write gpu profile " << filename << std::endl;
+		return;
+	}
+
+	file << "scope,sample,gpu_ms\n";
+	for (const auto& scope : scopes)
+	{
+		uint32_t count = std::min(scope.sampleCount, PROFILER_HISTORY_SIZE);
+		uint32_t first = scope.sampleCount - count;
+		for (uint32_t i = first; i < scope.sampleCount; ++i)
+		{
+			file << scope.name << "," << i << "," << scope.history[i % PROFILER_HISTORY_SIZE] << "\n";
+		}
+	}
+
+	std::cout << "gpu profile written to " << filename << std::endl;
+}
+
+void GPUProfiler::ExportJSON(const std::string& filename) const
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "failed to write gpu profile " << filename << std::endl;
+		return;
+	}
+
+	file << "{\n\t\"scopes\": [";
+	for (size_t scopeindex = 0; scopeindex < scopes.size(); ++scopeindex)
+	{
+		const ProfileScope& scope = scopes[scopeindex];
+		ProfileScopeStat stat = GetStat(scope);
+
+		//scope names are engine defined identifiers, no escaping needed
+		file << (scopeindex == 0 ? "\n" : ",\n");
+		file << "\t\t{\n\t\t\t\"name\": \"" << scope.name << "\",\n";
+		file << "\t\t\t\"min_ms\": " << stat.min << ",\n";
+		file << "\t\t\t\"avg_ms\": " << stat.avg << ",\n";
+		file << "\t\t\t\"p99_ms\": " << stat.p99 << ",\n";
+
+		if (scope.statistics.has_value())
+		{
+			file << "\t\t\t\"statistics\": {";
+			for (uint32_t i = 0; i < STATISTIC_MAX; ++i)
+			{
+				file << (i == 0 ? " " : ", ") << "\"" << STATISTIC_NAMES[i] << "\": " << scope.statistics.value()[i];
+			}
+			file << " },\n";
+		}
+
+		file << "\t\t\t\"samples_ms\": [";
+		uint32_t count = std::min(scope.sampleCount, PROFILER_HISTORY_SIZE);
+		uint32_t first = scope.sampleCount - count;
+		for (uint32_t i = first; i < scope.sampleCount; ++i)
+		{
+			file << (i == first ? "" : ", ") << scope.history[i % PROFILER_HISTORY_SIZE];
+		}
+		file << "]\n\t\t}";
+	}
+	file << "\n\t]\n}\n";
+
+	std::cout << "gpu profile written to " << filename << std::endl;
+}
+
+void GPUProfiler::createQueryPools()
+{
+	if (!timestampSupported || slots.empty()) return;
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = static_cast<uint32_t>(slots.size()) * PROFILER_MAX_SCOPE_PER_SLOT * 2;
+
+	if (vkCreateQueryPool(vulkanDevice, &queryPoolInfo, nullptr, &timestampPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+
+	if (statisticsSupported)
+	{
+		queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		queryPoolInfo.queryCount = static_cast<uint32_t>(slots.size()) * PROFILER_MAX_SCOPE_PER_SLOT;
+		queryPoolInfo.pipelineStatistics = PROFILER_STATISTIC_FLAGS;
+
+		if (vkCreateQueryPool(vulkanDevice, &queryPoolInfo, nullptr, &statisticsPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline statistics query pool!");
+		}
+	}
+}
+
+void GPUProfiler::destroyQueryPools()
+{
+	vkDestroyQueryPool(vulkanDevice, timestampPool, nullptr);
+	timestampPool = VK_NULL_HANDLE;
+
+	vkDestroyQueryPool(vulkanDevice, statisticsPool, nullptr);
+	statisticsPool = VK_NULL_HANDLE;
+}
+
+bool GPUProfiler::collectSlot(uint32_t slot)
+{
+	ProfileSlot& profileslot = slots[slot];
+
+	if (!profileslot.pending) return true;
+
+	uint32_t rangecount = static_cast<uint32_t>(profileslot.ranges.size());
+
+	//value followed by availability for every query
+	std::vector<uint64_t> timestamps(rangecount * 2 * 2);
+	if (rangecount > 0)
+	{
+		VkResult result = vkGetQueryPoolResults(vulkanDevice, timestampPool, slot * PROFILER_MAX_SCOPE_PER_SLOT * 2, rangecount * 2,
+			timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result != VK_SUCCESS && result != VK_NOT_READY) return false;
+
+		for (uint32_t i = 0; i < rangecount * 2; ++i)
+		{
+			if (timestamps[i * 2 + 1] == 0) return false;
+		}
+	}
+
+	constexpr uint32_t STATISTIC_STRIDE = STATISTIC_MAX + 1;
+	std::vector<uint64_t> statistics(profileslot.statisticsCount * STATISTIC_STRIDE);
+	if (profileslot.statisticsCount > 0)
+	{
+		VkResult result = vkGetQueryPoolResults(vulkanDevice, statisticsPool, slot * PROFILER_MAX_SCOPE_PER_SLOT, profileslot.statisticsCount,
+			statistics.size() * sizeof(uint64_t), statistics.data(), sizeof(uint64_t) * STATISTIC_STRIDE, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result != VK_SUCCESS && result != VK_NOT_READY) return false;
+
+		for (uint32_t i = 0; i < profileslot.statisticsCount; ++i)
+		{
+			if (statistics[i * STATISTIC_STRIDE + STATISTIC_MAX] == 0) return false;
+		}
+	}
+
+	profileslot.pending = false;
+
+	bool recording = recordStart.has_value() && profileslot.submitFrame >= recordStart.value();
+
+	if (paused && !recording) return true;
+
+	//sum ranges of the same scope, e.g. one shadow renderpass per light
+	std::vector<std::optional<float>> scopetime(scopes.size());
+	std::vector<std::optional<std::array<uint64_t, STATISTIC_MAX>>> scopestatistics(scopes.size());
+	float toplevel = 0.0f;
+	for (uint32_t i = 0; i < rangecount; ++i)
+	{
+		const ProfileSlot::Range& range = profileslot.ranges[i];
+
+		uint64_t begin = timestamps[(i * 2) * 2];
+		uint64_t end = timestamps[(i * 2 + 1) * 2];
+		float ms = static_cast<float>((end - begin) & timestampMask) * timestampPeriod / 1000000.0f;
+
+		scopetime[range.scope] = scopetime[range.scope].value_or(0.0f) + ms;
+		if (range.topLevel) toplevel += ms;
+
+		if (range.statisticsQuery.has_value())
+		{
+			//emplace zeroes the counters on the first range of the scope
+			if (!scopestatistics[range.scope].has_value()) scopestatistics[range.scope].emplace();
+
+			std::array<uint64_t, STATISTIC_MAX>& values = scopestatistics[range.scope].value();
+			for (uint32_t statistic = 0; statistic < STATISTIC_MAX; ++statistic)
+			{
+				values[statistic] += statistics[range.statisticsQuery.value() * STATISTIC_STRIDE + statistic];
+			}
+		}
+	}
+
+	if (recording)
+	{
+		//nested scopes are already inside their parent, only top level ranges add up to the frame
+		uint64_t frameindex = profileslot.submitFrame - recordStart.value();
+		if (recordedFrames.size() <= frameindex) recordedFrames.resize(frameindex + 1, 0.0f);
+		recordedFrames[frameindex] += toplevel;
+
+		for (uint32_t i = 0; i < scopetime.size(); ++i)
+		{
+			if (scopetime[i].has_value()) scopes[i].recorded.push_back(scopetime[i].value());
+		}
+	}
+
+	if (paused) return true;
+
+	for (uint32_t i = 0; i < scopetime.size(); ++i)
+	{
+		if (!scopetime[i].has_value()) continue;
+
+		ProfileScope& scope = scopes[i];
+		scope.history[scope.sampleCount % PROFILER_HISTORY_SIZE] = scopetime[i].value();
+		++scope.sampleCount;
+
+		if (scopestatistics[i].has_value()) scope.statistics = scopestatistics[i];
+	}
+
+	return true;
+}
+
+uint32_t GPUProfiler::findScope(const std::string& name)
+{
+	for (uint32_t i = 0; i < scopes.size(); ++i)
+	{
+		if (scopes[i].name == name) return i;
+	}
+
+	ProfileScope scope;
+	scope.name = name;
+	scopes.push_back(scope);
+
+	return static_cast<uint32_t>(scopes.size() - 1);
+}
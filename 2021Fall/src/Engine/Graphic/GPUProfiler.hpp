@@ -0,0 +1,139 @@
+#pragma once
+
+//3rd party library
+#include <vulkan/vulkan.h>
+
+//standard library
+#include <array>
+#include <string>
+#include <vector>
+#include <optional>
+
+constexpr uint32_t PROFILER_HISTORY_SIZE = 256;
+//begin/end pairs one recorded command buffer can write
+constexpr uint32_t PROFILER_MAX_SCOPE_PER_SLOT = 32;
+
+enum PIPELINE_STATISTIC_INDEX
+{
+	STATISTIC_IA_PRIMITIVES,
+	STATISTIC_VS_INVOCATIONS,
+	STATISTIC_GS_INVOCATIONS,
+	STATISTIC_CLIPPING_PRIMITIVES,
+	STATISTIC_FS_INVOCATIONS,
+	STATISTIC_MAX,
+};
+
+struct ProfileScope
+{
+	std::string name;
+
+	//ring buffer of gpu time in ms, one sample per submission
+	std::array<float, PROFILER_HISTORY_SIZE> history{};
+	uint32_t sampleCount = 0;
+
+	//every sample since BeginRecording, kept in full for benchmark summaries
+	std::vector<float> recorded;
+
+	//last read pipeline statistics summed over every range of the scope, only for scopes begun with pipelineStatistics
+	std::optional<std::array<uint64_t, STATISTIC_MAX>> statistics;
+};
+
+struct ProfileScopeStat
+{
+	float last = 0.0f;
+	float min = 0.0f;
+	float avg = 0.0f;
+	float p99 = 0.0f;
+};
+
+//queries written by one pre-recorded command buffer, reused every time it is submitted
+struct ProfileSlot
+{
+	struct Range
+	{
+		uint32_t scope;
+		std::optional<uint32_t> statisticsQuery;
+		//not nested inside another range of this slot
+		bool topLevel = true;
+	};
+
+	std::vector<Range> ranges;
+	std::vector<uint32_t> openRanges;
+	uint32_t statisticsCount = 0;
+
+	bool pending = false;
+	//frame the last submission belongs to
+	uint64_t submitFrame = 0;
+};
+
+//vkCmdWriteTimestamp based profiler
+//every command buffer owns a range of queries, results are read only once they are available so the cpu never stalls
+class GPUProfiler
+{
+public:
+	GPUProfiler(VkDevice device);
+
+	//pipelineStatisticsQuery is enabled by Application whenever the device supports it
+	void init(VkPhysicalDevice physicalDevice);
+	void close();
+
+	//one slot per command buffer, pools are recreated so the device has to be idle
+	void SetSlotCount(uint32_t count);
+
+	//reset the queries of slot, has to be called right after vkBeginCommandBuffer
+	void BeginRecord(uint32_t slot, VkCommandBuffer cmdBuffer);
+	//scopes with the same name inside one submission are summed
+	//pipeline statistics can not be nested, only use them for scopes that do not overlap
+	void BeginScope(uint32_t slot, VkCommandBuffer cmdBuffer, const std::string& name, bool pipelineStatistics = false);
+	void EndScope(uint32_t slot, VkCommandBuffer cmdBuffer);
+
+	//call right before the command buffer of slot is submitted
+	void Submit(uint32_t slot);
+	//read every submitted slot the gpu already finished
+	void Collect();
+
+	//frame number stamped on every following Submit
+	void SetFrame(uint64_t frame);
+	//from frame on, the top level scopes of every finished submission are summed into the frame it was submitted in
+	void BeginRecording(uint64_t frame);
+	void EndRecording();
+	//ms, index 0 is the frame passed to BeginRecording
+	const std::vector<float>& GetRecordedFrames() const;
+	const std::vector<ProfileScope>& GetScopes() const;
+
+	bool IsEnabled() const;
+	bool IsStatisticsSupported() const;
+
+	ProfileScopeStat GetStat(const ProfileScope& scope) const;
+
+	void drawGUI();
+	void ExportCSV(const std::string& filename) const;
+	void ExportJSON(const std::string& filename) const;
+
+private:
+	void createQueryPools();
+	void destroyQueryPools();
+
+	bool collectSlot(uint32_t slot);
+	uint32_t findScope(const std::string& name);
+
+	VkDevice vulkanDevice;
+
+	VkQueryPool timestampPool = VK_NULL_HANDLE;
+	VkQueryPool statisticsPool = VK_NULL_HANDLE;
+
+	bool timestampSupported = false;
+	bool statisticsSupported = false;
+	//nanoseconds per tick
+	float timestampPeriod = 1.0f;
+	uint64_t timestampMask = ~0ull;
+
+	std::vector<ProfileSlot> slots;
+	std::vector<ProfileScope> scopes;
+
+	bool paused = false;
+
+	uint64_t currentFrame = 0;
+	std::optional<uint64_t> recordStart;
+	std::vector<float> recordedFrames;
+};
@@ -4,6 +4,7 @@
 #include "VertexInfo.hpp"
 #include "Renderpass.hpp"
 #include "DescriptorSet.hpp"
+#include "DescriptorBinder.hpp"
 #include "Engine/Memory/Buffer.hpp"
 #include "Engine/Memory/Image.hpp"
 #include "Engine/Entity/Camera.hpp"
@@ -11,12 +12,27 @@
 #include "Engine/Entity/Light.hpp"
 #include "Engine/Entity/Object.hpp"
 #include "Engine/Graphic/Descriptor.hpp"
+#include "PipelineCache.hpp"
+#include "ComputePipeline.hpp"
+#include "GPUProfiler.hpp"
+#include "Engine/Misc/ThreadPool.hpp"
 #include "Engine/Level/LevelManager.hpp"
+#include "Engine/Common/FrameClock.hpp"
+#include "Engine/Misc/PNGWriter.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include "LODSelector.hpp"
 
 //standard library
 #include <stdexcept>
 #include <unordered_map>
 #include <iostream>
+#include <future>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <exception>
 
 //3rd party library
 #include <vulkan/vulkan.h>
@@ -30,7 +46,88 @@
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-#define INSTANCE_COUNT 1
+//detail levels of loaded models including the full mesh, each has about half the triangles of the one before
+constexpr uint32_t MODEL_LOD_MAX = 4;
+//coarsest level may move the surface this far, relative to the bounding sphere radius
+constexpr float MODEL_LOD_MAX_ERROR = 0.05f;
+//acmr a cluster of the overdraw pass may lose against the vertex cache order
+constexpr float MODEL_OVERDRAW_THRESHOLD = 1.05f;
+
+//scope names of the automatically profiled renderpasses
+constexpr std::array<const char*, RENDERPASS_INDEX::RENDERPASS_MAX> RENDERPASS_NAMES = {
+    "Deferred Lighting",
+    "GBuffer",
+    "Shadow Cubemap",
+    "Merged Deferred",
+    "TAA Resolve",
+};
+
+//programs that shade the gbuffer, compiled with GetLightingConstants
+constexpr std::array<PROGRAM_ID, 3> LIGHTING_PROGRAMS = {
+    PROGRAM_ID::PROGRAM_ID_DEFERRED,
+    PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE,
+    PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS,
+};
+
+//uint16 indices when every vertex can be addressed with them
+template<typename T>
+static VertexInfo CreateMeshBuffers(std::vector<T>& vertices, const std::vector<uint32_t>& indices)
+{
+    VertexInfo result{};
+    result.vertex = VulkanMemoryManager::CreateVertexBuffer(vertices.data(), vertices.size() * sizeof(T));
+    result.indexSize = static_cast<uint32_t>(indices.size());
+
+    if (vertices.size() < 65536)
+    {
+        std::vector<uint16_t> shortindices;
+        shortindices.reserve(indices.size());
+        for (uint32_t index : indices)
+        {
+            shortindices.push_back(static_cast<uint16_t>(index));
+        }
+
+        result.index = VulkanMemoryManager::CreateIndexBuffer(shortindices.data(), shortindices.size() * sizeof(uint16_t));
+        result.indexType = VK_INDEX_TYPE_UINT16;
+    }
+    else
+    {
+        std::vector<uint32_t> copy = indices;
+        result.index = VulkanMemoryManager::CreateIndexBuffer(copy.data(), copy.size() * sizeof(uint32_t));
+        result.indexType = VK_INDEX_TYPE_UINT32;
+    }
+
+    return result;
+}
+
+//position and normal stream of vertices, target decodes the positions with its bounds pushed per draw
+static VertexInfo CreatePackedMeshBuffers(const std::vector<PosNormal>& vertices, const std::vector<uint32_t>& indices, DrawTarget& target)
+{
+    glm::vec3 boundsmin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsmax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : vertices)
+    {
+        boundsmin = glm::min(boundsmin, vertex.position);
+        boundsmax = glm::max(boundsmax, vertex.position);
+    }
+
+    target.positionOffset = boundsmin;
+    target.positionScale = boundsmax - boundsmin;
+
+    std::vector<PackedPosition> positions;
+    std::vector<PackedNormal> normals;
+    positions.reserve(vertices.size());
+    normals.reserve(vertices.size());
+    for (const auto& vertex : vertices)
+    {
+        positions.push_back(PackedPosition::Pack(vertex.position, target.positionOffset, target.positionScale));
+        normals.push_back(PackedNormal::Pack(vertex.normal));
+    }
+
+    VertexInfo result = CreateMeshBuffers(positions, indices);
+    result.attribute = VulkanMemoryManager::CreateVertexBuffer(normals.data(), normals.size() * sizeof(PackedNormal));
+
+    return result;
+}
 
 Graphic::Graphic(VkDevice device, Application* app) : System(device, app, "Graphic") {}
 
@@ -38,22 +135,32 @@ void Graphic::init()
 {
     VulkanMemoryManager::Init(vulkanDevice);
 
+    gpuProfiler = new GPUProfiler(vulkanDevice);
+    gpuProfiler->init(application->GetPhysicalDevice());
+
+    SelectSampleCount();
+
     SetupSwapChain();
 
     descriptorManager = new DescriptorManager(vulkanDevice);
-    descriptorManager->init();
+    descriptorManager->init(edgeLighting, MAX_FRAMES_IN_FLIGHT);
+
+    graphicsBinder = new DescriptorBinder(descriptorManager, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    computeBinder = new DescriptorBinder(descriptorManager, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    lodSelector = new LODSelector(LOD_VIEW_MAX);
 
     //uniform
     {
         VkDeviceSize bufferSize = sizeof(Cameratransform);
         uint32_t uniform = VulkanMemoryManager::CreateUniformBuffer(UNIFORM_CAMERA_TRANSFORM, bufferSize);
 
-        bufferSize = 128;// sizeof(ObjectUniform);
-        const uint32_t MAX_OBJECT_SIZE = 20;
-        uniform = VulkanMemoryManager::CreateUniformBuffer(UNIFORM_OBJECT_MATRIX, bufferSize, MAX_OBJECT_SIZE);
+        //indexed with the object index pushed per draw, see object.glsl
+        bufferSize = OBJECT_UNIFORM_STRIDE;// sizeof(ObjectUniform);
+        uniform = VulkanMemoryManager::CreateStorageBuffer(UNIFORM_OBJECT_MATRIX, bufferSize, Settings::maxObjectCount);
 
-        bufferSize = 128;
-        uniform = VulkanMemoryManager::CreateUniformBuffer(UNIFORM_LIGHT_OBJECT_MATRIX, bufferSize, MAX_LIGHT);
+        bufferSize = OBJECT_UNIFORM_STRIDE;
+        uniform = VulkanMemoryManager::CreateStorageBuffer(UNIFORM_LIGHT_OBJECT_MATRIX, bufferSize, MAX_LIGHT);
 
         bufferSize = sizeof(GUISetting);
         uniform = VulkanMemoryManager::CreateUniformBuffer(UNIFORM_GUI_SETTING, bufferSize);
@@ -78,10 +185,10 @@ void Graphic::init()
             0, 1, 2, 1, 3, 2,
         };
 
-        uint32_t vertex = VulkanMemoryManager::CreateVertexBuffer(vert.data(), vert.size() * sizeof(PosTexVertex));
-        uint32_t index = VulkanMemoryManager::CreateIndexBuffer(indices.data(), indices.size() * sizeof(uint32_t));
+        DrawTarget quad{};
+        quad.vertexIndices = { CreateMeshBuffers(vert, indices) };
 
-        drawtargets.push_back({ {{vertex, index, 6}} });
+        drawtargets.push_back(std::move(quad));
     }
 
     //create vertex & index buffer
@@ -127,19 +234,63 @@ void Graphic::init()
             }
         }
 
-        //vertex
-        size_t vertexbuffermemorysize = vert.size() * sizeof(PosNormal);
-        uint32_t vertex = VulkanMemoryManager::CreateVertexBuffer(vert.data(), vertexbuffermemorysize);
+        std::vector<glm::vec3> positions;
+        positions.reserve(vert.size());
+        glm::vec3 boundsmin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsmax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const auto& vertex : vert)
+        {
+            positions.push_back(vertex.position);
+            boundsmin = glm::min(boundsmin, vertex.position);
+            boundsmax = glm::max(boundsmax, vertex.position);
+        }
+
+        glm::vec3 boundscenter = (boundsmin + boundsmax) * 0.5f;
+        float boundsradius = 0.0f;
+        for (const auto& position : positions)
+        {
+            boundsradius = std::max(boundsradius, glm::length(position - boundscenter));
+        }
+
+        //detail levels share the vertex buffer, their index ranges follow each other in one index buffer
+        std::vector<SimplifiedMesh> levels = MeshSimplifier::GenerateLODs(positions, indices, MODEL_LOD_MAX, boundsradius * MODEL_LOD_MAX_ERROR);
 
-        //index
-        size_t indexbuffermemorysize = indices.size() * sizeof(uint32_t);
-        uint32_t index = VulkanMemoryManager::CreateIndexBuffer(indices.data(), indexbuffermemorysize);
+        //every level in vertex cache and overdraw order
+        std::vector<uint32_t> lodindices;
+        std::vector<DrawLOD> lods;
+        for (size_t i = 0; i < levels.size(); ++i)
+        {
+            std::vector<uint32_t>& levelindices = levels[i].indices;
+
+            VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(levelindices, vert.size());
+            MeshOptimizer::OptimizeVertexCache(levelindices, vert.size());
+            MeshOptimizer::OptimizeOverdraw(levelindices, positions, MODEL_OVERDRAW_THRESHOLD);
+            VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(levelindices, vert.size());
+
+            std::cout << "model lod " << i << " : " << levelindices.size() / 3 << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+                << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
+            lods.push_back({ static_cast<uint32_t>(lodindices.size()), static_cast<uint32_t>(levelindices.size()), levels[i].error });
+            lodindices.insert(lodindices.end(), levelindices.begin(), levelindices.end());
+        }
+
+        //vertices in the order the full mesh fetches them, the coarser levels use a subset
+        std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(lodindices, vert.size());
+        MeshOptimizer::RemapVertices(vert, remap);
+
+        //without an object matrix the full mesh is drawn, the first range
+        DrawTarget model{};
+        model.vertexIndices = { CreatePackedMeshBuffers(vert, lodindices, model) };
+        model.vertexIndices[0].indexSize = static_cast<uint32_t>(indices.size());
+        model.lods = std::move(lods);
+        model.boundsCenter = boundscenter;
+        model.boundsRadius = boundsradius;
 
         std::vector<glm::vec3> transform_matrices;
-        transform_matrices.reserve(INSTANCE_COUNT);
+        transform_matrices.reserve(Settings::modelInstanceCount);
         float scale = 1.5f;
         int midpoint = 13;
-        for (int i = 0; i < INSTANCE_COUNT; ++i)
+        for (int i = 0; i < static_cast<int>(Settings::modelInstanceCount); ++i)
         {
             glm::vec3 vec = glm::vec3(3.0f - scale * (i / midpoint), 0.0f, scale * 2 * (i % midpoint));
             //vec = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -149,9 +300,14 @@ void Graphic::init()
         size_t instance_size = transform_matrices.size() * sizeof(glm::vec3);
         uint32_t instance = VulkanMemoryManager::CreateVertexBuffer(transform_matrices.data(), instance_size);
 
-        drawtargets.push_back({ {{vertex, index, static_cast<uint32_t>(indices.size())}}, instance, INSTANCE_COUNT });
+        DrawTarget instanced = model;
+        instanced.instancebuffer = instance;
+        instanced.instancenumber = Settings::modelInstanceCount;
+        instanced.instanceOffsets = std::move(transform_matrices);
+
+        drawtargets.push_back(std::move(instanced));
 
-        drawtargets.push_back({ {{vertex, index, static_cast<uint32_t>(indices.size())}} });
+        drawtargets.push_back(std::move(model));
     }
 
     {
@@ -207,18 +363,15 @@ void Graphic::init()
             21, 23, 22,
         };
 
-        size_t vertexbuffermemorysize = vert.size() * sizeof(PosNormal);
-        uint32_t vertex = VulkanMemoryManager::CreateVertexBuffer(vert.data(), vertexbuffermemorysize);
-
-        //index
-        size_t indexbuffermemorysize = indices.size() * sizeof(uint32_t);
-        uint32_t index = VulkanMemoryManager::CreateIndexBuffer(indices.data(), indexbuffermemorysize);
+        DrawTarget cube{};
+        cube.vertexIndices = { CreatePackedMeshBuffers(vert, indices, cube) };
 
         glm::vec3 zero = glm::vec3(0, 0, 0);
         size_t instance_size = sizeof(glm::vec3);
-        uint32_t instance = VulkanMemoryManager::CreateVertexBuffer(&zero, instance_size);
+        cube.instancebuffer = VulkanMemoryManager::CreateVertexBuffer(&zero, instance_size);
+        cube.instancenumber = 1;
 
-        drawtargets.push_back({ {{vertex, index, static_cast<uint32_t>(indices.size())}}, instance, 1 });
+        drawtargets.push_back(std::move(cube));
     }
 
     //create texture image
@@ -236,7 +389,12 @@ void Graphic::init()
 
         //stbi_image_free(pixels);
 
-        for(uint32_t i = 0; i < MAX_LIGHT; ++i) images.push_back(VulkanMemoryManager::CreateShadowMapBuffer());
+        //float depth keeps the precision of a perspective depth far from the light
+        vulkanShadowFormat = findSupportedFormat({
+            VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM
+            }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+        for(uint32_t i = 0; i < MAX_LIGHT; ++i) images.push_back(VulkanMemoryManager::CreateShadowMapBuffer(vulkanShadowFormat, Settings::shadowmapSize));
     }
 
     //sampler
@@ -270,12 +428,72 @@ void Graphic::init()
         {
             throw std::runtime_error("failed to create texture sampler!");
         }
+
+        //gbuffer is read texel to texel, and R32_SFLOAT does not have to support linear filtering
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = 0.0f;
+
+        if (vkCreateSampler(vulkanDevice, &samplerInfo, nullptr, &vulkanGBufferSampler))
+        {
+            throw std::runtime_error("failed to create gbuffer sampler!");
+        }
+
+        //history is reprojected to subpixel positions, so it needs filtering
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+
+        if (vkCreateSampler(vulkanDevice, &samplerInfo, nullptr, &vulkanHistorySampler))
+        {
+            throw std::runtime_error("failed to create history sampler!");
+        }
+
+        //every tap is a 2x2 pcf when the shadow format can be filtered
+        VkFormatProperties shadowProperties;
+        vkGetPhysicalDeviceFormatProperties(application->GetPhysicalDevice(), vulkanShadowFormat, &shadowProperties);
+        VkFilter shadowFilter = (shadowProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+        samplerInfo.magFilter = shadowFilter;
+        samplerInfo.minFilter = shadowFilter;
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+        if (vkCreateSampler(vulkanDevice, &samplerInfo, nullptr, &vulkanShadowSampler))
+        {
+            throw std::runtime_error("failed to create shadow sampler!");
+        }
+
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(vulkanDevice, &samplerInfo, nullptr, &vulkanShadowMomentSampler))
+        {
+            throw std::runtime_error("failed to create shadow moment sampler!");
+        }
     }
 
+    guiSetting.shadow_filter = Settings::shadowHardwareCompare ? GUI_ENUM::SHADOW_FILTER_COMPARE : GUI_ENUM::SHADOW_FILTER_MANUAL;
+    if (Settings::shadowMoments) guiSetting.shadow_filter = GUI_ENUM::SHADOW_FILTER_MOMENTS;
+    guiSetting.shadowtaps = static_cast<int>(Settings::shadowTaps);
+
     AllocateCommandBuffer();
 
+    pipelineCache = new PipelineCache(vulkanDevice);
+    pipelineCache->init(application->GetDeviceProperties());
+
     DefineDrawBehavior();
 
+    pipelineCache->save();
+
     //create semaphore
     {
         vulkanImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -308,9 +526,40 @@ void Graphic::update(float dt)
 {
     vkWaitForFences(vulkanDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+    descriptorManager->BeginFrame(static_cast<uint32_t>(currentFrame));
+
+    gpuProfiler->Collect();
+    gpuProfiler->SetFrame(application->GetFrameClock()->GetFrameCount() - 1);
+
+    UpdatePendingPipelines();
+    UpdateLightingVariant();
+
+    if (profilerRecordUpdate)
+    {
+        //only happens when toggled from gui, so a full wait is fine
+        vkDeviceWaitIdle(vulkanDevice);
+        RecordCommandBuffers();
+        profilerRecordUpdate = false;
+    }
+
+    if (drawBehaviorRebuild)
+    {
+        RecreateSwapChain();
+        return;
+    }
+
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(vulkanDevice, vulkanSwapChain,
-        UINT64_MAX, vulkanImageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    if (Settings::headless)
+    {
+        imageIndex = offscreenIndex;
+        offscreenIndex = (offscreenIndex + 1) % swapchainImageSize;
+    }
+    else
+    {
+        result = vkAcquireNextImageKHR(vulkanDevice, vulkanSwapChain,
+            UINT64_MAX, vulkanImageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
@@ -333,7 +582,11 @@ void Graphic::update(float dt)
         static float time = 0; 
         //time += dt * 0.01f;
 
-        VulkanMemoryManager::MapMemory(UNIFORM_GUI_SETTING, &guiSetting);
+        GUISetting setting = guiSetting;
+        if (taaHistoryReset) setting.taaFeedback = 0.0f;
+        taaHistoryReset = false;
+
+        VulkanMemoryManager::MapMemory(UNIFORM_GUI_SETTING, &setting);
     }
 
     ////pre render
@@ -351,6 +604,14 @@ void Graphic::update(float dt)
     //    vkQueueWaitIdle(application->GetGraphicQueue());
     //}
     
+    //detail levels of the command buffers submitted this frame, the others may still be in flight
+    {
+        lodTriangleCount = 0;
+        if (Settings::mergedDeferred) lodTriangleCount += lodSelector->Update(CMD_INDEX::CMD_POST + imageIndex);
+        else lodTriangleCount += lodSelector->Update(CMD_INDEX::CMD_BASE);
+        lodTriangleCount += lodSelector->Update(CMD_INDEX::CMD_SHADOW);
+    }
+
     //pre render
     {
         for (auto uniform : drawinfos)
@@ -366,8 +627,20 @@ void Graphic::update(float dt)
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        submitInfo.commandBufferCount = 2;
-        submitInfo.pCommandBuffers = &vulkanCommandBuffers[CMD_INDEX::CMD_BASE];
+        //merged renderpass draws the gbuffer inside the post command buffer
+        if (Settings::mergedDeferred)
+        {
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &vulkanCommandBuffers[CMD_INDEX::CMD_SHADOW];
+        }
+        else
+        {
+            submitInfo.commandBufferCount = 2;
+            submitInfo.pCommandBuffers = &vulkanCommandBuffers[CMD_INDEX::CMD_BASE];
+
+            gpuProfiler->Submit(CMD_INDEX::CMD_BASE);
+        }
+        gpuProfiler->Submit(CMD_INDEX::CMD_SHADOW);
 
         if (vkQueueSubmit(application->GetGraphicQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
         {
@@ -376,6 +649,8 @@ void Graphic::update(float dt)
 
         vkQueueWaitIdle(application->GetGraphicQueue());
 
+        gpuProfiler->Collect();
+
         for (auto uniform : drawinfos)
         {
             uniform.second.clear();
@@ -386,9 +661,10 @@ void Graphic::update(float dt)
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+    //offscreen images are only guarded by the fences, nothing to acquire or present
     VkSemaphore waitSemaphores[] = { vulkanImageAvailableSemaphores[currentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = Settings::headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -398,16 +674,30 @@ void Graphic::update(float dt)
     submitInfo.pCommandBuffers = bufferlist.data();
 
     VkSemaphore signalSemaphores[] = { vulkanRenderFinishedSemaphores[currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = Settings::headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkResetFences(vulkanDevice, 1, &inFlightFences[currentFrame]);
 
+    gpuProfiler->Submit(imageIndex + CMD_INDEX::CMD_POST);
+
     if (vkQueueSubmit(application->GetGraphicQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    if (Settings::headless)
+    {
+        uint64_t frame = application->GetFrameClock()->GetFrameCount() - 1;
+        if (std::find(Settings::dumpFrames.begin(), Settings::dumpFrames.end(), frame) != Settings::dumpFrames.end())
+        {
+            DumpFrame(imageIndex, frame);
+        }
+
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return;
+    }
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -438,6 +728,10 @@ void Graphic::update(float dt)
 void Graphic::close()
 {
     vkDestroySampler(vulkanDevice, vulkanTextureSampler, nullptr);
+    vkDestroySampler(vulkanDevice, vulkanGBufferSampler, nullptr);
+    vkDestroySampler(vulkanDevice, vulkanHistorySampler, nullptr);
+    vkDestroySampler(vulkanDevice, vulkanShadowSampler, nullptr);
+    vkDestroySampler(vulkanDevice, vulkanShadowMomentSampler, nullptr);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
     {
@@ -453,12 +747,25 @@ void Graphic::close()
     }
     images.clear();
 
+    delete graphicsBinder;
+    delete computeBinder;
+
     descriptorManager->close();
     delete descriptorManager;
 
+    //its buffers are released with the rest below
+    delete lodSelector;
+
     VulkanMemoryManager::Close();
 
+    CloseDrawBehavior();
     CloseSwapChain();
+
+    pipelineCache->close();
+    delete pipelineCache;
+
+    gpuProfiler->close();
+    delete gpuProfiler;
 }
 
 Graphic::~Graphic() {}
@@ -470,6 +777,9 @@ void Graphic::drawGUI()
         ImGui::Text("Swapchain num : % d", swapchainImageSize);
 
         ImGui::Text("Samples : %d", vulkanMSAASamples);
+        ImGui::Text("Edge lighting : %s", edgeLighting ? "on" : "off");
+        ImGui::Text("Temporal AA : %s", Settings::temporalAA ? "on" : "off");
+        ImGui::Text("LOD triangles : %llu", static_cast<unsigned long long>(lodTriangleCount));
     }
 
     if (ImGui::CollapsingHeader("Setting##Graphic"))
@@ -490,11 +800,58 @@ void Graphic::drawGUI()
         {
             guiSetting.deferred_type = GUI_ENUM::DEFERRED_LIGHT;
         }
+        if (edgeLighting)
+        {
+            ImGui::SameLine();
+            if (ImGui::Button("MSAAEdge##GraphicSetting"))
+            {
+                guiSetting.deferred_type = GUI_ENUM::DEFERRED_EDGE;
+            }
+        }
         if (ImGui::CollapsingHeader("Shadow##SettingGraphic"))
         {
             ImGui::DragFloat("ShadowBias", &guiSetting.shadowbias, 0.001f, 0.0f, 10.0f);
             ImGui::DragFloat("ShadowFarPlane", &guiSetting.shadowfar_plane, 0.01f, 0.01f, 1000.0f);
             ImGui::DragFloat("ShadowDiskRadius", &guiSetting.shadowdiskRadius, 0.01f, 0.01f, 1000.0f);
+
+            if (ImGui::RadioButton("Manual##ShadowFilter", guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_MANUAL)) guiSetting.shadow_filter = GUI_ENUM::SHADOW_FILTER_MANUAL;
+            ImGui::SameLine();
+            if (ImGui::RadioButton("Compare##ShadowFilter", guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_COMPARE)) guiSetting.shadow_filter = GUI_ENUM::SHADOW_FILTER_COMPARE;
+
+            if (Settings::shadowMoments)
+            {
+                ImGui::SameLine();
+                if (ImGui::RadioButton("Moments##ShadowFilter", guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_MOMENTS)) guiSetting.shadow_filter = GUI_ENUM::SHADOW_FILTER_MOMENTS;
+            }
+
+            bool moments = Settings::shadowMoments;
+            if (ImGui::Checkbox("MomentShadowMaps##ShadowFilter", &moments)) SetShadowMoments(moments);
+
+            if (guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_COMPARE) ImGui::SliderInt("ShadowTaps", &guiSetting.shadowtaps, 1, 32);
+            if (guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_MOMENTS)
+            {
+                if (ImGui::RadioButton("VSM##ShadowMoment", guiSetting.moment_type == GUI_ENUM::SHADOW_MOMENT_VSM)) guiSetting.moment_type = GUI_ENUM::SHADOW_MOMENT_VSM;
+                ImGui::SameLine();
+                if (ImGui::RadioButton("EVSM##ShadowMoment", guiSetting.moment_type == GUI_ENUM::SHADOW_MOMENT_EVSM)) guiSetting.moment_type = GUI_ENUM::SHADOW_MOMENT_EVSM;
+
+                ImGui::SliderInt("MomentBlurRadius", &guiSetting.momentBlurRadius, 0, 8);
+                ImGui::DragFloat("MomentBleedReduction", &guiSetting.momentBleedReduction, 0.005f, 0.0f, 0.99f);
+                ImGui::DragFloat("MomentMinVariance", &guiSetting.momentMinVariance, 0.00001f, 0.0f, 0.01f, "%.5f");
+                if (guiSetting.moment_type == GUI_ENUM::SHADOW_MOMENT_EVSM)
+                {
+                    ImGui::DragFloat("EVSMPositiveExponent", &guiSetting.evsmPositiveExponent, 0.01f, 0.0f, 5.54f);
+                    ImGui::DragFloat("EVSMNegativeExponent", &guiSetting.evsmNegativeExponent, 0.01f, 0.0f, 5.54f);
+                }
+            }
+        }
+        //merged renderpass has no place for the resolve pass
+        if (!Settings::mergedDeferred && ImGui::CollapsingHeader("Antialiasing##SettingGraphic"))
+        {
+            if (ImGui::RadioButton("MSAA##GraphicSetting", !Settings::temporalAA)) SetTemporalAA(false);
+            ImGui::SameLine();
+            if (ImGui::RadioButton("TAA##GraphicSetting", Settings::temporalAA)) SetTemporalAA(true);
+
+            if (Settings::temporalAA) ImGui::DragFloat("TAAFeedback", &guiSetting.taaFeedback, 0.001f, 0.0f, 0.99f);
         }
     }
 
@@ -506,6 +863,22 @@ void Graphic::drawGUI()
     ImGui::SameLine();
     if (ImGui::RadioButton("Basic", lightcomputationbool[GUI_ENUM::LIGHT_COMPUTE_BASIC])) guiSetting.computation_type = GUI_ENUM::LIGHT_COMPUTE_BASIC;
 
+    if (ImGui::CollapsingHeader("GPU Profiler##Graphic"))
+    {
+        if (gpuProfiler->IsStatisticsSupported())
+        {
+            ImGui::Text("Pipeline statistics :");
+            for (uint32_t i = 0; i < RENDERPASS_INDEX::RENDERPASS_MAX; ++i)
+            {
+                ImGui::SameLine();
+                std::string label = std::string(RENDERPASS_NAMES[i]) + "##GraphicProfiler";
+                if (ImGui::Checkbox(label.c_str(), &profilePipelineStatistics[i])) profilerRecordUpdate = true;
+            }
+        }
+
+        gpuProfiler->drawGUI();
+    }
+
     if (ImGui::Button("Reload Swapchain"))
     {
         application->framebufferSizeUpdate = true;
@@ -526,60 +899,232 @@ void Graphic::AllocateCommandBuffer()
     {
         throw std::runtime_error("failed to allocate command buffers!");
     }
+
+    gpuProfiler->SetSlotCount(static_cast<uint32_t>(vulkanCommandBuffers.size()));
 }
 
-void Graphic::SetupSwapChain()
+void Graphic::SetupSwapChain(VkSwapchainKHR oldSwapChain)
 {
+    //offscreen ring in place of the swapchain, rgba order so captures can be written directly
+    if (Settings::headless)
+    {
+        vulkanSwapChain = VK_NULL_HANDLE;
+        swapchainImageSize = Settings::offscreenImageCount;
+        vulkanSwapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        vulkanSwapChainExtent = { Settings::windowWidth, Settings::windowHeight };
+
+        for (uint32_t i = 0; i < swapchainImageSize; ++i)
+        {
+            swapchainImages.push_back(VulkanMemoryManager::CreateOffscreenImage(vulkanSwapChainImageFormat));
+        }
+    }
     //create swap chain
+    else
     {
-        vulkanSwapChain = application->CreateSwapChain(swapchainImageSize, vulkanSwapChainImageFormat, vulkanSwapChainExtent);
+        vulkanSwapChain = application->CreateSwapChain(swapchainImageSize, vulkanSwapChainImageFormat, vulkanSwapChainExtent, oldSwapChain);
 
         VulkanMemoryManager::GetSwapChainImage(vulkanSwapChain, swapchainImageSize, swapchainImages, vulkanSwapChainImageFormat);
     }
 
+    CreateFrameBufferImages();
+}
+
+void Graphic::CreateFrameBufferImages()
+{
+    framebufferImages.assign(FrameBufferIndex::FRAMEBUFFER_MAX, nullptr);
+
+    //view depth replaces a full position, octahedral normal and roughness share 32 bits, metal rides in albedo alpha
+    //merged renderpass only reads the gbuffer as input attachment inside the pass, nothing has to be backed by memory
+    //edge lighting samples the msaa gbuffer itself, a single sample gbuffer is read without resolve
+    bool resolve = ResolvesGBuffer();
+    VkImageUsageFlags readusage = Settings::mergedDeferred ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT : VK_IMAGE_USAGE_SAMPLED_BIT;
+    VkImageUsageFlags outputusage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (resolve ? static_cast<VkImageUsageFlags>(VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) : readusage);
+    VkImageUsageFlags resolveusage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readusage;
+
+    const std::array<VkFormat, COLORATTACHMENT_MAX> gbufferformats = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_FORMAT_R8G8B8A8_UNORM };
+    for (uint32_t i = 0; i < COLORATTACHMENT_MAX; ++i)
     {
-        vulkanMSAASamples = getMaxUsableSampleCount();
+        framebufferImages[i] = VulkanMemoryManager::CreateFrameBufferImage(outputusage, gbufferformats[i], vulkanMSAASamples);
+
+        if (resolve) framebufferImages[i + COLORATTACHMENT_MAX] = VulkanMemoryManager::CreateFrameBufferImage(resolveusage, gbufferformats[i], VK_SAMPLE_COUNT_1_BIT);
     }
 
-    //create resources (multisampled color resource)
+    //depth buffer
+    vulkanDepthFormat = findSupportedFormat({
+        VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT
+        }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+    framebufferImages[FrameBufferIndex::DEPTHATTACHMENT] = VulkanMemoryManager::CreateDepthBuffer(vulkanDepthFormat, vulkanMSAASamples);
+
+    if (Settings::temporalAA)
     {
-        framebufferImages.resize(FrameBufferIndex::FRAMEBUFFER_MAX);
+        framebufferImages[FrameBufferIndex::VELOCITYATTACHMENT] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_FORMAT_R16G16_SFLOAT, vulkanMSAASamples);
 
-        framebufferImages[FrameBufferIndex::POSITIONATTACHMENT] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, vulkanMSAASamples);
-        framebufferImages[FrameBufferIndex::NORMALATTACHMENT] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, vulkanMSAASamples);
-        framebufferImages[FrameBufferIndex::ALBEDOATTACHMENT] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_FORMAT_R8G8B8A8_UNORM, vulkanMSAASamples);
+        //lighting has to be kept above 8 bit until the resolve, history is blended over many frames
+        VkFormat hdrformat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        taaImages.assign(TAAImageIndex::TAA_IMAGE_MAX, nullptr);
+        taaImages[TAAImageIndex::TAA_SCENECOLOR] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, hdrformat, VK_SAMPLE_COUNT_1_BIT);
+        taaImages[TAAImageIndex::TAA_HISTORY] = VulkanMemoryManager::CreateHistoryImage(hdrformat);
+        taaImages[TAAImageIndex::TAA_HISTORY_OUTPUT] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, hdrformat, VK_SAMPLE_COUNT_1_BIT);
 
-        framebufferImages[FrameBufferIndex::POSITIONATTACHMENT_MSAA] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT);
-        framebufferImages[FrameBufferIndex::NORMALATTACHMENT_MSAA] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT);
-        framebufferImages[FrameBufferIndex::ALBEDOATTACHMENT_MSAA] = VulkanMemoryManager::CreateFrameBufferImage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_FORMAT_R8G8B8A8_UNORM, VK_SAMPLE_COUNT_1_BIT);
+        //new history is uninitialized
+        taaHistoryReset = true;
+    }
 
-        //depth buffer
-        vulkanDepthFormat = findSupportedFormat({
-            VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT
+    if (edgeLighting)
+    {
+        VkFormat stencilFormat = findSupportedFormat({
+            VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT
             }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 
-        framebufferImages[FrameBufferIndex::DEPTHATTACHMENT] = VulkanMemoryManager::CreateDepthBuffer(vulkanDepthFormat, vulkanMSAASamples);
+        edgeStencilImage = VulkanMemoryManager::CreateStencilBuffer(stencilFormat);
+    }
+}
+
+void Graphic::CloseFrameBufferImages()
+{
+    for (auto image : framebufferImages)
+    {
+        if (image == nullptr) continue;
+
+        image->close();
+        delete image;
+    }
+    framebufferImages.clear();
+
+    for (auto image : taaImages)
+    {
+        image->close();
+        delete image;
+    }
+    taaImages.clear();
+
+    if (edgeStencilImage != nullptr)
+    {
+        edgeStencilImage->close();
+        delete edgeStencilImage;
+        edgeStencilImage = nullptr;
+    }
+}
+
+void Graphic::SelectSampleCount()
+{
+    //taa antialiases over the jittered frames, the gbuffer keeps a single sample
+    vulkanMSAASamples = Settings::temporalAA ? VK_SAMPLE_COUNT_1_BIT : getMaxUsableSampleCount();
+
+    //nothing to classify without msaa, the merged pass only reads the resolved gbuffer
+    edgeLighting = Settings::msaaEdgeLighting && vulkanMSAASamples != VK_SAMPLE_COUNT_1_BIT && !Settings::mergedDeferred;
+}
+
+bool Graphic::ResolvesGBuffer() const
+{
+    return vulkanMSAASamples != VK_SAMPLE_COUNT_1_BIT && !edgeLighting;
+}
+
+std::vector<FrameBufferIndex> Graphic::GetGBufferAttachments() const
+{
+    std::vector<FrameBufferIndex> attachments = { VIEWDEPTHATTACHMENT, NORMALATTACHMENT, ALBEDOATTACHMENT };
+    if (Settings::temporalAA) attachments.push_back(VELOCITYATTACHMENT);
+
+    if (ResolvesGBuffer())
+    {
+        attachments.push_back(VIEWDEPTHATTACHMENT_MSAA);
+        attachments.push_back(NORMALATTACHMENT_MSAA);
+        attachments.push_back(ALBEDOATTACHMENT_MSAA);
+    }
+
+    attachments.push_back(DEPTHATTACHMENT);
+
+    return attachments;
+}
+
+uint32_t Graphic::GetGBufferOutputCount() const
+{
+    return Settings::temporalAA ? COLORATTACHMENT_MAX + 1 : COLORATTACHMENT_MAX;
+}
+
+FrameBufferIndex Graphic::GetLightingInput(uint32_t location) const
+{
+    return static_cast<FrameBufferIndex>(ResolvesGBuffer() ? location + COLORATTACHMENT_MAX : location);
+}
+
+void Graphic::SetTemporalAA(bool enable)
+{
+    if (enable == Settings::temporalAA || Settings::mergedDeferred) return;
+
+    Settings::temporalAA = enable;
+    drawBehaviorRebuild = true;
+}
+
+void Graphic::SetShadowMoments(bool enable)
+{
+    if (enable == Settings::shadowMoments) return;
+
+    Settings::shadowMoments = enable;
+    drawBehaviorRebuild = true;
+
+    if (enable) guiSetting.shadow_filter = GUI_ENUM::SHADOW_FILTER_MOMENTS;
+    else if (guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_MOMENTS) guiSetting.shadow_filter = GUI_ENUM::SHADOW_FILTER_COMPARE;
+}
+
+void Graphic::CreateShadowMomentImages()
+{
+    const uint32_t size = Settings::shadowMomentSize;
+
+    for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+    {
+        shadowMomentDepths.push_back(VulkanMemoryManager::CreateShadowMapBuffer(vulkanShadowFormat, size));
+        shadowMomentImages.push_back(VulkanMemoryManager::CreateShadowMomentImage(SHADOW_MOMENT_FORMAT, size));
+    }
+
+    shadowMomentBlurImage = VulkanMemoryManager::CreateStorageImage(SHADOW_MOMENT_FORMAT, size, size, 6 * MAX_LIGHT);
+}
+
+void Graphic::CloseShadowMomentImages()
+{
+    for (auto image : shadowMomentDepths)
+    {
+        image->close();
+        delete image;
+    }
+    shadowMomentDepths.clear();
+
+    for (auto image : shadowMomentImages)
+    {
+        image->close();
+        delete image;
+    }
+    shadowMomentImages.clear();
+
+    if (shadowMomentBlurImage != nullptr)
+    {
+        shadowMomentBlurImage->close();
+        delete shadowMomentBlurImage;
+        shadowMomentBlurImage = nullptr;
     }
 }
 
+Image* Graphic::GetShadowDepthImage(uint32_t light) const
+{
+    return Settings::shadowMoments ? shadowMomentDepths[light] : images[light];
+}
+
 void Graphic::DefineShadowMap()
 {
-    //descriptor set
+    //pass set, the projections of every light, the light index pushed per draw selects one, objects use DESCRIPTORSET_ID_OBJ
     {
         std::vector<DescriptorData> data;
 
         data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_OBJECT_MATRIX)->GetDescriptorInfo();
-        data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_LIGHTPROJ)->GetDescriptorInfo();
+        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_LIGHTPROJ)->GetArrayDescriptorInfo();
 
-        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMAP] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_SHADOWMAP, data);
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMAP] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_SHADOWMAP, DESCRIPTOR_SET_TIER_PASS, data);
     }
 
     //renderpass/framebuffer
     {
         VkAttachmentDescription attachment{};
-        attachment.format = VK_FORMAT_D16_UNORM;
+        attachment.format = vulkanShadowFormat;
         attachment.samples = VK_SAMPLE_COUNT_1_BIT;
         attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -597,40 +1142,95 @@ void Graphic::DefineShadowMap()
         
         for (uint32_t i = 0; i < MAX_LIGHT; ++i)
         {
-            attach.imageViews.push_back(images[i]->GetImageView());
+            attach.imageViews.push_back(GetShadowDepthImage(i)->GetImageView());
         }
         renderPasses[RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP]->addAttachment(attach);
 
         attach.imageViews.clear();
         renderPasses[RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP]->createRenderPass();
-        renderPasses[RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP]->createFramebuffers(1024, 1024, 6, MAX_LIGHT);
+
+        uint32_t depthsize = GetShadowDepthImage(0)->GetExtent().width;
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP]->createFramebuffers(depthsize, depthsize, 6, MAX_LIGHT);
     }
 
     {
-        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions;
-        bindingDescriptions[0] = PosNormal::getBindingDescription();
-        bindingDescriptions[1].binding = 1;
-        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-        bindingDescriptions[1].stride = sizeof(glm::vec3);
+        GraphicPipelineDescription& description = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_SHADOWMAP];
+
+        VkVertexInputBindingDescription instanceBinding{};
+        instanceBinding.binding = 1;
+        instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        instanceBinding.stride = sizeof(glm::vec3);
+        //position stream only, the normals are never fetched for the 6 faces of every light
+        description.vertexBindings = { PackedPosition::getBindingDescription(), instanceBinding };
+
+        VkVertexInputAttributeDescription instanceAttribute{};
+        instanceAttribute.binding = 1;
+        instanceAttribute.location = 2;
+        instanceAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+        instanceAttribute.offset = 0;
+        description.vertexAttributes = { PackedPosition::getAttributeDescription(), instanceAttribute };
+
+        description.renderpass = renderPasses[RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP]->getRenderpass();
+        description.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_SHADOWMAP);
+        description.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        //depth only, no fragment shader so the depth test can run early
+        description.colorNum = 0;
+        description.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_SHADOWMAP);
+        description.enableCull = false;
+    }
+
+    if (Settings::shadowMoments)
+    {
+        //storage images are accessed in GENERAL
+        VkDescriptorImageInfo storageInfo{};
+        storageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        storageInfo.sampler = VK_NULL_HANDLE;
+        storageInfo.imageView = shadowMomentBlurImage->GetImageView();
+
+        //binding 0 : depth faces of every light, binding 1 : horizontal result
+        {
+            std::vector<DescriptorData> data;
+
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.sampler = vulkanGBufferSampler;
+            for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+            {
+                imageInfo.imageView = shadowMomentDepths[i]->GetArrayView();
+                data.push_back(DescriptorData());
+                data.back().imageinfo = imageInfo;
+                data.back().arrayindex = MAX_LIGHT;
+            }
+
+            data.push_back(DescriptorData());
+            data.back().imageinfo = storageInfo;
+
+            descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMOMENT_WARP] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_WARP, DESCRIPTOR_SET_TIER_PASS, data);
+        }
 
-        auto attributeDescriptions = PosNormal::getAttributeDescriptions();
-        attributeDescriptions[1].binding = 1;
-        attributeDescriptions[1].location = 2;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = 0;
+        //binding 0 : horizontal result, binding 1 : mip 0 of the moment cubes
+        {
+            std::vector<DescriptorData> data;
+
+            data.push_back(DescriptorData());
+            data.back().imageinfo = storageInfo;
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+            for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+            {
+                storageInfo.imageView = shadowMomentImages[i]->GetArrayView();
+                data.push_back(DescriptorData());
+                data.back().imageinfo = storageInfo;
+                data.back().arrayindex = MAX_LIGHT;
+            }
 
-        VkPipelineLayout layout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_SHADOWMAP);
+            descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMOMENT_BLUR] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_BLUR, DESCRIPTOR_SET_TIER_PASS, data);
+        }
 
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_SHADOWMAP] = new GraphicPipeline(vulkanDevice);
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_SHADOWMAP]->init(renderPasses[RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP]->getRenderpass(), layout, VK_SAMPLE_COUNT_1_BIT, vertexInputInfo, 1, descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_SHADOWMAP),
-            1024, 1024, false);
+        for (PROGRAM_ID programid : { PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_WARP, PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_BLUR })
+        {
+            computePipelines[programid] = new ComputePipeline(vulkanDevice, pipelineCache->GetPipelineCache());
+            computePipelines[programid]->init(descriptorManager->GetpipeLineLayout(programid), descriptorManager->Getshadermodule(programid)[0]);
+        }
     }
 
     //command buffer will be defined in objectmanager
@@ -642,34 +1242,48 @@ void Graphic::DefinePostProcess()
     {
         std::vector<DescriptorData> data;
 
-        data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_CAMERA_TRANSFORM)->GetDescriptorInfo();
-        data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_GUI_SETTING)->GetDescriptorInfo();
-        data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_LIGHTDATA)->GetDescriptorInfo();
-
         VkDescriptorImageInfo imageInfo{};
         imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.sampler = vulkanTextureSampler;
+        imageInfo.sampler = vulkanGBufferSampler;
 
-        for (int i = 0; i < COLORATTACHMENT_MAX; ++i)
+        for (uint32_t i = 0; i < COLORATTACHMENT_MAX; ++i)
         {
-            imageInfo.imageView = framebufferImages[i + COLORATTACHMENT_MAX]->GetImageView();
+            imageInfo.imageView = framebufferImages[GetLightingInput(i)]->GetImageView();
             data.push_back(DescriptorData());
             data.back().imageinfo = imageInfo;
         }
 
+        imageInfo.sampler = vulkanTextureSampler;
         for (uint32_t i = 0; i < MAX_LIGHT; ++i)
         {
-            imageInfo.imageView = images[i]->GetImageView();
+            imageInfo.imageView = GetShadowDepthImage(i)->GetImageView();
             data.push_back(DescriptorData());
             data.back().imageinfo = imageInfo;
             data.back().arrayindex = MAX_LIGHT;
         }
 
-        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_DEFERRED, data);
-    }
+        //same cubemaps through the compare sampler
+        imageInfo.sampler = vulkanShadowSampler;
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            imageInfo.imageView = GetShadowDepthImage(i)->GetImageView();
+            data.push_back(DescriptorData());
+            data.back().imageinfo = imageInfo;
+            data.back().arrayindex = MAX_LIGHT;
+        }
+
+        //filtered moments, without them the depth cubes only keep the binding valid and are never read through it
+        imageInfo.sampler = vulkanShadowMomentSampler;
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            imageInfo.imageView = Settings::shadowMoments ? shadowMomentImages[i]->GetImageView() : images[i]->GetImageView();
+            data.push_back(DescriptorData());
+            data.back().imageinfo = imageInfo;
+            data.back().arrayindex = MAX_LIGHT;
+        }
+
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_DEFERRED, DESCRIPTOR_SET_TIER_PASS, data);
+    }
 
     //renderpass/framebuffer
     {
@@ -681,41 +1295,200 @@ void Graphic::DefinePostProcess()
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.finalLayout = Settings::headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         renderPasses[RENDERPASS_INDEX::RENDERPASS_POST] = new Renderpass(vulkanDevice);
         Renderpass::Attachment attach;
         attach.type = Renderpass::AttachmentType::ATTACHMENT_COLOR;
         attach.attachmentDescription = colorAttachment;
         attach.bindLocation = 0;
-        for (auto swapimage : swapchainImages)
+
+        //lighting goes to the scene color, the resolve pass writes the swapchain
+        if (Settings::temporalAA)
         {
-            attach.imageViews.push_back(swapimage->GetImageView());
+            attach.attachmentDescription.format = taaImages[TAAImageIndex::TAA_SCENECOLOR]->GetFormat();
+            attach.attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            attach.usage = taaImages[TAAImageIndex::TAA_SCENECOLOR]->GetUsage();
+            attach.imageViews = { taaImages[TAAImageIndex::TAA_SCENECOLOR]->GetImageView() };
+        }
+        else
+        {
+            attach.usage = swapchainImages[0]->GetUsage();
+            for (auto swapimage : swapchainImages)
+            {
+                attach.imageViews.push_back(swapimage->GetImageView());
+            }
         }
         renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->addAttachment(attach);
 
+        if (edgeLighting)
+        {
+            VkAttachmentDescription stencilAttachment{};
+            stencilAttachment.format = edgeStencilImage->GetFormat();
+            stencilAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            stencilAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            stencilAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            stencilAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            stencilAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            stencilAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            stencilAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+            attach.type = Renderpass::AttachmentType::ATTACHMENT_DEPTH;
+            attach.attachmentDescription = stencilAttachment;
+            attach.bindLocation = 1;
+            attach.usage = edgeStencilImage->GetUsage();
+            attach.imageViews = { edgeStencilImage->GetImageView() };
+            renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->addAttachment(attach);
+        }
+
         renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->createRenderPass();
-        renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->createFramebuffers(Settings::windowWidth, Settings::windowHeight, 1, static_cast<uint32_t>(swapchainImageSize));
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->createImagelessFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height, 1);
     }
 
-    //create graphic pipeline
+    //describe graphic pipeline
     {
-        VkVertexInputBindingDescription bindingDescription = PosTexVertex::getBindingDescription();
+        GraphicPipelineDescription& description = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_DEFERRED];
+
         auto attributeDescriptions = PosTexVertex::getAttributeDescriptions();
+        description.vertexBindings = { PosTexVertex::getBindingDescription() };
+        description.vertexAttributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+
+        description.renderpass = renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->getRenderpass();
+        description.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DEFERRED);
+        description.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        description.colorNum = 1;
+        description.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DEFERRED);
+        description.enableCull = false;
+    }
+
+    //edge pass writes 1 where the samples differ, deferred lights stencil 0 once, sample pass lights stencil 1 per sample
+    if (edgeLighting)
+    {
+        VkStencilOpState stencil{};
+        stencil.failOp = VK_STENCIL_OP_KEEP;
+        stencil.passOp = VK_STENCIL_OP_KEEP;
+        stencil.depthFailOp = VK_STENCIL_OP_KEEP;
+        stencil.compareOp = VK_COMPARE_OP_EQUAL;
+        stencil.compareMask = 1;
+        stencil.writeMask = 0;
+        stencil.reference = 0;
+
+        GraphicPipelineDescription& deferred = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_DEFERRED];
+        deferred.enableDepthTest = false;
+        deferred.stencil = stencil;
+
+        GraphicPipelineDescription& sample = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE];
+        sample = deferred;
+        sample.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE);
+        sample.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE);
+        sample.stencil->reference = 1;
+
+        GraphicPipelineDescription& edge = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_DEFERRED_EDGE];
+        edge = deferred;
+        edge.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DEFERRED_EDGE);
+        edge.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DEFERRED_EDGE);
+        edge.stencil->compareOp = VK_COMPARE_OP_ALWAYS;
+        edge.stencil->passOp = VK_STENCIL_OP_REPLACE;
+        edge.stencil->writeMask = 1;
+        edge.stencil->reference = 1;
+        edge.colorWriteMask = 0;
+    }
+
+    if (Settings::temporalAA) DefineTemporalAA();
+}
+
+void Graphic::DefineTemporalAA()
+{
+    //renderpass/framebuffer
+    {
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = vulkanSwapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = Settings::headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        Renderpass* taa = new Renderpass(vulkanDevice);
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_TAA] = taa;
+
+        Renderpass::Attachment attach;
+        attach.type = Renderpass::AttachmentType::ATTACHMENT_COLOR;
+        attach.attachmentDescription = colorAttachment;
+        attach.bindLocation = 0;
+        attach.usage = swapchainImages[0]->GetUsage();
+        for (auto swapimage : swapchainImages)
+        {
+            attach.imageViews.push_back(swapimage->GetImageView());
+        }
+        taa->addAttachment(attach);
+
+        //copied into the history right after the pass
+        Image* historyoutput = taaImages[TAAImageIndex::TAA_HISTORY_OUTPUT];
+        attach.attachmentDescription.format = historyoutput->GetFormat();
+        attach.attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        attach.bindLocation = 1;
+        attach.usage = historyoutput->GetUsage();
+        attach.imageViews = { historyoutput->GetImageView() };
+        taa->addAttachment(attach);
+
+        taa->createRenderPass();
+        taa->createImagelessFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height, 1);
+    }
+
+    //descriptor set
+    {
+        std::vector<DescriptorData> data;
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        imageInfo.sampler = vulkanGBufferSampler;
+        imageInfo.imageView = taaImages[TAAImageIndex::TAA_SCENECOLOR]->GetImageView();
+        data.push_back(DescriptorData());
+        data.back().imageinfo = imageInfo;
+
+        imageInfo.sampler = vulkanHistorySampler;
+        imageInfo.imageView = taaImages[TAAImageIndex::TAA_HISTORY]->GetImageView();
+        data.push_back(DescriptorData());
+        data.back().imageinfo = imageInfo;
+
+        imageInfo.sampler = vulkanGBufferSampler;
+        imageInfo.imageView = framebufferImages[FrameBufferIndex::VELOCITYATTACHMENT]->GetImageView();
+        data.push_back(DescriptorData());
+        data.back().imageinfo = imageInfo;
+
+        imageInfo.imageView = framebufferImages[FrameBufferIndex::VIEWDEPTHATTACHMENT]->GetImageView();
+        data.push_back(DescriptorData());
+        data.back().imageinfo = imageInfo;
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_TAA] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_TAA, DESCRIPTOR_SET_TIER_PASS, data);
+    }
 
-        VkPipelineLayout layout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DEFERRED);
+    //describe graphic pipeline
+    {
+        GraphicPipelineDescription& description = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_TAA];
 
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_DEFERRED] = new GraphicPipeline(vulkanDevice);
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_DEFERRED]->init(renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->getRenderpass(), layout, VK_SAMPLE_COUNT_1_BIT, vertexInputInfo, 1, descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DEFERRED),
-            Settings::windowWidth, Settings::windowHeight, false);
+        auto attributeDescriptions = PosTexVertex::getAttributeDescriptions();
+        description.vertexBindings = { PosTexVertex::getBindingDescription() };
+        description.vertexAttributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+
+        description.renderpass = renderPasses[RENDERPASS_INDEX::RENDERPASS_TAA]->getRenderpass();
+        description.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_TAA);
+        description.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        description.colorNum = 2;
+        description.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_TAA);
+        description.enableCull = false;
+        description.enableDepthTest = false;
     }
+}
+
+void Graphic::RecordPostProcess()
+{
+    //post command buffers hold the whole merged renderpass, ObjectManager records them with the objects
+    if (Settings::mergedDeferred) return;
 
     //create commandbuffer for post rendering
     {
@@ -731,16 +1504,36 @@ void Graphic::DefinePostProcess()
                 throw std::runtime_error("failed to begin recording command buffer!");
             }
 
+            BeginDescriptorBinding(vulkanCommandBuffers[i]);
+            graphicsBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED]);
+
+            uint32_t slot = static_cast<uint32_t>(i);
+            gpuProfiler->BeginRecord(slot, vulkanCommandBuffers[i]);
+            gpuProfiler->BeginScope(slot, vulkanCommandBuffers[i], RENDERPASS_NAMES[RENDERPASS_INDEX::RENDERPASS_POST], profilePipelineStatistics[RENDERPASS_INDEX::RENDERPASS_POST]);
+
             renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->beginRenderpass(vulkanCommandBuffers[i], static_cast<uint32_t>(i - CMD_INDEX::CMD_POST));
 
-            vkCmdBindPipeline(vulkanCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicPipelines[PROGRAM_ID::PROGRAM_ID_DEFERRED]->GetPipeline());
+            //edge classification has to come first, the other two read its stencil
+            std::vector<PROGRAM_ID> lightingprograms = { PROGRAM_ID::PROGRAM_ID_DEFERRED };
+            if (edgeLighting) lightingprograms = { PROGRAM_ID::PROGRAM_ID_DEFERRED_EDGE, PROGRAM_ID::PROGRAM_ID_DEFERRED, PROGRAM_ID::PROGRAM_ID_DEFERRED_SAMPLE };
 
-            descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED]->BindDescriptorSet(vulkanCommandBuffers[i], descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DEFERRED), {});
+            for (PROGRAM_ID programid : lightingprograms)
+            {
+                GraphicPipeline* pipeline = GetDrawPipeline(programid);
+                if (pipeline == nullptr) break;
+
+                graphicsBinder->BindPipeline(programid, pipeline->GetPipeline());
+                graphicsBinder->Flush();
 
-            DrawDrawtarget(vulkanCommandBuffers[i], drawtargets[DRAWTARGET_INDEX::DRAWTARGET_RECTANGLE]);
+                DrawDrawtarget(vulkanCommandBuffers[i], drawtargets[DRAWTARGET_INDEX::DRAWTARGET_RECTANGLE]);
+            }
 
             vkCmdEndRenderPass(vulkanCommandBuffers[i]);
 
+            gpuProfiler->EndScope(slot, vulkanCommandBuffers[i]);
+
+            if (Settings::temporalAA) RecordTemporalAA(vulkanCommandBuffers[i], slot, static_cast<uint32_t>(i - CMD_INDEX::CMD_POST));
+
             if (vkEndCommandBuffer(vulkanCommandBuffers[i]) != VK_SUCCESS)
             {
                 throw std::runtime_error("failed to record command buffer!");
@@ -749,44 +1542,454 @@ void Graphic::DefinePostProcess()
     }
 }
 
+void Graphic::RecordTemporalAA(VkCommandBuffer cmdBuffer, uint32_t slot, uint32_t imageindex)
+{
+    //scene color of this frame is read by the resolve
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    gpuProfiler->BeginScope(slot, cmdBuffer, RENDERPASS_NAMES[RENDERPASS_INDEX::RENDERPASS_TAA], profilePipelineStatistics[RENDERPASS_INDEX::RENDERPASS_TAA]);
+
+    renderPasses[RENDERPASS_INDEX::RENDERPASS_TAA]->beginRenderpass(cmdBuffer, imageindex);
+
+    if (GraphicPipeline* pipeline = GetDrawPipeline(PROGRAM_ID::PROGRAM_ID_TAA); pipeline != nullptr)
+    {
+        graphicsBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_TAA]);
+        graphicsBinder->BindPipeline(PROGRAM_ID::PROGRAM_ID_TAA, pipeline->GetPipeline());
+        graphicsBinder->Flush();
+
+        DrawDrawtarget(cmdBuffer, drawtargets[DRAWTARGET_INDEX::DRAWTARGET_RECTANGLE]);
+    }
+
+    vkCmdEndRenderPass(cmdBuffer);
+
+    gpuProfiler->EndScope(slot, cmdBuffer);
+
+    //command buffers are recorded once per swapchain image, so the history can not ping-pong between two images
+    //the resolve writes a separate output and it is copied over the history for the next frame
+    VkImageMemoryBarrier barriers[2] = {};
+    for (VkImageMemoryBarrier& barrier : barriers)
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+    }
+
+    //renderpass already left the output in TRANSFER_SRC_OPTIMAL
+    barriers[0].image = taaImages[TAAImageIndex::TAA_HISTORY_OUTPUT]->GetImage();
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    barriers[1].image = taaImages[TAAImageIndex::TAA_HISTORY]->GetImage();
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 2, barriers);
+
+    VkImageCopy region{};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = 1;
+    region.dstSubresource = region.srcSubresource;
+    region.extent = { vulkanSwapChainExtent.width, vulkanSwapChainExtent.height, 1 };
+
+    vkCmdCopyImage(cmdBuffer, barriers[0].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, barriers[1].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barriers[1]);
+}
+
+void Graphic::RecordShadowMoments(CMD_INDEX cmdindex)
+{
+    VkCommandBuffer cmdBuffer = vulkanCommandBuffers[cmdindex];
+
+    const uint32_t size = Settings::shadowMomentSize;
+    const uint32_t mipLevels = shadowMomentImages[0]->GetMipLevels();
+    //8x8 groups, one layer per face of every light
+    const uint32_t groupcount = (size + 7) / 8;
+
+    gpuProfiler->BeginScope(cmdindex, cmdBuffer, "Shadow Moments");
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 6;
+
+    //depth cubes were just rendered, every mip of the moments is rewritten so the old content is discarded
+    {
+        VkMemoryBarrier depthBarrier{};
+        depthBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        std::vector<VkImageMemoryBarrier> barriers;
+        for (auto image : shadowMomentImages)
+        {
+            barrier.image = image->GetImage();
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.srcAccessMask = 0;
+
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barriers.push_back(barrier);
+
+            barrier.subresourceRange.baseMipLevel = 1;
+            barrier.subresourceRange.levelCount = mipLevels - 1;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barriers.push_back(barrier);
+        }
+
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            1, &depthBarrier, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+
+    //warp with the horizontal blur, the blur is separable because the moments are blurred instead of the depth
+    computeBinder->BindPipeline(PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_WARP, computePipelines[PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_WARP]->GetPipeline());
+    computeBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMOMENT_WARP]);
+    computeBinder->Flush();
+    vkCmdDispatch(cmdBuffer, groupcount, groupcount, 6 * MAX_LIGHT);
+
+    {
+        VkMemoryBarrier blurBarrier{};
+        blurBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        blurBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        blurBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            1, &blurBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    computeBinder->BindPipeline(PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_BLUR, computePipelines[PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_BLUR]->GetPipeline());
+    computeBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMOMENT_BLUR]);
+    computeBinder->Flush();
+    vkCmdDispatch(cmdBuffer, groupcount, groupcount, 6 * MAX_LIGHT);
+
+    //mip chain, every light at once per level
+    std::vector<VkImageMemoryBarrier> barriers(MAX_LIGHT, barrier);
+    barrier.subresourceRange.levelCount = 1;
+
+    int32_t mipsize = static_cast<int32_t>(size);
+    for (uint32_t mip = 1; mip <= mipLevels; ++mip)
+    {
+        //source level is done, mip 0 comes from compute and the others from the previous blit
+        VkPipelineStageFlags srcStage = (mip == 1) ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            barriers[i] = barrier;
+            barriers[i].image = shadowMomentImages[i]->GetImage();
+            barriers[i].subresourceRange.baseMipLevel = mip - 1;
+            barriers[i].oldLayout = (mip == 1) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barriers[i].srcAccessMask = (mip == 1) ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+            barriers[i].newLayout = (mip == mipLevels) ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barriers[i].dstAccessMask = (mip == mipLevels) ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_TRANSFER_READ_BIT;
+        }
+
+        vkCmdPipelineBarrier(cmdBuffer, srcStage, (mip == mipLevels) ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, MAX_LIGHT, barriers.data());
+
+        if (mip == mipLevels) break;
+
+        int32_t nextsize = mipsize > 1 ? mipsize / 2 : 1;
+
+        VkImageBlit blit{};
+        blit.srcOffsets[1] = { mipsize, mipsize, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = mip - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 6;
+        blit.dstOffsets[1] = { nextsize, nextsize, 1 };
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstSubresource.mipLevel = mip;
+
+        for (auto image : shadowMomentImages)
+        {
+            vkCmdBlitImage(cmdBuffer, image->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        }
+
+        //read by the blit is over, the level is final
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
+
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, MAX_LIGHT, barriers.data());
+
+        mipsize = nextsize;
+    }
+
+    gpuProfiler->EndScope(cmdindex, cmdBuffer);
+}
+
+void Graphic::DefineMergedDeferred()
+{
+    //renderpass/framebuffer
+    {
+        VkAttachmentDescription gbufferAttachment{};
+        gbufferAttachment.samples = vulkanMSAASamples;
+        gbufferAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        gbufferAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        gbufferAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        gbufferAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        gbufferAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        gbufferAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        //resolved gbuffer never leaves the renderpass
+        VkAttachmentDescription resolveAttachment{};
+        resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = vulkanDepthFormat;
+        depthAttachment.samples = vulkanMSAASamples;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = vulkanSwapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = Settings::headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        Renderpass* merged = new Renderpass(vulkanDevice);
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_MERGED] = merged;
+
+        //attachment index == bindLocation == position in GetGBufferAttachments, swapchain image comes last
+        std::vector<FrameBufferIndex> gbufferattachments = GetGBufferAttachments();
+        uint32_t outputcount = GetGBufferOutputCount();
+        uint32_t swapchainlocation = static_cast<uint32_t>(gbufferattachments.size());
+
+        Renderpass::Attachment attach;
+        for (uint32_t i = 0; i < swapchainlocation; ++i)
+        {
+            FrameBufferIndex index = gbufferattachments[i];
+            if (index == DEPTHATTACHMENT)
+            {
+                attach.type = Renderpass::AttachmentType::ATTACHMENT_DEPTH;
+                attach.attachmentDescription = depthAttachment;
+            }
+            else if (i < outputcount)
+            {
+                attach.type = Renderpass::AttachmentType::ATTACHMENT_COLOR;
+                attach.attachmentDescription = gbufferAttachment;
+            }
+            else
+            {
+                attach.type = Renderpass::AttachmentType::ATTACHMENT_RESOLVE;
+                attach.attachmentDescription = resolveAttachment;
+            }
+            attach.attachmentDescription.format = framebufferImages[index]->GetFormat();
+            attach.bindLocation = i;
+            attach.usage = framebufferImages[index]->GetUsage();
+            attach.imageViews = { framebufferImages[index]->GetImageView() };
+            merged->addAttachment(attach);
+        }
+
+        attach.type = Renderpass::AttachmentType::ATTACHMENT_COLOR;
+        attach.attachmentDescription = colorAttachment;
+        attach.bindLocation = swapchainlocation;
+        attach.usage = swapchainImages[0]->GetUsage();
+        attach.imageViews.clear();
+        for (auto swapimage : swapchainImages)
+        {
+            attach.imageViews.push_back(swapimage->GetImageView());
+        }
+        merged->addAttachment(attach);
+
+        Renderpass::Subpass gbufferSubpass;
+        Renderpass::Subpass lightingSubpass;
+        for (uint32_t i = 0; i < outputcount; ++i)
+        {
+            gbufferSubpass.colorAttachments.push_back(i);
+        }
+        //swapchain subpass is single sampled, so it reads the resolved samples when there are any
+        bool resolve = ResolvesGBuffer();
+        for (uint32_t i = 0; i < COLORATTACHMENT_MAX; ++i)
+        {
+            if (resolve) gbufferSubpass.resolveAttachments.push_back(outputcount + i);
+            lightingSubpass.inputAttachments.push_back(resolve ? outputcount + i : i);
+        }
+        gbufferSubpass.depthAttachment = swapchainlocation - 1;
+        lightingSubpass.colorAttachments.push_back(swapchainlocation);
+
+        merged->addSubpass(gbufferSubpass);
+        merged->addSubpass(lightingSubpass);
+
+        merged->createRenderPass();
+        merged->createImagelessFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height, 1);
+    }
+
+    //descriptor set
+    {
+        std::vector<DescriptorData> data;
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.sampler = VK_NULL_HANDLE;
+
+        for (uint32_t i = 0; i < COLORATTACHMENT_MAX; ++i)
+        {
+            imageInfo.imageView = framebufferImages[GetLightingInput(i)]->GetImageView();
+            data.push_back(DescriptorData());
+            data.back().imageinfo = imageInfo;
+        }
+
+        imageInfo.sampler = vulkanTextureSampler;
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            imageInfo.imageView = GetShadowDepthImage(i)->GetImageView();
+            data.push_back(DescriptorData());
+            data.back().imageinfo = imageInfo;
+            data.back().arrayindex = MAX_LIGHT;
+        }
+
+        //same cubemaps through the compare sampler
+        imageInfo.sampler = vulkanShadowSampler;
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            imageInfo.imageView = GetShadowDepthImage(i)->GetImageView();
+            data.push_back(DescriptorData());
+            data.back().imageinfo = imageInfo;
+            data.back().arrayindex = MAX_LIGHT;
+        }
+
+        //filtered moments, without them the depth cubes only keep the binding valid and are never read through it
+        imageInfo.sampler = vulkanShadowMomentSampler;
+        for (uint32_t i = 0; i < MAX_LIGHT; ++i)
+        {
+            imageInfo.imageView = Settings::shadowMoments ? shadowMomentImages[i]->GetImageView() : images[i]->GetImageView();
+            data.push_back(DescriptorData());
+            data.back().imageinfo = imageInfo;
+            data.back().arrayindex = MAX_LIGHT;
+        }
+
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED_SUBPASS] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS, DESCRIPTOR_SET_TIER_PASS, data);
+    }
+
+    //describe graphic pipeline
+    {
+        GraphicPipelineDescription& description = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS];
+
+        auto attributeDescriptions = PosTexVertex::getAttributeDescriptions();
+        description.vertexBindings = { PosTexVertex::getBindingDescription() };
+        description.vertexAttributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+
+        description.renderpass = renderPasses[RENDERPASS_INDEX::RENDERPASS_MERGED]->getRenderpass();
+        description.subpass = 1;
+        description.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS);
+        description.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        description.colorNum = 1;
+        description.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS);
+        description.enableCull = false;
+    }
+}
+
 void Graphic::CloseSwapChain()
 {
-    for (auto descriptorset : descriptorSets)
+    CloseFrameBufferImages();
+
+    for (auto image : swapchainImages)
     {
+        image->close();
+        delete image;
+    }
+    swapchainImages.clear();
+
+    vkDestroySwapchainKHR(vulkanDevice, vulkanSwapChain, nullptr);
+    vulkanSwapChain = VK_NULL_HANDLE;
+}
+
+void Graphic::CloseDrawBehavior()
+{
+    WaitPendingPipelines();
+
+    for (auto& descriptorset : descriptorSets)
+    {
+        if (descriptorset == nullptr) continue;
+
         descriptorset->close();
         delete descriptorset;
+        descriptorset = nullptr;
     }
 
     vkFreeCommandBuffers(vulkanDevice, application->GetCommandPool(), static_cast<uint32_t>(vulkanCommandBuffers.size()), vulkanCommandBuffers.data());
     vulkanCommandBuffers.clear();
 
-    for (auto renderpass : renderPasses)
+    for (auto& renderpass : renderPasses)
     {
+        if (renderpass == nullptr) continue;
+
         renderpass->close();
         delete renderpass;
+        renderpass = nullptr;
     }
 
-    for (auto pipeline : graphicPipelines)
+    for (auto& pipeline : graphicPipelines)
     {
+        if (pipeline == nullptr) continue;
+
         pipeline->close();
         delete pipeline;
+        pipeline = nullptr;
     }
 
-    for (auto image : framebufferImages)
+    for (auto& pipeline : computePipelines)
     {
-        image->close();
-        delete image;
+        if (pipeline == nullptr) continue;
+
+        pipeline->close();
+        delete pipeline;
+        pipeline = nullptr;
     }
-    framebufferImages.clear();
 
-    for (auto image : swapchainImages)
+    CloseShadowMomentImages();
+
+    for (auto& description : pipelineDescriptions)
     {
-        image->close();
-        delete image;
+        description = GraphicPipelineDescription();
     }
-    swapchainImages.clear();
-
-    vkDestroySwapchainKHR(vulkanDevice, vulkanSwapChain, nullptr);
 }
 
 void Graphic::RecreateSwapChain()
@@ -796,17 +1999,191 @@ void Graphic::RecreateSwapChain()
         glfwWaitEvents();
     }
 
+    //images of frames in flight are about to be destroyed
     vkDeviceWaitIdle(vulkanDevice);
 
-    CloseSwapChain();
-    SetupSwapChain();
-    AllocateCommandBuffer();
-    DefineDrawBehavior();
+    VkFormat oldFormat = vulkanSwapChainImageFormat;
+    uint32_t oldImageSize = swapchainImageSize;
+    VkSwapchainKHR oldSwapChain = vulkanSwapChain;
 
-    LevelManager::GetCurrentLevel()->postinit();
+    //sample count and gbuffer layout follow the antialiasing mode
+    bool rebuild = drawBehaviorRebuild;
+    if (rebuild) SelectSampleCount();
+
+    //only size dependent images are recreated, old swapchain is handed over to the new one
+    {
+        CloseFrameBufferImages();
+
+        for (auto image : swapchainImages)
+        {
+            image->close();
+            delete image;
+        }
+        swapchainImages.clear();
+
+        SetupSwapChain(oldSwapChain);
+
+        vkDestroySwapchainKHR(vulkanDevice, oldSwapChain, nullptr);
+    }
+
+    //renderpass depends on swapchain format, rebuild everything in this rare case
+    if (vulkanSwapChainImageFormat != oldFormat || rebuild)
+    {
+        CloseDrawBehavior();
+
+        //loaded programs depend on the lighting path
+        if (rebuild)
+        {
+            delete graphicsBinder;
+            delete computeBinder;
+            descriptorManager->close();
+            delete descriptorManager;
+
+            descriptorManager = new DescriptorManager(vulkanDevice);
+            descriptorManager->init(edgeLighting, MAX_FRAMES_IN_FLIGHT);
+            graphicsBinder = new DescriptorBinder(descriptorManager, VK_PIPELINE_BIND_POINT_GRAPHICS);
+            computeBinder = new DescriptorBinder(descriptorManager, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+            drawBehaviorRebuild = false;
+        }
+
+        AllocateCommandBuffer();
+        DefineDrawBehavior();
+
+        pipelineCache->save();
+
+        imagesInFlight.assign(swapchainImageSize, VK_NULL_HANDLE);
+
+        LevelManager::GetCurrentLevel()->postinit();
+        return;
+    }
+
+    if (swapchainImageSize != oldImageSize)
+    {
+        vkFreeCommandBuffers(vulkanDevice, application->GetCommandPool(), static_cast<uint32_t>(vulkanCommandBuffers.size()), vulkanCommandBuffers.data());
+        vulkanCommandBuffers.clear();
+        AllocateCommandBuffer();
+    }
+    imagesInFlight.assign(swapchainImageSize, VK_NULL_HANDLE);
+
+    UpdateFrameBufferAttachments();
+
+    //render area is recorded in command buffers
+    RecordCommandBuffers();
+}
+
+void Graphic::UpdateFrameBufferAttachments()
+{
+    std::vector<VkImageView> swapchainViews;
+    for (auto swapimage : swapchainImages)
+    {
+        swapchainViews.push_back(swapimage->GetImageView());
+    }
+
+    std::vector<FrameBufferIndex> gbufferattachments = GetGBufferAttachments();
+    uint32_t gbufferattachmentcount = static_cast<uint32_t>(gbufferattachments.size());
+
+    if (Settings::mergedDeferred)
+    {
+        Renderpass* merged = renderPasses[RENDERPASS_INDEX::RENDERPASS_MERGED];
+        for (uint32_t i = 0; i < gbufferattachmentcount; ++i)
+        {
+            merged->setImageViews(i, { framebufferImages[gbufferattachments[i]]->GetImageView() });
+        }
+        merged->setImageViews(gbufferattachmentcount, swapchainViews);
+        merged->resizeFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height);
+
+        //lighting input is the input attachment at binding 0~2 of the pass set
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.sampler = VK_NULL_HANDLE;
+
+        for (uint32_t i = 0; i < COLORATTACHMENT_MAX; ++i)
+        {
+            imageInfo.imageView = framebufferImages[GetLightingInput(i)]->GetImageView();
+
+            DescriptorData data;
+            data.imageinfo = imageInfo;
+            descriptorManager->UpdateDescriptorSet(PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS, descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED_SUBPASS], i, data);
+        }
+
+        return;
+    }
+
+    {
+        if (Settings::temporalAA) renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->setImageViews(0, { taaImages[TAAImageIndex::TAA_SCENECOLOR]->GetImageView() });
+        else renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->setImageViews(0, swapchainViews);
+        if (edgeStencilImage != nullptr) renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->setImageViews(1, { edgeStencilImage->GetImageView() });
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_POST]->resizeFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height);
+    }
+
+    {
+        for (uint32_t i = 0; i < gbufferattachmentcount; ++i)
+        {
+            renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->setImageViews(i, { framebufferImages[gbufferattachments[i]]->GetImageView() });
+        }
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->resizeFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height);
+    }
+
+    //gbuffer is read by deferred pass at binding 0~2 of the pass set
+    {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.sampler = vulkanGBufferSampler;
+
+        for (uint32_t i = 0; i < COLORATTACHMENT_MAX; ++i)
+        {
+            imageInfo.imageView = framebufferImages[GetLightingInput(i)]->GetImageView();
+
+            DescriptorData data;
+            data.imageinfo = imageInfo;
+            descriptorManager->UpdateDescriptorSet(PROGRAM_ID::PROGRAM_ID_DEFERRED, descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED], i, data);
+        }
+    }
+
+    if (Settings::temporalAA)
+    {
+        Renderpass* taa = renderPasses[RENDERPASS_INDEX::RENDERPASS_TAA];
+        taa->setImageViews(0, swapchainViews);
+        taa->setImageViews(1, { taaImages[TAAImageIndex::TAA_HISTORY_OUTPUT]->GetImageView() });
+        taa->resizeFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height);
+
+        //binding 0~3 : scene color, history, velocity, view depth
+        std::array<std::pair<VkImageView, VkSampler>, 4> inputs = { {
+            { taaImages[TAAImageIndex::TAA_SCENECOLOR]->GetImageView(), vulkanGBufferSampler },
+            { taaImages[TAAImageIndex::TAA_HISTORY]->GetImageView(), vulkanHistorySampler },
+            { framebufferImages[FrameBufferIndex::VELOCITYATTACHMENT]->GetImageView(), vulkanGBufferSampler },
+            { framebufferImages[FrameBufferIndex::VIEWDEPTHATTACHMENT]->GetImageView(), vulkanGBufferSampler },
+        } };
+
+        for (uint32_t i = 0; i < inputs.size(); ++i)
+        {
+            DescriptorData data;
+            data.imageinfo = VkDescriptorImageInfo{ inputs[i].second, inputs[i].first, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+            descriptorManager->UpdateDescriptorSet(PROGRAM_ID::PROGRAM_ID_TAA, descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_TAA], i, data);
+        }
+    }
+}
+
+void Graphic::DumpFrame(uint32_t imageIndex, uint64_t frame)
+{
+    vkWaitForFences(vulkanDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+
+    std::vector<uint8_t> pixels;
+    VulkanMemoryManager::ReadImage(swapchainImages[imageIndex], pixels);
+
+    std::string filename = Settings::dumpDirectory + "frame_" + std::to_string(frame) + ".png";
+    if (PNGWriter::WriteRGBA8(filename, vulkanSwapChainExtent.width, vulkanSwapChainExtent.height, pixels.data()))
+    {
+        std::cout << "frame " << frame << " written to " << filename << std::endl;
+    }
+    else
+    {
+        std::cout << "failed to write " << filename << std::endl;
+    }
 }
 
-void Graphic::DrawDrawtarget(const VkCommandBuffer& cmdBuffer, const DrawTarget& target)
+void Graphic::DrawDrawtarget(const VkCommandBuffer& cmdBuffer, const DrawTarget& target, const glm::mat4* objectmat)
 {
     uint32_t size = static_cast<uint32_t>(target.vertexIndices.size());
 
@@ -818,8 +2195,22 @@ void Graphic::DrawDrawtarget(const VkCommandBuffer& cmdBuffer, const DrawTarget&
         VkDeviceSize offsets[] = { 0 };
         vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
 
+        //bound whenever the mesh has a normal stream, the shadow pipeline just declares no binding 2 and ignores it
+        if (target.vertexIndices[i].attribute.has_value())
+        {
+            VkBuffer attributebuffer = VulkanMemoryManager::GetBuffer(target.vertexIndices[i].attribute.value())->GetBuffer();
+            vkCmdBindVertexBuffers(cmdBuffer, PackedNormal::BINDING, 1, &attributebuffer, offsets);
+        }
+
         VkBuffer indexbuffer = VulkanMemoryManager::GetBuffer(target.vertexIndices[i].index)->GetBuffer();
-        vkCmdBindIndexBuffer(cmdBuffer, indexbuffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindIndexBuffer(cmdBuffer, indexbuffer, 0, target.vertexIndices[i].indexType);
+
+        //range and instances are picked every frame
+        if (objectmat != nullptr && !target.lods.empty())
+        {
+            lodSelector->RecordDraw(cmdBuffer, currentCommandIndex, target, drawLODView, objectmat);
+            continue;
+        }
 
         if (target.instancebuffer.has_value())
         {
@@ -835,31 +2226,47 @@ void Graphic::DrawDrawtarget(const VkCommandBuffer& cmdBuffer, const DrawTarget&
 
 void Graphic::DefineDrawBehavior()
 {
-    DefinePostProcess();
+    //read by the lighting descriptor sets
+    if (Settings::shadowMoments) CreateShadowMomentImages();
+
+    if (Settings::mergedDeferred) DefineMergedDeferred();
+    else DefinePostProcess();
     DefineShadowMap();
 
+    //every program shares the global layout
     {
         std::vector<DescriptorData> data;
 
         data.push_back(DescriptorData());
         data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_CAMERA_TRANSFORM)->GetDescriptorInfo();
         data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_OBJECT_MATRIX)->GetDescriptorInfo();
+        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_GUI_SETTING)->GetDescriptorInfo();
+        data.push_back(DescriptorData());
+        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_LIGHTDATA)->GetDescriptorInfo();
 
-        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_OBJ] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_BASERENDER, data);
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_GLOBAL] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_DEFERRED, DESCRIPTOR_SET_TIER_GLOBAL, data);
     }
-    
+
     {
         std::vector<DescriptorData> data;
 
         data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_CAMERA_TRANSFORM)->GetDescriptorInfo();
+        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_OBJECT_MATRIX)->GetArrayDescriptorInfo();
+
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_OBJ] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_BASERENDER, DESCRIPTOR_SET_TIER_MATERIAL, data);
+    }
+    
+    {
+        std::vector<DescriptorData> data;
+
         data.push_back(DescriptorData());
-        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_LIGHT_OBJECT_MATRIX)->GetDescriptorInfo();
+        data.back().bufferinfo = VulkanMemoryManager::GetUniformBuffer(UNIFORM_LIGHT_OBJECT_MATRIX)->GetArrayDescriptorInfo();
 
-        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_LIGHT_OBJ] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_BASERENDER, data);
+        descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_LIGHT_OBJ] = descriptorManager->CreateDescriptorSet(PROGRAM_ID::PROGRAM_ID_BASERENDER, DESCRIPTOR_SET_TIER_MATERIAL, data);
     }
 
+    //merged renderpass already holds the gbuffer subpass
+    if (!Settings::mergedDeferred)
     {
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = vulkanSwapChainImageFormat;
@@ -869,7 +2276,8 @@ void Graphic::DefineDrawBehavior()
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        //without resolve the post pass samples the gbuffer outputs themselves
+        colorAttachment.finalLayout = ResolvesGBuffer() ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkAttachmentDescription colorAttachmentResolve{};
         colorAttachmentResolve.format = vulkanSwapChainImageFormat;
@@ -894,97 +2302,152 @@ void Graphic::DefineDrawBehavior()
         renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE] = new Renderpass(vulkanDevice);
         Renderpass::Attachment attach;
 
-        attach.type = Renderpass::AttachmentType::ATTACHMENT_COLOR;
-        attach.attachmentDescription = colorAttachment;
-        for (int i = 0; i < COLORATTACHMENT_MAX; ++i)
+        //attachment index == bindLocation == position in GetGBufferAttachments
+        std::vector<FrameBufferIndex> gbufferattachments = GetGBufferAttachments();
+        uint32_t outputcount = GetGBufferOutputCount();
+        for (uint32_t i = 0; i < gbufferattachments.size(); ++i)
         {
-            attach.attachmentDescription.format = framebufferImages[i]->GetFormat();
+            FrameBufferIndex index = gbufferattachments[i];
+            if (index == DEPTHATTACHMENT)
+            {
+                attach.type = Renderpass::AttachmentType::ATTACHMENT_DEPTH;
+                attach.attachmentDescription = depthAttachment;
+            }
+            else if (i < outputcount)
+            {
+                attach.type = Renderpass::AttachmentType::ATTACHMENT_COLOR;
+                attach.attachmentDescription = colorAttachment;
+                attach.attachmentDescription.format = framebufferImages[index]->GetFormat();
+            }
+            else
+            {
+                attach.type = Renderpass::AttachmentType::ATTACHMENT_RESOLVE;
+                attach.attachmentDescription = colorAttachmentResolve;
+                attach.attachmentDescription.format = framebufferImages[index]->GetFormat();
+            }
             attach.bindLocation = i;
-            attach.imageViews.push_back(framebufferImages[i]->GetImageView());
+            attach.usage = framebufferImages[index]->GetUsage();
+            attach.imageViews = { framebufferImages[index]->GetImageView() };
             renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->addAttachment(attach);
-            attach.imageViews.clear();
         }
 
-        attach.type = Renderpass::AttachmentType::ATTACHMENT_RESOLVE;
-        attach.attachmentDescription = colorAttachmentResolve;
-        for (int i = 0; i < COLORATTACHMENT_MAX; ++i)
-        {
-            int msaaindex = i + COLORATTACHMENT_MAX;
-            attach.attachmentDescription.format = framebufferImages[msaaindex]->GetFormat();
-            attach.bindLocation = msaaindex;
-            attach.imageViews.push_back(framebufferImages[msaaindex]->GetImageView());
-            renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->addAttachment(attach);
-            attach.imageViews.clear();
-        }
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->createRenderPass();
+        renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->createImagelessFramebuffer(vulkanSwapChainExtent.width, vulkanSwapChainExtent.height, 1);
+    }
 
-        attach.attachmentDescription = depthAttachment;
-        attach.type = Renderpass::AttachmentType::ATTACHMENT_DEPTH;
-        attach.bindLocation = DEPTHATTACHMENT;
-        attach.imageViews.push_back(framebufferImages[DEPTHATTACHMENT]->GetImageView());
-        renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->addAttachment(attach);
-        attach.imageViews.clear();
+    VkRenderPass gbufferRenderpass = renderPasses[Settings::mergedDeferred ? RENDERPASS_INDEX::RENDERPASS_MERGED : RENDERPASS_INDEX::RENDERPASS_PRE]->getRenderpass();
 
-        renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->createRenderPass();
-        renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->createFramebuffers(Settings::windowWidth, Settings::windowHeight, 1);
+    //describe graphic pipeline
+    {
+        GraphicPipelineDescription& description = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_BASERENDER];
+
+        VkVertexInputBindingDescription instanceBinding{};
+        instanceBinding.binding = 1;
+        instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        instanceBinding.stride = sizeof(glm::vec3);
+        description.vertexBindings = { PackedPosition::getBindingDescription(), instanceBinding, PackedNormal::getBindingDescription() };
+
+        VkVertexInputAttributeDescription instanceAttribute{};
+        instanceAttribute.binding = 1;
+        instanceAttribute.location = 2;
+        instanceAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+        instanceAttribute.offset = 0;
+        description.vertexAttributes = { PackedPosition::getAttributeDescription(), PackedNormal::getAttributeDescription(), instanceAttribute };
+
+        description.renderpass = gbufferRenderpass;
+        description.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_BASERENDER);
+        description.msaaSamples = vulkanMSAASamples;
+        description.colorNum = GetGBufferOutputCount();
+        description.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_BASERENDER);
+        description.enableCull = true;
     }
 
-    //create graphic pipeline
     {
-        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions;
-        bindingDescriptions[0] = PosNormal::getBindingDescription();
-        bindingDescriptions[1].binding = 1;
-        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-        bindingDescriptions[1].stride = sizeof(glm::vec3);
+        GraphicPipelineDescription& description = pipelineDescriptions[PROGRAM_ID::PROGRAM_ID_DIFFUSE];
+
+        VkVertexInputBindingDescription instanceBinding{};
+        instanceBinding.binding = 1;
+        instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        instanceBinding.stride = sizeof(glm::vec3);
+        description.vertexBindings = { PackedPosition::getBindingDescription(), instanceBinding, PackedNormal::getBindingDescription() };
+        description.vertexAttributes = { PackedPosition::getAttributeDescription(), PackedNormal::getAttributeDescription() };
+
+        description.renderpass = gbufferRenderpass;
+        description.pipelinelayout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DIFFUSE);
+        description.msaaSamples = vulkanMSAASamples;
+        description.colorNum = GetGBufferOutputCount();
+        description.shaderStages = descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DIFFUSE);
+        description.enableCull = true;
+    }
+
+    lightingConstants = GetLightingConstants();
+    for (PROGRAM_ID programid : LIGHTING_PROGRAMS)
+    {
+        pipelineDescriptions[programid].specializationConstants = lightingConstants;
+    }
 
-        auto vertdesc = PosNormal::getAttributeDescriptions();
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions;
-        attributeDescriptions[0] = vertdesc[0];
-        attributeDescriptions[1] = vertdesc[1];
-        attributeDescriptions[2].binding = 1;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[2].offset = 0;
+    CompilePipelines();
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    RecordPostProcess();
+}
 
-        VkPipelineLayout layout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_BASERENDER);
+void Graphic::CompilePipelines()
+{
+    ThreadPool* threadPool = application->GetThreadPool();
 
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_BASERENDER] = new GraphicPipeline(vulkanDevice);
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_BASERENDER]->init(renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->getRenderpass(), layout, vulkanMSAASamples, vertexInputInfo, 3, descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_BASERENDER),
-            Settings::windowWidth, Settings::windowHeight, true);
-    }
+    std::vector<std::future<void>> results;
+    results.reserve(PROGRAM_ID::PROGRAM_ID_MAX);
 
+    for (uint32_t i = 0; i < PROGRAM_ID::PROGRAM_ID_MAX; ++i)
     {
-        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions;
-        bindingDescriptions[0] = PosNormal::getBindingDescription();
-        bindingDescriptions[1].binding = 1;
-        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-        bindingDescriptions[1].stride = sizeof(glm::vec3);
+        //not described at startup, left for RequestPipeline
+        if (pipelineDescriptions[i].renderpass == VK_NULL_HANDLE) continue;
 
-        auto vertdesc = PosNormal::getAttributeDescriptions();
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions;
-        attributeDescriptions[0] = vertdesc[0];
-        attributeDescriptions[1] = vertdesc[1];
+        descriptorManager->ValidateVertexInput(static_cast<PROGRAM_ID>(i), pipelineDescriptions[i].vertexAttributes);
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        graphicPipelines[i] = new GraphicPipeline(vulkanDevice, pipelineCache->GetPipelineCache());
 
-        VkPipelineLayout layout = descriptorManager->GetpipeLineLayout(PROGRAM_ID::PROGRAM_ID_DIFFUSE);
+        GraphicPipeline* pipeline = graphicPipelines[i];
+        const GraphicPipelineDescription* description = &pipelineDescriptions[i];
+        results.push_back(threadPool->Submit([pipeline, description]() { pipeline->init(*description); }));
+    }
 
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_DIFFUSE] = new GraphicPipeline(vulkanDevice);
-        graphicPipelines[PROGRAM_ID::PROGRAM_ID_DIFFUSE]->init(renderPasses[RENDERPASS_INDEX::RENDERPASS_PRE]->getRenderpass(), layout, vulkanMSAASamples, vertexInputInfo, 3, descriptorManager->Getshadermodule(PROGRAM_ID::PROGRAM_ID_DIFFUSE),
-            Settings::windowWidth, Settings::windowHeight, true);
+    //every pipeline has to exist before the first command buffer is recorded, get() also rethrows compile failure
+    for (auto& result : results)
+    {
+        result.get();
     }
+}
+
+std::vector<int32_t> Graphic::GetLightingConstants() const
+{
+    if (!Settings::shaderVariants) return {};
+
+    //moment type only matters to the moment filter, other filters do not need a variant per type
+    int32_t momenttype = (guiSetting.shadow_filter == GUI_ENUM::SHADOW_FILTER_MOMENTS) ? guiSetting.moment_type : 0;
+
+    return { guiSetting.deferred_type, guiSetting.computation_type, guiSetting.shadow_filter, momenttype };
+}
+
+void Graphic::UpdateLightingVariant()
+{
+    //a variant still compiling could be installed after a newer one, wait until it is done
+    if (!pendingPipelines.empty()) return;
+
+    std::vector<int32_t> constants = GetLightingConstants();
+    if (constants == lightingConstants) return;
+
+    lightingConstants = constants;
+
+    for (PROGRAM_ID programid : LIGHTING_PROGRAMS)
+    {
+        //not used by the current draw behavior
+        if (pipelineDescriptions[programid].renderpass == VK_NULL_HANDLE) continue;
 
+        GraphicPipelineDescription description = pipelineDescriptions[programid];
+        description.specializationConstants = constants;
+        RequestPipeline(programid, description);
+    }
 }
 
 VkFormat Graphic::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -1025,32 +2488,175 @@ VkSampleCountFlagBits Graphic::getMaxUsableSampleCount()
     VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts &
         physicalDeviceProperties.limits.framebufferDepthSampleCounts;
 
-    if (counts & VK_SAMPLE_COUNT_64_BIT) return VK_SAMPLE_COUNT_64_BIT;
-    if (counts & VK_SAMPLE_COUNT_32_BIT) return VK_SAMPLE_COUNT_32_BIT;
-    if (counts & VK_SAMPLE_COUNT_16_BIT) return VK_SAMPLE_COUNT_16_BIT;
-    if (counts & VK_SAMPLE_COUNT_8_BIT) return VK_SAMPLE_COUNT_8_BIT;
-    if (counts & VK_SAMPLE_COUNT_4_BIT) return VK_SAMPLE_COUNT_4_BIT;
-    if (counts & VK_SAMPLE_COUNT_2_BIT) return VK_SAMPLE_COUNT_2_BIT;
+    //highest supported count that does not exceed the requested one, sample counts are single bits
+    for (uint32_t samples = std::min(Settings::msaaSamples, 64u); samples > 1; samples >>= 1)
+    {
+        if (counts & samples) return static_cast<VkSampleCountFlagBits>(samples);
+    }
 
     return VK_SAMPLE_COUNT_1_BIT;
 }
 
-void Graphic::RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid)
+void Graphic::RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid, const glm::mat4* objectmat)
 {
-    vkCmdBindPipeline(vulkanCommandBuffers[currentCommandIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicPipelines[programid]->GetPipeline());
+    //take the index even when the draw is skipped so the next object still gets its own uniform index
+    RegisterObject(descriptorsetid, programid, drawtargetid, descriptorSets[descriptorsetid]->NextIndex(), objectmat);
+}
 
-    descriptorSets[descriptorsetid]->BindDescriptorSetNoIndex(vulkanCommandBuffers[currentCommandIndex], descriptorManager->GetpipeLineLayout(programid));
+void Graphic::RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid, uint32_t objectindex, const glm::mat4* objectmat)
+{
+    GraphicPipeline* pipeline = GetDrawPipeline(programid);
+    if (pipeline == nullptr) return;
+
+    graphicsBinder->BindPipeline(programid, pipeline->GetPipeline());
+    graphicsBinder->SetDescriptorSet(descriptorSets[descriptorsetid]);
+    graphicsBinder->Flush();
+    const DrawTarget& target = drawtargets[drawtargetid];
+
+    DrawPushConstants constants;
+    constants.positionOffset = target.positionOffset;
+    constants.objectIndex = objectindex;
+    constants.positionScale = target.positionScale;
+    constants.lightIndex = drawLightIndex;
+    graphicsBinder->PushDrawConstants(constants);
+
+    DrawDrawtarget(vulkanCommandBuffers[currentCommandIndex], target, objectmat);
+}
 
-    DrawDrawtarget(vulkanCommandBuffers[currentCommandIndex], drawtargets[drawtargetid]);
+void Graphic::SetPassDescriptorSet(DESCRIPTORSET_INDEX descriptorsetid)
+{
+    graphicsBinder->SetDescriptorSet(descriptorSets[descriptorsetid]);
 }
 
-void Graphic::RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid, std::vector<uint32_t> indices)
+void Graphic::SetDrawLight(uint32_t lightindex)
 {
-    vkCmdBindPipeline(vulkanCommandBuffers[currentCommandIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicPipelines[programid]->GetPipeline());
+    drawLightIndex = lightindex;
+    drawLODView = LOD_VIEW_LIGHT + lightindex;
+}
 
-    descriptorSets[descriptorsetid]->BindDescriptorSet(vulkanCommandBuffers[currentCommandIndex], descriptorManager->GetpipeLineLayout(programid), indices);
+void Graphic::SetLODView(uint32_t view, glm::vec3 position, float projectionscale)
+{
+    lodSelector->SetView(view, position, projectionscale);
+}
 
-    DrawDrawtarget(vulkanCommandBuffers[currentCommandIndex], drawtargets[drawtargetid]);
+void Graphic::RequestPipeline(PROGRAM_ID programid, const GraphicPipelineDescription& description, std::optional<PROGRAM_ID> fallbackid)
+{
+    descriptorManager->ValidateVertexInput(programid, description.vertexAttributes);
+
+    fallbackPrograms[programid] = fallbackid;
+
+    GraphicPipeline* pipeline = new GraphicPipeline(vulkanDevice, pipelineCache->GetPipelineCache());
+
+    //the job keeps its own copy, caller may release the description right away
+    std::shared_ptr<GraphicPipelineDescription> jobdescription = std::make_shared<GraphicPipelineDescription>(description);
+    std::future<void> result = application->GetThreadPool()->Submit([pipeline, jobdescription]() { pipeline->init(*jobdescription); });
+
+    pendingPipelines.push_back({ programid, pipeline, std::move(result) });
+    pipelineDescriptions[programid] = description;
+}
+
+bool Graphic::IsPipelineReady(PROGRAM_ID programid) const
+{
+    return graphicPipelines[programid] != nullptr;
+}
+
+const GraphicPipelineDescription& Graphic::GetPipelineDescription(PROGRAM_ID programid) const
+{
+    return pipelineDescriptions[programid];
+}
+
+void Graphic::UpdatePendingPipelines()
+{
+    if (pendingPipelines.empty()) return;
+
+    std::vector<PendingPipeline> finished;
+    for (auto it = pendingPipelines.begin(); it != pendingPipelines.end();)
+    {
+        if (it->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            finished.push_back(std::move(*it));
+            it = pendingPipelines.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (finished.empty()) return;
+
+    //post command buffers of other frames may still reference the fallback or replaced pipeline
+    for (auto fence : imagesInFlight)
+    {
+        if (fence != VK_NULL_HANDLE) vkWaitForFences(vulkanDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    }
+
+    std::exception_ptr failure;
+    for (auto& pending : finished)
+    {
+        try
+        {
+            pending.result.get();
+        }
+        catch (...)
+        {
+            //the program keeps drawing with its fallback, the failed pipeline is not installed
+            pending.pipeline->close();
+            delete pending.pipeline;
+
+            if (!failure) failure = std::current_exception();
+            continue;
+        }
+
+        if (GraphicPipeline* old = graphicPipelines[pending.programid]; old != nullptr)
+        {
+            old->close();
+            delete old;
+        }
+        graphicPipelines[pending.programid] = pending.pipeline;
+    }
+
+    RecordCommandBuffers();
+
+    //rethrow compile failure on main thread once the other pipelines are installed
+    if (failure) std::rethrow_exception(failure);
+}
+
+void Graphic::WaitPendingPipelines()
+{
+    for (auto& pending : pendingPipelines)
+    {
+        //pipelines are discarded anyway, a failed compile only has to be waited for
+        try
+        {
+            pending.result.get();
+        }
+        catch (...)
+        {
+        }
+
+        pending.pipeline->close();
+        delete pending.pipeline;
+    }
+    pendingPipelines.clear();
+}
+
+GraphicPipeline* Graphic::GetDrawPipeline(PROGRAM_ID programid) const
+{
+    if (graphicPipelines[programid] != nullptr) return graphicPipelines[programid];
+
+    if (fallbackPrograms[programid].has_value()) return graphicPipelines[fallbackPrograms[programid].value()];
+
+    return nullptr;
+}
+
+void Graphic::RecordCommandBuffers()
+{
+    RecordPostProcess();
+
+    ResetDescriptorIndices();
+
+    LevelManager::GetCurrentLevel()->postinit();
 }
 
 void Graphic::AddDrawInfo(DrawInfo drawinfo, UniformBufferIndex uniformid)
@@ -1062,6 +2668,9 @@ void Graphic::BeginCmdBuffer(CMD_INDEX cmdindex)
 {
     currentCommandIndex = cmdindex;
 
+    //only recorded again once the gpu is done with it
+    lodSelector->Reset(cmdindex);
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0;
@@ -1071,10 +2680,27 @@ void Graphic::BeginCmdBuffer(CMD_INDEX cmdindex)
     {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
+
+    BeginDescriptorBinding(vulkanCommandBuffers[cmdindex]);
+
+    gpuProfiler->BeginRecord(cmdindex, vulkanCommandBuffers[cmdindex]);
+}
+
+void Graphic::BeginDescriptorBinding(VkCommandBuffer cmdBuffer)
+{
+    graphicsBinder->Begin(cmdBuffer);
+    computeBinder->Begin(cmdBuffer);
+    drawLightIndex = 0;
+    drawLODView = LOD_VIEW_CAMERA;
+
+    graphicsBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_GLOBAL]);
+    computeBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_GLOBAL]);
 }
 
 void Graphic::BeginRenderPass(CMD_INDEX cmdindex, RENDERPASS_INDEX renderpassindex, uint32_t framebufferindex)
 {
+    gpuProfiler->BeginScope(cmdindex, vulkanCommandBuffers[cmdindex], RENDERPASS_NAMES[renderpassindex], profilePipelineStatistics[renderpassindex]);
+
     renderPasses[renderpassindex]->beginRenderpass(vulkanCommandBuffers[cmdindex], framebufferindex);
 }
 
@@ -1089,6 +2715,52 @@ void Graphic::EndCmdBuffer(CMD_INDEX cmdindex)
 void Graphic::EndRenderPass(CMD_INDEX cmdindex)
 {
     vkCmdEndRenderPass(vulkanCommandBuffers[cmdindex]);
+
+    gpuProfiler->EndScope(cmdindex, vulkanCommandBuffers[cmdindex]);
+}
+
+GPUProfiler* Graphic::GetProfiler() const
+{
+    return gpuProfiler;
+}
+
+void Graphic::RecordDeferredLighting(CMD_INDEX cmdindex)
+{
+    VkCommandBuffer cmdBuffer = vulkanCommandBuffers[cmdindex];
+
+    renderPasses[RENDERPASS_INDEX::RENDERPASS_MERGED]->nextSubpass(cmdBuffer);
+
+    if (GraphicPipeline* pipeline = GetDrawPipeline(PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS); pipeline != nullptr)
+    {
+        graphicsBinder->SetDescriptorSet(descriptorSets[DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_DEFERRED_SUBPASS]);
+        graphicsBinder->BindPipeline(PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS, pipeline->GetPipeline());
+        graphicsBinder->Flush();
+
+        DrawDrawtarget(cmdBuffer, drawtargets[DRAWTARGET_INDEX::DRAWTARGET_RECTANGLE]);
+    }
+}
+
+void Graphic::ResetDescriptorIndices()
+{
+    for (auto descriptorset : descriptorSets)
+    {
+        if (descriptorset != nullptr) descriptorset->ResetIndex();
+    }
+}
+
+uint32_t Graphic::GetSwapchainImageCount() const
+{
+    return swapchainImageSize;
+}
+
+void Graphic::BeginProfileScope(CMD_INDEX cmdindex, const std::string& name)
+{
+    gpuProfiler->BeginScope(cmdindex, vulkanCommandBuffers[cmdindex], name);
+}
+
+void Graphic::EndProfileScope(CMD_INDEX cmdindex)
+{
+    gpuProfiler->EndScope(cmdindex, vulkanCommandBuffers[cmdindex]);
 }
 
 void DrawTarget::AddVertex(VertexInfo info)
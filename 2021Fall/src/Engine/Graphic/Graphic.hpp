@@ -5,10 +5,12 @@
 #include <optional>
 #include <vector>
 #include <unordered_map>
+#include <future>
 
 //3rd party librarys
 #include <tinyobjloader/tiny_obj_loader.h>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 
 #include "Engine/Common/System.hpp"
 #include "GraphicPipeline.hpp"
@@ -19,18 +21,43 @@
 //defined in common.glsl
 #define MAX_LIGHT 8
 
+//views a detail level is picked for, the camera and the shadow cube of every light
+constexpr uint32_t LOD_VIEW_CAMERA = 0;
+constexpr uint32_t LOD_VIEW_LIGHT = 1;
+constexpr uint32_t LOD_VIEW_MAX = LOD_VIEW_LIGHT + MAX_LIGHT;
+
+//storage buffer element of one object, ObjectUniform has to fit, ObjectData in object.glsl is padded to it
+constexpr uint32_t OBJECT_UNIFORM_STRIDE = 256;
+
+//storage format of the shadow moment passes (rgba16f in the compute shaders), filterable and storable on every device
+constexpr VkFormat SHADOW_MOMENT_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+//color attachment index is the output location, layout is described in gbuffer.glsl
 enum FrameBufferIndex
 {
+	VIEWDEPTHATTACHMENT,
 	NORMALATTACHMENT,
-	POSITIONATTACHMENT,
 	ALBEDOATTACHMENT,
 	COLORATTACHMENT_MAX,
+	VIEWDEPTHATTACHMENT_MSAA = VIEWDEPTHATTACHMENT + COLORATTACHMENT_MAX,
 	NORMALATTACHMENT_MSAA = NORMALATTACHMENT + COLORATTACHMENT_MAX,
-	POSITIONATTACHMENT_MSAA = POSITIONATTACHMENT + COLORATTACHMENT_MAX,
 	ALBEDOATTACHMENT_MSAA = ALBEDOATTACHMENT + COLORATTACHMENT_MAX,
 
 	DEPTHATTACHMENT = COLORATTACHMENT_MAX * 2,
-	FRAMEBUFFER_MAX = DEPTHATTACHMENT + 1,
+	//output location 3, screen space motion for Settings::temporalAA only
+	VELOCITYATTACHMENT = DEPTHATTACHMENT + 1,
+	FRAMEBUFFER_MAX = VELOCITYATTACHMENT + 1,
+};
+
+enum TAAImageIndex
+{
+	//lighting output, jittered and aliased
+	TAA_SCENECOLOR,
+	//accumulated result of the previous frames, sampled by the resolve
+	TAA_HISTORY,
+	//written by the resolve and copied to TAA_HISTORY afterwards
+	TAA_HISTORY_OUTPUT,
+	TAA_IMAGE_MAX,
 };
 
 enum DRAWTARGET_INDEX
@@ -46,19 +73,50 @@ enum RENDERPASS_INDEX
 	RENDERPASS_POST = 0,
 	RENDERPASS_PRE = 1,
 	RENDERPASS_DEPTHCUBEMAP = 2,
-	RENDERPASS_MAX = RENDERPASS_DEPTHCUBEMAP + 1,
+	//gbuffer subpass + lighting subpass, replaces PRE and POST with Settings::mergedDeferred
+	RENDERPASS_MERGED = 3,
+	//history resolve into the swapchain with Settings::temporalAA, POST then renders into the scene color
+	RENDERPASS_TAA = 4,
+	RENDERPASS_MAX = RENDERPASS_TAA + 1,
 };
 
 enum DESCRIPTORSET_INDEX
 {
-	//will be same
+	//material sets, the object uniforms of objects and light cubes
 	DESCRIPTORSET_ID_OBJ = 0,
 	DESCRIPTORSET_ID_LIGHT_OBJ = 1,
+	//pass sets
 	DESCRIPTORSET_ID_DEFERRED = 2,
 	DESCRIPTORSET_ID_SHADOWMAP = 3,
-	DESCRIPTORSET_ID_MAX = 4,
+	DESCRIPTORSET_ID_DEFERRED_SUBPASS = 4,
+	DESCRIPTORSET_ID_TAA = 5,
+	//compute passes of Settings::shadowMoments
+	DESCRIPTORSET_ID_SHADOWMOMENT_WARP = 6,
+	DESCRIPTORSET_ID_SHADOWMOMENT_BLUR = 7,
+	//camera, settings and lights, bound once per command buffer
+	DESCRIPTORSET_ID_GLOBAL = 8,
+	DESCRIPTORSET_ID_MAX = 9,
 };
 
+struct DescriptorSetLayoutID
+{
+	PROGRAM_ID program;
+	DESCRIPTOR_SET_TIER tier;
+};
+
+//program and tier whose layout each descriptor set is allocated with, the first descriptor pool holds exactly these sets
+constexpr std::array<DescriptorSetLayoutID, DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_MAX> DESCRIPTORSET_LAYOUTS = { {
+	{ PROGRAM_ID::PROGRAM_ID_BASERENDER, DESCRIPTOR_SET_TIER_MATERIAL },
+	{ PROGRAM_ID::PROGRAM_ID_BASERENDER, DESCRIPTOR_SET_TIER_MATERIAL },
+	{ PROGRAM_ID::PROGRAM_ID_DEFERRED, DESCRIPTOR_SET_TIER_PASS },
+	{ PROGRAM_ID::PROGRAM_ID_SHADOWMAP, DESCRIPTOR_SET_TIER_PASS },
+	{ PROGRAM_ID::PROGRAM_ID_DEFERRED_SUBPASS, DESCRIPTOR_SET_TIER_PASS },
+	{ PROGRAM_ID::PROGRAM_ID_TAA, DESCRIPTOR_SET_TIER_PASS },
+	{ PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_WARP, DESCRIPTOR_SET_TIER_PASS },
+	{ PROGRAM_ID::PROGRAM_ID_SHADOWMOMENT_BLUR, DESCRIPTOR_SET_TIER_PASS },
+	{ PROGRAM_ID::PROGRAM_ID_DEFERRED, DESCRIPTOR_SET_TIER_GLOBAL },
+} };
+
 enum CMD_INDEX
 {
 	CMD_BASE = 0,
@@ -74,6 +132,11 @@ class Camera;
 class Light;
 class Object;
 class DescriptorManager;
+class DescriptorBinder;
+class PipelineCache;
+class GPUProfiler;
+class ComputePipeline;
+class LODSelector;
 
 struct GUISetting
 {
@@ -83,14 +146,43 @@ struct GUISetting
 	float shadowbias = 0.5f;
 	float shadowfar_plane = 100.0f;
 	float shadowdiskRadius = 50.0f;
+	GUI_ENUM::SHADOW_FILTER_TYPE shadow_filter = GUI_ENUM::SHADOW_FILTER_COMPARE;
+	//poisson taps of SHADOW_FILTER_COMPARE
+	int shadowtaps = 12;
+	//SHADOW_FILTER_MOMENTS only, the moments are rebuilt every frame so all of these apply immediately
+	GUI_ENUM::SHADOW_MOMENT_TYPE moment_type = GUI_ENUM::SHADOW_MOMENT_EVSM;
+	//texels on each side of the separable blur, 0 ~ 8
+	int momentBlurRadius = 2;
+	//upper bound below this counts as full shadow, hides the light bleeding between overlapping occluders
+	float momentBleedReduction = 0.2f;
+	float momentMinVariance = 0.0001f;
+	//rgba16f moments overflow above 5.54
+	float evsmPositiveExponent = 5.0f;
+	float evsmNegativeExponent = 5.0f;
+
+	//weight of the history in the temporal resolve, 0 for the frame after the history became invalid
+	float taaFeedback = 0.9f;
 };
 
 struct VertexInfo
 {
+	//position stream of packed meshes
 	uint32_t vertex;
 	uint32_t index;
 
 	uint32_t indexSize;
+	//PackedNormal stream, packed meshes only
+	std::optional<uint32_t> attribute;
+	//uint16 for meshes with fewer than 65536 vertices
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+};
+
+//index range of one detail level, error is how far the surface is off the full mesh in object space
+struct DrawLOD
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;
 };
 
 struct DrawTarget
@@ -100,9 +192,28 @@ struct DrawTarget
 	std::optional<uint32_t> instancebuffer;
 	std::optional<uint32_t> instancenumber;
 
+	//finest first, ranges in the index buffer of the only vertexIndices entry, empty -> always the whole buffer
+	std::vector<DrawLOD> lods;
+	//object space bounding sphere
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+	//cpu copy of instancebuffer, the instances are sorted into the detail levels every frame
+	std::vector<glm::vec3> instanceOffsets;
+	//bounds the PackedPosition stream is relative to, pushed with every draw
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+	glm::vec3 positionScale = glm::vec3(1.0f);
+
 	void AddVertex(VertexInfo info);
 };
 
+//pipeline compiled on the thread pool after RequestPipeline, installed once finished
+struct PendingPipeline
+{
+	PROGRAM_ID programid;
+	GraphicPipeline* pipeline;
+	std::future<void> result;
+};
+
 struct DrawInfo
 {
 	void* uniformdata;
@@ -124,16 +235,53 @@ public:
 	void drawGUI() override;
 
 public:
-	void RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid);
-	void RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid, std::vector<uint32_t> indices);
+	//descriptorsetid is the material set, the object takes its next index in it
+	//the index is pushed with the draw, so objects sharing a set never rebind it
+	//with objectmat a target with lods picks its level every frame, objectmat has to outlive the command buffer
+	void RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid, const glm::mat4* objectmat = nullptr);
+	//same with an explicit object index, e.g. every light of the shadow pass draws the objects again
+	void RegisterObject(DESCRIPTORSET_INDEX descriptorsetid, PROGRAM_ID programid, DRAWTARGET_INDEX drawtargetid, uint32_t objectindex, const glm::mat4* objectmat = nullptr);
+	//pass set of the following draws
+	void SetPassDescriptorSet(DESCRIPTORSET_INDEX descriptorsetid);
+	//light pushed with the following draws, the one a shadow pass renders, its view picks their detail levels
+	void SetDrawLight(uint32_t lightindex);
+	//position and pixels per unit at distance 1 of view, updated every frame
+	void SetLODView(uint32_t view, glm::vec3 position, float projectionscale);
 
 	void AddDrawInfo(DrawInfo drawinfo, UniformBufferIndex uniformid);
 
+	//returns immediately, compilation runs on the thread pool
+	//until it is finished draws with programid use fallbackid (must share the pipeline layout) or are skipped
+	//runtime requested pipelines are released on full swapchain rebuild and have to be requested again
+	void RequestPipeline(PROGRAM_ID programid, const GraphicPipelineDescription& description, std::optional<PROGRAM_ID> fallbackid = std::nullopt);
+	bool IsPipelineReady(PROGRAM_ID programid) const;
+	const GraphicPipelineDescription& GetPipelineDescription(PROGRAM_ID programid) const;
+
 	void BeginCmdBuffer(CMD_INDEX cmdindex);
 	void BeginRenderPass(CMD_INDEX cmdindex, RENDERPASS_INDEX renderpassindex, uint32_t framebufferindex = 0);
 	void EndCmdBuffer(CMD_INDEX cmdindex);
 	void EndRenderPass(CMD_INDEX cmdindex);
 
+	//named gpu timing scope, BeginRenderPass/EndRenderPass are measured automatically
+	void BeginProfileScope(CMD_INDEX cmdindex, const std::string& name);
+	void EndProfileScope(CMD_INDEX cmdindex);
+	GPUProfiler* GetProfiler() const;
+
+	//merged renderpass only, moves to the lighting subpass and draws the fullscreen lighting
+	void RecordDeferredLighting(CMD_INDEX cmdindex);
+	//objects take the next object index on every bind, start over before recording them again
+	void ResetDescriptorIndices();
+	uint32_t GetSwapchainImageCount() const;
+
+	//msaa <-> taa, the gbuffer sample count changes so every renderpass and pipeline is rebuilt before the next frame
+	void SetTemporalAA(bool enable);
+	//shadow pass targets change, rebuilt before the next frame like SetTemporalAA
+	void SetShadowMoments(bool enable);
+
+	//Settings::shadowMoments only, after the depth cubes of every light are rendered
+	//warps and blurs them into the moment cubes and rebuilds their mips
+	void RecordShadowMoments(CMD_INDEX cmdindex);
+
 private:
 	std::vector<VkCommandBuffer> vulkanCommandBuffers;
 	std::vector<VkSemaphore> vulkanImageAvailableSemaphores;
@@ -146,48 +294,139 @@ private:
 	VkExtent2D vulkanSwapChainExtent;
 
 	VkSampler vulkanTextureSampler;
+	VkSampler vulkanGBufferSampler;
+	VkSampler vulkanHistorySampler;
+	//depth compare against the shadow cubemaps
+	VkSampler vulkanShadowSampler;
+	//trilinear over the moment cubemaps
+	VkSampler vulkanShadowMomentSampler;
 	VkFormat vulkanSwapChainImageFormat;
 	VkFormat vulkanDepthFormat;
+	VkFormat vulkanShadowFormat;
 
 private:
 	VkSampleCountFlagBits vulkanMSAASamples = VK_SAMPLE_COUNT_1_BIT;
+	//Settings::msaaEdgeLighting when there are samples to classify
+	bool edgeLighting = false;
+	//next frame has no usable history, e.g. after a resize
+	bool taaHistoryReset = true;
+	bool drawBehaviorRebuild = false;
+	//what the lighting pipelines are compiled or being compiled with
+	std::vector<int32_t> lightingConstants;
 
 	size_t currentFrame = 0;
 
 	uint32_t textureMipLevels;
 
-	std::array<GraphicPipeline*, PROGRAM_ID::PROGRAM_ID_MAX> graphicPipelines;
-	std::array<DescriptorSet*, DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_MAX> descriptorSets;
+	std::array<GraphicPipeline*, PROGRAM_ID::PROGRAM_ID_MAX> graphicPipelines{};
+	std::array<ComputePipeline*, PROGRAM_ID::PROGRAM_ID_MAX> computePipelines{};
+	std::array<GraphicPipelineDescription, PROGRAM_ID::PROGRAM_ID_MAX> pipelineDescriptions;
 
-	std::array<Renderpass*, RENDERPASS_INDEX::RENDERPASS_MAX> renderPasses;
+	std::array<std::optional<PROGRAM_ID>, PROGRAM_ID::PROGRAM_ID_MAX> fallbackPrograms;
+	std::vector<PendingPipeline> pendingPipelines;
+	std::array<DescriptorSet*, DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_MAX> descriptorSets{};
+
+	std::array<Renderpass*, RENDERPASS_INDEX::RENDERPASS_MAX> renderPasses{};
 
 	std::vector<DrawTarget> drawtargets;
 
 	std::vector<Image*> swapchainImages;
 	std::vector<Image*> framebufferImages;
+	//marks msaa edge pixels in the post pass, only with Settings::msaaEdgeLighting
+	Image* edgeStencilImage = nullptr;
+	//only with Settings::temporalAA
+	std::vector<Image*> taaImages;
 	std::vector<Image*> images;
+	//only with Settings::shadowMoments, per light depth cube at Settings::shadowMomentSize and its filtered moments
+	std::vector<Image*> shadowMomentDepths;
+	std::vector<Image*> shadowMomentImages;
+	//horizontal pass result of every face of every light
+	Image* shadowMomentBlurImage = nullptr;
 	uint32_t swapchainImageSize;
 
 	GUISetting guiSetting;
 	DescriptorManager* descriptorManager = nullptr;
+	//state of the command buffer being recorded, reset with every BeginCmdBuffer
+	DescriptorBinder* graphicsBinder = nullptr;
+	DescriptorBinder* computeBinder = nullptr;
+	//DrawPushConstants::lightIndex of the command buffer being recorded
+	uint32_t drawLightIndex = 0;
+	//view the detail levels of the following draws are picked for
+	uint32_t drawLODView = LOD_VIEW_CAMERA;
+	LODSelector* lodSelector = nullptr;
+	//triangles of every object drawn with lods in the last frame, over all views
+	uint64_t lodTriangleCount = 0;
+	PipelineCache* pipelineCache = nullptr;
+	GPUProfiler* gpuProfiler = nullptr;
+
+	//renderpasses that also collect pipeline statistics, changing it re-records the command buffers
+	std::array<bool, RENDERPASS_INDEX::RENDERPASS_MAX> profilePipelineStatistics{};
+	bool profilerRecordUpdate = false;
 
 	std::unordered_map<UniformBufferIndex, std::vector<DrawInfo>> drawinfos;
 
 	CMD_INDEX currentCommandIndex;
 
+	//next image of the offscreen ring in headless mode
+	uint32_t offscreenIndex = 0;
+
 private:
 	void AllocateCommandBuffer();
 
-	void SetupSwapChain();
+	void SetupSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+	//size dependent images used by the renderpasses, everything except the swapchain
+	void CreateFrameBufferImages();
+	void CloseFrameBufferImages();
+	//sample count and lighting path for the current antialiasing mode
+	void SelectSampleCount();
 	void DefineDrawBehavior();
 
 	void DefineShadowMap();
+	void CreateShadowMomentImages();
+	void CloseShadowMomentImages();
+	//depth cube the shadow pass renders for light, what the pcf filters read
+	Image* GetShadowDepthImage(uint32_t light) const;
 	void DefinePostProcess();
+	void DefineMergedDeferred();
+	void DefineTemporalAA();
+	void RecordPostProcess();
+	void RecordTemporalAA(VkCommandBuffer cmdBuffer, uint32_t slot, uint32_t imageindex);
+	//nothing is bound on a new command buffer, every program finds the global set
+	void BeginDescriptorBinding(VkCommandBuffer cmdBuffer);
+
+	//gbuffer renderpass attachments in attachment order : outputs, resolves when lighting reads them, depth
+	std::vector<FrameBufferIndex> GetGBufferAttachments() const;
+	uint32_t GetGBufferOutputCount() const;
+	//msaa gbuffer is resolved only when the lighting reads the resolve
+	bool ResolvesGBuffer() const;
+	//image the lighting reads for gbuffer output location
+	FrameBufferIndex GetLightingInput(uint32_t location) const;
+
+	//compile every described pipeline on the thread pool and wait for all of them
+	void CompilePipelines();
+
+	//specialization of the lighting pipelines for the current gui setting, constant_id order of lightingvariant.glsl
+	std::vector<int32_t> GetLightingConstants() const;
+	//requests the lighting pipelines again when the gui picked another variant, the old one draws until they are ready
+	void UpdateLightingVariant();
+
+	//install pipelines finished since last frame, re-record command buffers that used a fallback
+	void UpdatePendingPipelines();
+	void WaitPendingPipelines();
+	GraphicPipeline* GetDrawPipeline(PROGRAM_ID programid) const;
+	void RecordCommandBuffers();
 
 	void CloseSwapChain();
+	void CloseDrawBehavior();
 	void RecreateSwapChain();
+	//point renderpasses and descriptors at recreated size dependent images
+	void UpdateFrameBufferAttachments();
+
+	//headless capture of a finished offscreen image
+	void DumpFrame(uint32_t imageIndex, uint64_t frame);
 
-	void DrawDrawtarget(const VkCommandBuffer& cmdBuffer, const DrawTarget& target);
+	//objectmat selects a detail level of targets with lods, otherwise the whole index buffer is drawn
+	void DrawDrawtarget(const VkCommandBuffer& cmdBuffer, const DrawTarget& target, const glm::mat4* objectmat = nullptr);
 
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -2,44 +2,39 @@
 #include "Engine/Misc/helper.hpp"
 #include "VertexInfo.hpp"
 
-GraphicPipeline::GraphicPipeline(VkDevice device) : vulkanDevice(device) {}
+//standard library
+#include <array>
 
-void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelayout, VkSampleCountFlagBits msaaSamples, VkPipelineVertexInputStateCreateInfo inputstate, uint32_t colorNum, std::vector<VkPipelineShaderStageCreateInfo> shadermodules,
-	uint32_t width, uint32_t height, bool enableCull)
+GraphicPipeline::GraphicPipeline(VkDevice device, VkPipelineCache pipelinecache) : vulkanDevice(device), vulkanpipelinecache(pipelinecache) {}
+
+void GraphicPipeline::init(const GraphicPipelineDescription& description)
 {
-	if (vulkanpipelinecache == VK_NULL_HANDLE)
-	{
-		VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		if (vkCreatePipelineCache(vulkanDevice, &pipelineCacheCreateInfo, nullptr, &vulkanpipelinecache) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create pipeline cache!");
-		}
-	}
+	VkPipelineVertexInputStateCreateInfo inputstate{};
+	inputstate.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	inputstate.vertexBindingDescriptionCount = static_cast<uint32_t>(description.vertexBindings.size());
+	inputstate.pVertexBindingDescriptions = description.vertexBindings.data();
+	inputstate.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertexAttributes.size());
+	inputstate.pVertexAttributeDescriptions = description.vertexAttributes.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(width);
-	viewport.height = static_cast<float>(height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor{};
-	scissor.offset = { 0,0 };
-	scissor.extent = { width, height };
-	
+	//actual viewport/scissor is set when renderpass begins, so resizing does not touch the pipeline
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
+	viewportState.pViewports = nullptr;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+	viewportState.pScissors = nullptr;
+
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
 
 	VkPipelineRasterizationStateCreateInfo rasterizer{};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -47,7 +42,7 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 	rasterizer.rasterizerDiscardEnable = VK_FALSE;
 	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = (enableCull) ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_NONE;
+	rasterizer.cullMode = (description.enableCull) ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_NONE;
 	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 	rasterizer.depthBiasEnable = VK_FALSE;
 	rasterizer.depthBiasConstantFactor = 0.0f;
@@ -59,27 +54,25 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 	multisampling.sampleShadingEnable = VK_TRUE;
 	//close to one is smoother
 	multisampling.minSampleShading = 0.2f;
-	multisampling.rasterizationSamples = msaaSamples;
+	multisampling.rasterizationSamples = description.msaaSamples;
 	multisampling.pSampleMask = nullptr;
 	multisampling.alphaToCoverageEnable = VK_FALSE;
 	multisampling.alphaToOneEnable = VK_FALSE;
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthTestEnable = description.enableDepthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = description.enableDepthTest ? VK_TRUE : VK_FALSE;
 	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
 	depthStencil.depthBoundsTestEnable = VK_FALSE;
 	depthStencil.minDepthBounds = 0.0f;
 	depthStencil.maxDepthBounds = 1.0f;
-	depthStencil.stencilTestEnable = VK_FALSE;
-	depthStencil.front = {};
-	depthStencil.back = {};
+	depthStencil.stencilTestEnable = description.stencil.has_value() ? VK_TRUE : VK_FALSE;
+	depthStencil.front = description.stencil.value_or(VkStencilOpState{});
+	depthStencil.back = depthStencil.front;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
-		VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
-		VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.colorWriteMask = description.colorWriteMask;
 	colorBlendAttachment.blendEnable = VK_FALSE;
 	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
 	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
@@ -89,7 +82,7 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
 	std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
-	for (uint32_t i = 0; i < colorNum; ++i)
+	for (uint32_t i = 0; i < description.colorNum; ++i)
 	{
 		colorBlendAttachments.push_back(colorBlendAttachment);
 	}
@@ -105,6 +98,24 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+	for (uint32_t i = 0; i < description.specializationConstants.size(); ++i)
+	{
+		specializationEntries.push_back({ i, static_cast<uint32_t>(i * sizeof(int32_t)), sizeof(int32_t) });
+	}
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = description.specializationConstants.size() * sizeof(int32_t);
+	specializationInfo.pData = description.specializationConstants.data();
+
+	std::vector<VkPipelineShaderStageCreateInfo> stages = description.shaderStages;
+	for (auto& stage : stages)
+	{
+		if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT && !specializationEntries.empty()) stage.pSpecializationInfo = &specializationInfo;
+	}
+
 	/*for (auto shader : shadermodules)
 	{
 		VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
@@ -118,8 +129,8 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = static_cast<uint32_t>(shadermodules.size());
-	pipelineInfo.pStages = shadermodules.data();
+	pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+	pipelineInfo.pStages = stages.data();
 	pipelineInfo.pVertexInputState = &inputstate;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
 	pipelineInfo.pViewportState = &viewportState;
@@ -127,12 +138,12 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = nullptr;
+	pipelineInfo.pDynamicState = &dynamicState;
 
-	pipelineInfo.layout = pipelinelayout;
+	pipelineInfo.layout = description.pipelinelayout;
 
-	pipelineInfo.renderPass = renderpass;
-	pipelineInfo.subpass = 0;
+	pipelineInfo.renderPass = description.renderpass;
+	pipelineInfo.subpass = description.subpass;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
 	if (vkCreateGraphicsPipelines(vulkanDevice, vulkanpipelinecache, 1, &pipelineInfo, nullptr,
@@ -145,7 +156,6 @@ void GraphicPipeline::init(VkRenderPass renderpass, VkPipelineLayout pipelinelay
 void GraphicPipeline::close()
 {
 	vkDestroyPipeline(vulkanDevice, vulkanPipeline, nullptr);
-	vkDestroyPipelineCache(vulkanDevice, vulkanpipelinecache, nullptr);
 }
 
 VkPipeline GraphicPipeline::GetPipeline() const
@@ -5,22 +5,48 @@
 
 //standard library
 #include <vector>
+#include <optional>
+
+//everything needed to build a pipeline, owns its arrays so it can be handed to a worker thread
+struct GraphicPipelineDescription
+{
+	VkRenderPass renderpass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+	VkPipelineLayout pipelinelayout = VK_NULL_HANDLE;
+	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+	uint32_t colorNum = 1;
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	//constant_id i of the fragment stage, empty keeps the defaults of the shader
+	std::vector<int32_t> specializationConstants;
+
+	bool enableCull = false;
+	bool enableDepthTest = true;
+	//same state for front and back faces, the renderpass needs a stencil attachment
+	std::optional<VkStencilOpState> stencil;
+	//0 for passes that only write stencil
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+};
 
 class GraphicPipeline
 {
 public:
-	GraphicPipeline(VkDevice device);
+	GraphicPipeline(VkDevice device, VkPipelineCache pipelinecache);
 
-	void init(VkRenderPass renderpass, VkPipelineLayout pipelinelayout, VkSampleCountFlagBits msaaSamples, VkPipelineVertexInputStateCreateInfo inputstate, uint32_t colorNum, std::vector<VkPipelineShaderStageCreateInfo> shadermodules,
-		uint32_t width, uint32_t height, bool enableCull);
+	//safe to call from several threads at once, the pipeline cache is internally synchronized
+	void init(const GraphicPipelineDescription& description);
 	void close();
 
 	VkPipeline GetPipeline() const;
 private:
 	VkDevice vulkanDevice;
 
-	VkPipeline vulkanPipeline;
+	VkPipeline vulkanPipeline = VK_NULL_HANDLE;
 
+	//owned by PipelineCache, shared between every pipeline
 	VkPipelineCache vulkanpipelinecache = VK_NULL_HANDLE;
 
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
@@ -0,0 +1,172 @@
+#include "LODSelector.hpp"
+#include "Graphic.hpp"
+#include "Engine/Memory/Buffer.hpp"
+#include "Engine/Misc/settings.hpp"
+
+//standard library
+#include <algorithm>
+
+//smallest buffer an arena allocates, a few hundred draws or a large instance crowd
+constexpr VkDeviceSize LOD_CHUNK_SIZE = 64 * 1024;
+//indirect arguments need 4 byte alignment, 16 keeps the instance offsets aligned as well
+constexpr VkDeviceSize LOD_REGION_ALIGNMENT = 16;
+//a view inside the bounding sphere measures from this distance instead
+constexpr float LOD_MIN_DISTANCE = 0.01f;
+
+LODSelector::LODSelector(uint32_t viewcount) : views(viewcount) {}
+
+void LODSelector::SetView(uint32_t view, glm::vec3 position, float projectionscale)
+{
+	views[view].position = position;
+	views[view].projectionScale = projectionscale;
+}
+
+void LODSelector::RecordDraw(VkCommandBuffer cmdBuffer, uint32_t cmdindex, const DrawTarget& target, uint32_t view, const glm::mat4* objectmat)
+{
+	if (cmdindex >= arenas.size()) arenas.resize(cmdindex + 1);
+	Arena& arena = arenas[cmdindex];
+
+	uint32_t levelcount = static_cast<uint32_t>(target.lods.size());
+	bool instanced = target.instancebuffer.has_value();
+	uint32_t instancenumber = target.instancenumber.value_or(1);
+
+	Draw draw{ &target, view, objectmat, {}, {} };
+	draw.commands = allocate(arena, (instanced ? levelcount : 1) * sizeof(VkDrawIndexedIndirectCommand));
+	if (instanced) draw.instances = allocate(arena, static_cast<VkDeviceSize>(levelcount) * instancenumber * sizeof(glm::vec3));
+
+	VkBuffer commandbuffer = VulkanMemoryManager::GetBuffer(arena.chunks[draw.commands.chunk].buffer)->GetBuffer();
+
+	if (!instanced)
+	{
+		vkCmdDrawIndexedIndirect(cmdBuffer, commandbuffer, draw.commands.offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		//instances of a level are packed from the start of its range, firstInstance stays 0
+		VkBuffer instancebuffer = VulkanMemoryManager::GetBuffer(arena.chunks[draw.instances.chunk].buffer)->GetBuffer();
+		for (uint32_t level = 0; level < levelcount; ++level)
+		{
+			VkDeviceSize instanceoffset = draw.instances.offset + static_cast<VkDeviceSize>(level) * instancenumber * sizeof(glm::vec3);
+			vkCmdBindVertexBuffers(cmdBuffer, 1, 1, &instancebuffer, &instanceoffset);
+
+			VkDeviceSize commandoffset = draw.commands.offset + level * sizeof(VkDrawIndexedIndirectCommand);
+			vkCmdDrawIndexedIndirect(cmdBuffer, commandbuffer, commandoffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+	arena.draws.push_back(draw);
+}
+
+void LODSelector::Reset(uint32_t cmdindex)
+{
+	if (cmdindex >= arenas.size()) return;
+
+	Arena& arena = arenas[cmdindex];
+	for (auto& chunk : arena.chunks)
+	{
+		chunk.used = 0;
+	}
+	arena.current = 0;
+	arena.draws.clear();
+}
+
+uint64_t LODSelector::Update(uint32_t cmdindex)
+{
+	if (cmdindex >= arenas.size()) return 0;
+
+	Arena& arena = arenas[cmdindex];
+	uint64_t triangles = 0;
+
+	for (const Draw& draw : arena.draws)
+	{
+		const DrawTarget& target = *draw.target;
+		const View& view = views[draw.view];
+		const glm::mat4& objectmat = *draw.objectMat;
+
+		uint32_t levelcount = static_cast<uint32_t>(target.lods.size());
+
+		//largest axis scale, the error and the bounds grow with it
+		float scale = std::max({ glm::length(glm::vec3(objectmat[0])), glm::length(glm::vec3(objectmat[1])), glm::length(glm::vec3(objectmat[2])) });
+		glm::vec3 center = glm::vec3(objectmat * glm::vec4(target.boundsCenter, 1.0f));
+		float radius = target.boundsRadius * scale;
+
+		//coarsest level whose error projects to at most Settings::lodPixelError at the nearest point of the bounds
+		auto select = [&](glm::vec3 position) -> uint32_t
+		{
+			float distance = std::max(glm::length(position - view.position) - radius, LOD_MIN_DISTANCE);
+			float pixels = scale * view.projectionScale / distance;
+
+			uint32_t level = 0;
+			while (level + 1 < levelcount && target.lods[level + 1].error * pixels <= Settings::lodPixelError) ++level;
+
+			return level;
+		};
+
+		VkDrawIndexedIndirectCommand* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(arena.chunks[draw.commands.chunk].data.data() + draw.commands.offset);
+
+		if (!target.instancebuffer.has_value())
+		{
+			const DrawLOD& lod = target.lods[select(center)];
+			commands[0] = { lod.indexCount, 1, lod.firstIndex, 0, 0 };
+			triangles += lod.indexCount / 3;
+
+			continue;
+		}
+
+		//offsets are added after the object matrix, in world space
+		uint32_t instancenumber = target.instancenumber.value_or(1);
+		uint32_t instancecount = std::min(instancenumber, static_cast<uint32_t>(target.instanceOffsets.size()));
+		glm::vec3* instances = reinterpret_cast<glm::vec3*>(arena.chunks[draw.instances.chunk].data.data() + draw.instances.offset);
+
+		levelCounts.assign(levelcount, 0);
+		for (uint32_t i = 0; i < instancecount; ++i)
+		{
+			uint32_t level = select(center + target.instanceOffsets[i]);
+			instances[level * instancenumber + levelCounts[level]++] = target.instanceOffsets[i];
+		}
+
+		for (uint32_t level = 0; level < levelcount; ++level)
+		{
+			const DrawLOD& lod = target.lods[level];
+			commands[level] = { lod.indexCount, levelCounts[level], lod.firstIndex, 0, 0 };
+			triangles += static_cast<uint64_t>(lod.indexCount / 3) * levelCounts[level];
+		}
+	}
+
+	for (const auto& chunk : arena.chunks)
+	{
+		if (chunk.used == 0) continue;
+
+		VulkanMemoryManager::MapBufferMemory(chunk.buffer, chunk.data.data(), static_cast<size_t>(chunk.used));
+	}
+
+	return triangles;
+}
+
+LODSelector::Region LODSelector::allocate(Arena& arena, VkDeviceSize size)
+{
+	while (true)
+	{
+		if (arena.current == arena.chunks.size())
+		{
+			Chunk chunk;
+			chunk.size = std::max(size, LOD_CHUNK_SIZE);
+			chunk.buffer = VulkanMemoryManager::CreateIndirectBuffer(static_cast<size_t>(chunk.size));
+			chunk.data.resize(static_cast<size_t>(chunk.size));
+
+			arena.chunks.push_back(std::move(chunk));
+		}
+
+		Chunk& chunk = arena.chunks[arena.current];
+		VkDeviceSize offset = (chunk.used + LOD_REGION_ALIGNMENT - 1) / LOD_REGION_ALIGNMENT * LOD_REGION_ALIGNMENT;
+
+		if (offset + size <= chunk.size)
+		{
+			chunk.used = offset + size;
+
+			return { arena.current, offset };
+		}
+
+		++arena.current;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+//3rd party library
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+//standard library
+#include <vector>
+#include <cstdint>
+
+struct DrawTarget;
+
+//picks a detail level of every draw of a target with lods, per view and per instance
+//command buffers are recorded once, so the draws are indirect and only their arguments are rewritten every frame
+class LODSelector
+{
+public:
+	LODSelector(uint32_t viewcount);
+
+	//projectionscale is the pixels an object space unit covers at distance 1, viewport height / (2 tan(fovy / 2))
+	void SetView(uint32_t view, glm::vec3 position, float projectionscale);
+
+	//target's vertex and index buffers have to be bound, instanced targets get their instances bound per level
+	//objectmat is read on every Update, it has to live as long as the command buffer
+	void RecordDraw(VkCommandBuffer cmdBuffer, uint32_t cmdindex, const DrawTarget& target, uint32_t view, const glm::mat4* objectmat);
+	//cmdindex is recorded again, the gpu has to be done with it
+	void Reset(uint32_t cmdindex);
+
+	//writes the arguments of every draw recorded into cmdindex before it is submitted, returns the triangles selected
+	uint64_t Update(uint32_t cmdindex);
+
+private:
+	struct View
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		//0 until the view is set, every draw takes the coarsest level
+		float projectionScale = 0.0f;
+	};
+
+	struct Chunk
+	{
+		uint32_t buffer;
+		VkDeviceSize size;
+		VkDeviceSize used = 0;
+		//whole chunk is written with one map
+		std::vector<uint8_t> data;
+	};
+
+	struct Region
+	{
+		uint32_t chunk = 0;
+		VkDeviceSize offset = 0;
+	};
+
+	struct Draw
+	{
+		const DrawTarget* target;
+		uint32_t view;
+		const glm::mat4* objectMat;
+		//one command per level for instanced targets, otherwise a single one
+		Region commands;
+		//instancenumber offsets per level, instanced targets only
+		Region instances;
+	};
+
+	struct Arena
+	{
+		std::vector<Chunk> chunks;
+		uint32_t current = 0;
+		std::vector<Draw> draws;
+	};
+
+	Region allocate(Arena& arena, VkDeviceSize size);
+
+	std::vector<View> views;
+	//one per command buffer index, chunks are kept and reused when it is recorded again
+	std::vector<Arena> arenas;
+
+	//instance count of each level while sorting the instances
+	std::vector<uint32_t> levelCounts;
+};
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "MeshOptimizer.hpp"
+
+//standard library
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace
+{
+	//lru cache the scores assume, larger than the real ones so the order holds on every gpu
+	constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+	constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	//cache the overdraw clusters are measured with, same as AnalyzeVertexCache
+	constexpr uint32_t OVERDRAW_CACHE_SIZE = 16;
+
+	float VertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0) return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			//vertices of the triangle just emitted score the same, whichever of them comes next
+			if (cachePosition < 3) score = FORSYTH_LAST_TRIANGLE_SCORE;
+			else score = std::pow(1.0f - (cachePosition - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+		}
+
+		//vertices with few triangles left are finished first, so they leave the cache for good
+		score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+
+		return score;
+	}
+
+	//fifo as a clock, a vertex is cached while fewer than size misses happened after its own
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint32_t size) : timestamps(vertexCount, 0), cacheSize(size), time(size + 1) {}
+
+		//true on a miss
+		bool Access(uint32_t vertex)
+		{
+			if (time - timestamps[vertex] <= cacheSize) return false;
+
+			timestamps[vertex] = time++;
+			return true;
+		}
+
+		void Flush()
+		{
+			time += cacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32_t> timestamps;
+		uint32_t cacheSize;
+		uint32_t time;
+	};
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStatistics result;
+	if (indices.size() < 3) return result;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<uint8_t> referenced(vertexCount, 0);
+
+	size_t misses = 0;
+	size_t unique = 0;
+	for (uint32_t index : indices)
+	{
+		if (cache.Access(index)) ++misses;
+
+		if (referenced[index] == 0)
+		{
+			referenced[index] = 1;
+			++unique;
+		}
+	}
+
+	result.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	result.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+
+	return result;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0) return;
+
+	//triangles of every vertex, the ones not emitted yet are kept at the front of each range
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for (uint32_t index : indices)
+	{
+		++triangleOffsets[index + 1];
+	}
+	std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	{
+		std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				vertexTriangles[cursor[indices[t * 3 + corner]]++] = t;
+			}
+		}
+	}
+
+	std::vector<uint32_t> remaining(vertexCount);
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		remaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	uint32_t best = 0;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[best]) best = t;
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	uint32_t scanCursor = 0;
+
+	while (true)
+	{
+		emitted[best] = 1;
+		const uint32_t* triangle = &indices[best * 3];
+
+		nextCache.clear();
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			uint32_t v = triangle[corner];
+			result.push_back(v);
+
+			//move the triangle behind the ones v still has to emit
+			uint32_t* begin = &vertexTriangles[triangleOffsets[v]];
+			uint32_t* end = begin + remaining[v];
+			std::swap(*std::find(begin, end, best), *(end - 1));
+			--remaining[v];
+
+			if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+		}
+
+		//lru, the triangle just emitted moves to the front
+		size_t frontSize = nextCache.size();
+		for (uint32_t v : cache)
+		{
+			if (std::find(nextCache.begin(), nextCache.begin() + frontSize, v) == nextCache.begin() + frontSize) nextCache.push_back(v);
+		}
+
+		//vertices pushed out of the cache lose their cache score as well
+		for (uint32_t i = 0; i < nextCache.size(); ++i)
+		{
+			uint32_t v = nextCache[i];
+			cachePosition[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int32_t>(i) : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		//next triangle is the best one around the cache
+		float bestScore = -1.0f;
+		best = ~0u;
+		for (uint32_t v : nextCache)
+		{
+			for (uint32_t k = 0; k < remaining[v]; ++k)
+			{
+				uint32_t t = vertexTriangles[triangleOffsets[v] + k];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		if (nextCache.size() > FORSYTH_CACHE_SIZE) nextCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(nextCache);
+
+		//nothing left around the cache, start again at the first triangle not emitted yet
+		if (best == ~0u)
+		{
+			while (scanCursor < triangleCount && emitted[scanCursor]) ++scanCursor;
+			if (scanCursor == triangleCount) break;
+
+			best = scanCursor;
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0) return;
+
+	//a triangle that misses with every vertex starts over on a cold cache, moving it costs nothing
+	std::vector<uint32_t> clusters;
+	{
+		FifoCache cache(positions.size(), OVERDRAW_CACHE_SIZE);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			uint32_t misses = 0;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				if (cache.Access(indices[t * 3 + corner])) ++misses;
+			}
+
+			if (misses == 3 || t == 0) clusters.push_back(t);
+		}
+	}
+
+	//large clusters split further wherever the part so far is within threshold of the cluster's own acmr
+	{
+		std::vector<uint32_t> softClusters;
+		FifoCache cache(positions.size(), OVERDRAW_CACHE_SIZE);
+
+		auto countMisses = [&](uint32_t t) -> uint32_t
+		{
+			uint32_t misses = 0;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				if (cache.Access(indices[t * 3 + corner])) ++misses;
+			}
+			return misses;
+		};
+
+		for (size_t c = 0; c < clusters.size(); ++c)
+		{
+			uint32_t begin = clusters[c];
+			uint32_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				clusterMisses += countMisses(t);
+			}
+			float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			cache.Flush();
+			softClusters.push_back(begin);
+			uint32_t start = begin;
+			uint32_t misses = 0;
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				misses += countMisses(t);
+
+				if (t + 1 < end && static_cast<float>(misses) / static_cast<float>(t + 1 - start) <= clusterThreshold)
+				{
+					softClusters.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.Flush();
+				}
+			}
+		}
+
+		clusters.swap(softClusters);
+	}
+
+	//clusters facing away from the mesh center are likely in front of the rest, drawing them first occludes it
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		glm::vec3 p0 = positions[indices[t * 3]];
+		glm::vec3 p1 = positions[indices[t * 3 + 1]];
+		glm::vec3 p2 = positions[indices[t * 3 + 2]];
+
+		float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+		meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	std::vector<float> sortKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		uint32_t begin = clusters[c];
+		uint32_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			glm::vec3 p0 = positions[indices[t * 3]];
+			glm::vec3 p1 = positions[indices[t * 3 + 1]];
+			glm::vec3 p2 = positions[indices[t * 3 + 2]];
+
+			glm::vec3 weightedNormal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(weightedNormal);
+
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += weightedNormal;
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if (area <= 0.0f || normalLength <= 0.0f) continue;
+
+		sortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+
+	std::vector<uint32_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return sortKeys[x] > sortKeys[y]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t c : order)
+	{
+		uint32_t begin = clusters[c];
+		uint32_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+		result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+	}
+
+	indices = std::move(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, ~0u);
+	uint32_t next = 0;
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == ~0u) remap[index] = next++;
+		index = remap[index];
+	}
+
+	return remap;
+}
\ No newline at end of file
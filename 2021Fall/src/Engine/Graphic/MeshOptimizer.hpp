@@ -0,0 +1,53 @@
+#pragma once
+
+//3rd party library
+#include <glm/glm.hpp>
+
+//standard library
+#include <vector>
+#include <cstdint>
+
+//simulated fifo post transform cache
+struct VertexCacheStatistics
+{
+	//vertex shader invocations per triangle, 0.5 ~ 3
+	float acmr = 0.0f;
+	//vertex shader invocations per referenced vertex, 1 is perfect
+	float atvr = 0.0f;
+};
+
+//reorders a triangle list for the gpu, the triangles themselves stay the same
+//run the passes in the order declared, each one keeps most of what the one before gained
+namespace MeshOptimizer
+{
+	VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	//triangle order that reuses recently transformed vertices, linear speed vertex cache optimisation (Forsyth)
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	//splits the cache ordered triangles into clusters where the cache is cold anyway and draws outward facing clusters first
+	//threshold is how much worse than the input the acmr of a cluster may get, e.g. 1.05
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold);
+
+	//renumbers the vertices in the order the indices first use them, returns the old -> new index
+	//unreferenced vertices get ~0u and are dropped by RemapVertices
+	std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	template<typename T>
+	void RemapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap)
+	{
+		uint32_t count = 0;
+		for (uint32_t index : remap)
+		{
+			if (index != ~0u) ++count;
+		}
+
+		std::vector<T> result(count);
+		for (size_t i = 0; i < remap.size(); ++i)
+		{
+			if (remap[i] != ~0u) result[remap[i]] = vertices[i];
+		}
+
+		vertices = std::move(result);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "MeshSimplifier.hpp"
+
+//standard library
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+namespace
+{
+	//sum of squared distances to planes weighted by triangle area, e(p) = p.A.p + 2 b.p + c with A symmetric
+	struct Quadric
+	{
+		float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f, a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+		float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+		float c = 0.0f;
+		float weight = 0.0f;
+	};
+
+	//plane n.p + d = 0 with unit n
+	Quadric PlaneQuadric(glm::vec3 n, float d, float weight)
+	{
+		Quadric q;
+		q.a00 = n.x * n.x * weight;
+		q.a11 = n.y * n.y * weight;
+		q.a22 = n.z * n.z * weight;
+		q.a01 = n.x * n.y * weight;
+		q.a02 = n.x * n.z * weight;
+		q.a12 = n.y * n.z * weight;
+		q.b0 = n.x * d * weight;
+		q.b1 = n.y * d * weight;
+		q.b2 = n.z * d * weight;
+		q.c = d * d * weight;
+		q.weight = weight;
+
+		return q;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00;
+		q.a11 += other.a11;
+		q.a22 += other.a22;
+		q.a01 += other.a01;
+		q.a02 += other.a02;
+		q.a12 += other.a12;
+		q.b0 += other.b0;
+		q.b1 += other.b1;
+		q.b2 += other.b2;
+		q.c += other.c;
+		q.weight += other.weight;
+	}
+
+	//mean squared distance of p to the planes of the quadric, only orders the candidates
+	float QuadricError(const Quadric& q, glm::vec3 p)
+	{
+		float rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z + q.b0;
+		float ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z + q.b1;
+		float rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z + q.b2;
+
+		float error = p.x * rx + p.y * ry + p.z * rz + q.b0 * p.x + q.b1 * p.y + q.b2 * p.z + q.c;
+
+		return (q.weight > 0.0f) ? std::fabs(error) / q.weight : 0.0f;
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+	}
+
+	//first vertex with each position, every index is moved onto it
+	std::vector<uint32_t> WeldPositions(const std::vector<glm::vec3>& positions)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				const uint32_t* bits = reinterpret_cast<const uint32_t*>(&p);
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> first;
+		first.reserve(positions.size());
+
+		std::vector<uint32_t> remap(positions.size());
+		for (uint32_t i = 0; i < positions.size(); ++i)
+		{
+			remap[i] = first.try_emplace(positions[i], i).first->second;
+		}
+
+		return remap;
+	}
+
+	//largest distance of p to any of the planes, this is what the error bound is made of
+	float PlaneDistance(const std::vector<glm::vec4>& planes, const std::vector<uint32_t>& planeIndices, glm::vec3 p)
+	{
+		float distance = 0.0f;
+		for (uint32_t plane : planeIndices)
+		{
+			distance = std::max(distance, std::fabs(glm::dot(glm::vec3(planes[plane]), p) + planes[plane].w));
+		}
+
+		return distance;
+	}
+
+	void AddPlane(std::vector<glm::vec4>& planes, std::vector<std::vector<uint32_t>>& vertexPlanes, glm::vec3 n, float d, std::initializer_list<uint32_t> vertices)
+	{
+		uint32_t plane = static_cast<uint32_t>(planes.size());
+		planes.push_back(glm::vec4(n, d));
+		for (uint32_t vertex : vertices)
+		{
+			vertexPlanes[vertex].push_back(plane);
+		}
+	}
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+}
+
+SimplifiedMesh MeshSimplifier::Simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError)
+{
+	SimplifiedMesh result;
+
+	std::vector<uint32_t> remap = WeldPositions(positions);
+	result.indices.reserve(indices.size());
+	for (uint32_t index : indices)
+	{
+		result.indices.push_back(remap[index]);
+	}
+
+	//the quadrics keep the mean, the plane lists keep every plane a vertex has absorbed for the max
+	std::vector<Quadric> quadrics(positions.size());
+	std::vector<glm::vec4> planes;
+	std::vector<std::vector<uint32_t>> vertexPlanes(positions.size());
+	for (size_t i = 0; i + 2 < result.indices.size(); i += 3)
+	{
+		glm::vec3 p0 = positions[result.indices[i]];
+		glm::vec3 p1 = positions[result.indices[i + 1]];
+		glm::vec3 p2 = positions[result.indices[i + 2]];
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		if (area <= 0.0f) continue;
+		normal /= area;
+
+		Quadric q = PlaneQuadric(normal, -glm::dot(normal, p0), area);
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			AddQuadric(quadrics[result.indices[i + corner]], q);
+		}
+		AddPlane(planes, vertexPlanes, normal, -glm::dot(normal, p0), { result.indices[i], result.indices[i + 1], result.indices[i + 2] });
+	}
+
+	//planes through every border edge perpendicular to its triangle keep the outline in place
+	{
+		std::vector<uint64_t> keys;
+		keys.reserve(result.indices.size());
+		for (size_t i = 0; i < result.indices.size(); ++i)
+		{
+			keys.push_back(EdgeKey(result.indices[i], result.indices[i - i % 3 + (i + 1) % 3]));
+		}
+		std::sort(keys.begin(), keys.end());
+
+		for (size_t i = 0; i < result.indices.size(); ++i)
+		{
+			uint32_t a = result.indices[i];
+			uint32_t b = result.indices[i - i % 3 + (i + 1) % 3];
+			auto [first, last] = std::equal_range(keys.begin(), keys.end(), EdgeKey(a, b));
+			if (last - first != 1) continue;
+
+			glm::vec3 p0 = positions[result.indices[i - i % 3]];
+			glm::vec3 faceNormal = glm::cross(positions[result.indices[i - i % 3 + 1]] - p0, positions[result.indices[i - i % 3 + 2]] - p0);
+			glm::vec3 edge = positions[b] - positions[a];
+
+			glm::vec3 normal = glm::cross(edge, faceNormal);
+			float length = glm::length(normal);
+			if (length <= 0.0f) continue;
+			normal /= length;
+
+			Quadric q = PlaneQuadric(normal, -glm::dot(normal, positions[a]), glm::dot(edge, edge));
+			AddQuadric(quadrics[a], q);
+			AddQuadric(quadrics[b], q);
+			AddPlane(planes, vertexPlanes, normal, -glm::dot(normal, positions[a]), { a, b });
+		}
+	}
+
+	//the mean is never above the max, so sorted by the mean the candidates can stop at the first one over the bound
+	float maxErrorSquared = maxError * maxError;
+	float largestError = 0.0f;
+
+	std::vector<uint64_t> edgeKeys;
+	std::vector<Collapse> collapses;
+	std::vector<std::vector<uint32_t>> vertexTriangles(positions.size());
+	std::vector<uint8_t> borderVertex(positions.size());
+	std::vector<uint8_t> locked(positions.size());
+	std::vector<uint32_t> collapseTarget(positions.size());
+
+	while (result.indices.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.indices.size() / 3;
+
+		//edges used by one triangle only are on a border
+		edgeKeys.clear();
+		for (size_t i = 0; i < result.indices.size(); i += 3)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				edgeKeys.push_back(EdgeKey(result.indices[i + corner], result.indices[i + (corner + 1) % 3]));
+			}
+		}
+		std::sort(edgeKeys.begin(), edgeKeys.end());
+
+		std::fill(borderVertex.begin(), borderVertex.end(), 0);
+		for (size_t i = 0; i < edgeKeys.size();)
+		{
+			size_t next = i + 1;
+			while (next < edgeKeys.size() && edgeKeys[next] == edgeKeys[i]) ++next;
+
+			if (next - i == 1)
+			{
+				uint32_t a = static_cast<uint32_t>(edgeKeys[i] >> 32);
+				uint32_t b = static_cast<uint32_t>(edgeKeys[i]);
+				borderVertex[a] = borderVertex[b] = 1;
+			}
+
+			i = next;
+		}
+
+		for (auto& triangles : vertexTriangles)
+		{
+			triangles.clear();
+		}
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				vertexTriangles[result.indices[t * 3 + corner]].push_back(t);
+			}
+		}
+
+		//both directions of every edge, a border vertex may only slide along the border
+		collapses.clear();
+		for (size_t i = 0; i < edgeKeys.size();)
+		{
+			size_t next = i + 1;
+			while (next < edgeKeys.size() && edgeKeys[next] == edgeKeys[i]) ++next;
+
+			uint32_t a = static_cast<uint32_t>(edgeKeys[i] >> 32);
+			uint32_t b = static_cast<uint32_t>(edgeKeys[i]);
+			bool borderEdge = (next - i == 1);
+
+			if (!borderVertex[a] || borderEdge) collapses.push_back({ a, b, QuadricError(quadrics[a], positions[b]) });
+			if (!borderVertex[b] || borderEdge) collapses.push_back({ b, a, QuadricError(quadrics[b], positions[a]) });
+
+			i = next;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+		//an interior collapse removes two triangles, the pass stops once the target is in reach
+		size_t collapseLimit = std::max<size_t>((triangleCount - targetIndexCount / 3) / 2, 1);
+		size_t collapseCount = 0;
+
+		std::fill(locked.begin(), locked.end(), 0);
+		for (uint32_t i = 0; i < collapseTarget.size(); ++i)
+		{
+			collapseTarget[i] = i;
+		}
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > maxErrorSquared) break;
+			if (locked[collapse.from] || locked[collapse.to]) continue;
+
+			//a triangle that keeps its area must not turn over
+			bool flips = false;
+			for (uint32_t t : vertexTriangles[collapse.from])
+			{
+				const uint32_t* triangle = &result.indices[t * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) continue;
+
+				glm::vec3 before[3], after[3];
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					before[corner] = positions[triangle[corner]];
+					after[corner] = (triangle[corner] == collapse.from) ? positions[collapse.to] : before[corner];
+				}
+
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+				{
+					flips = true;
+					break;
+				}
+			}
+			if (flips) continue;
+
+			float distance = PlaneDistance(planes, vertexPlanes[collapse.from], positions[collapse.to]);
+			if (distance > maxError) continue;
+
+			collapseTarget[collapse.from] = collapse.to;
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			largestError = std::max(largestError, distance);
+
+			std::vector<uint32_t>& merged = vertexPlanes[collapse.to];
+			merged.insert(merged.end(), vertexPlanes[collapse.from].begin(), vertexPlanes[collapse.from].end());
+			std::sort(merged.begin(), merged.end());
+			merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+			vertexPlanes[collapse.from].clear();
+
+			//neighbors keep their adjacency and position until the next pass rebuilds it
+			for (uint32_t t : vertexTriangles[collapse.from])
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					locked[result.indices[t * 3 + corner]] = 1;
+				}
+			}
+			locked[collapse.to] = 1;
+
+			if (++collapseCount >= collapseLimit) break;
+		}
+
+		if (collapseCount == 0) break;
+
+		//triangles that lost an edge disappear
+		size_t write = 0;
+		for (size_t i = 0; i < result.indices.size(); i += 3)
+		{
+			uint32_t a = collapseTarget[result.indices[i]];
+			uint32_t b = collapseTarget[result.indices[i + 1]];
+			uint32_t c = collapseTarget[result.indices[i + 2]];
+			if (a == b || b == c || c == a) continue;
+
+			result.indices[write++] = a;
+			result.indices[write++] = b;
+			result.indices[write++] = c;
+		}
+		result.indices.resize(write);
+	}
+
+	result.error = largestError;
+
+	return result;
+}
+
+std::vector<SimplifiedMesh> MeshSimplifier::GenerateLODs(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, uint32_t maxLevels, float maxError)
+{
+	std::vector<SimplifiedMesh> levels;
+	levels.push_back({ indices, 0.0f });
+
+	while (levels.size() < maxLevels)
+	{
+		const SimplifiedMesh& previous = levels.back();
+
+		size_t target = (previous.indices.size() / 6) * 3;
+		float remainingError = maxError - previous.error;
+		if (remainingError <= 0.0f) break;
+
+		SimplifiedMesh level = Simplify(positions, previous.indices, target, remainingError);
+		if (level.indices.empty() || level.indices.size() * 4 > previous.indices.size() * 3) break;
+
+		level.error += previous.error;
+		levels.push_back(std::move(level));
+	}
+
+	return levels;
+}
\ No newline at end of file
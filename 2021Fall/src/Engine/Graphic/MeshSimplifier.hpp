@@ -0,0 +1,28 @@
+#pragma once
+
+//3rd party library
+#include <glm/glm.hpp>
+
+//standard library
+#include <vector>
+#include <cstdint>
+
+struct SimplifiedMesh
+{
+	std::vector<uint32_t> indices;
+	//object space distance the surface moved at most, the largest distance of a collapsed vertex to the original planes around it
+	//summed over the levels it was built from
+	float error = 0.0f;
+};
+
+//quadric error edge collapse onto existing vertices, the vertex buffer stays as it is and only the indices change
+//vertices with the same position are welded first, so normal seams do not open into cracks
+namespace MeshSimplifier
+{
+	//stops at targetIndexCount, collapses that would move the surface further than maxError are skipped
+	SimplifiedMesh Simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError);
+
+	//levels[0] is the input, every next level is simplified from the one before to half its triangles
+	//ends early once a level can not get below 3/4 of the previous one within maxError
+	std::vector<SimplifiedMesh> GenerateLODs(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, uint32_t maxLevels, float maxError);
+}
\ No newline at end of file
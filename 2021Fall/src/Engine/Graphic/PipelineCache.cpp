@@ -0,0 +1,172 @@
+#include "PipelineCache.hpp"
+
+//standard library
+#include <stdexcept>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+
+constexpr uint32_t PIPELINECACHE_MAGIC = 0x50434348; //"PCCH"
+constexpr uint32_t PIPELINECACHE_VERSION = 1;
+
+constexpr const char* PIPELINECACHE_DIRECTORY = "data/cache/";
+
+PipelineCache::PipelineCache(VkDevice device) : vulkanDevice(device) {}
+
+void PipelineCache::init(const VkPhysicalDeviceProperties& properties)
+{
+	deviceProperties = properties;
+
+	//one file per device/driver pair so switching gpu or updating driver does not thrash a single file
+	std::stringstream name;
+	name << PIPELINECACHE_DIRECTORY << "pipeline_" << std::hex << deviceProperties.vendorID << "_" << deviceProperties.deviceID << "_" << deviceProperties.driverVersion << ".cache";
+	filename = name.str();
+
+	std::vector<char> filedata = loadFromDisk();
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	if (validateHeader(filedata))
+	{
+		pipelineCacheCreateInfo.initialDataSize = filedata.size() - sizeof(PipelineCacheFileHeader);
+		pipelineCacheCreateInfo.pInitialData = filedata.data() + sizeof(PipelineCacheFileHeader);
+		savedSize = pipelineCacheCreateInfo.initialDataSize;
+	}
+	else if (!filedata.empty())
+	{
+		std::cout << "discard pipeline cache " << filename << " (written by another device or driver)" << std::endl;
+	}
+
+	if (vkCreatePipelineCache(vulkanDevice, &pipelineCacheCreateInfo, nullptr, &vulkanPipelineCache) != VK_SUCCESS)
+	{
+		//the driver may still reject a blob that passed the header check, start from empty in that case
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		savedSize = 0;
+
+		if (vkCreatePipelineCache(vulkanDevice, &pipelineCacheCreateInfo, nullptr, &vulkanPipelineCache) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create pipeline cache!");
+		}
+	}
+}
+
+void PipelineCache::close()
+{
+	save();
+
+	vkDestroyPipelineCache(vulkanDevice, vulkanPipelineCache, nullptr);
+	vulkanPipelineCache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(vulkanDevice, vulkanPipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+
+	//caches only ever grow, so an unchanged size means nothing new was compiled
+	if (dataSize == savedSize) return;
+
+	std::vector<char> filedata(sizeof(PipelineCacheFileHeader) + dataSize);
+
+	if (vkGetPipelineCacheData(vulkanDevice, vulkanPipelineCache, &dataSize, filedata.data() + sizeof(PipelineCacheFileHeader)) != VK_SUCCESS)
+	{
+		return;
+	}
+	filedata.resize(sizeof(PipelineCacheFileHeader) + dataSize);
+
+	PipelineCacheFileHeader header{};
+	header.magic = PIPELINECACHE_MAGIC;
+	header.version = PIPELINECACHE_VERSION;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	std::memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+	std::memcpy(filedata.data(), &header, sizeof(PipelineCacheFileHeader));
+
+	std::error_code error;
+	std::filesystem::create_directories(PIPELINECACHE_DIRECTORY, error);
+
+	//write to a temporary file first so a crash while writing never leaves a truncated cache behind
+	std::string tempname = filename + ".tmp";
+	{
+		std::ofstream file(tempname, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "failed to write pipeline cache " << tempname << std::endl;
+			return;
+		}
+		file.write(filedata.data(), filedata.size());
+	}
+
+	std::filesystem::rename(tempname, filename, error);
+	if (error)
+	{
+		std::cout << "failed to write pipeline cache " << filename << std::endl;
+		return;
+	}
+
+	savedSize = dataSize;
+}
+
+VkPipelineCache PipelineCache::GetPipelineCache() const
+{
+	return vulkanPipelineCache;
+}
+
+std::vector<char> PipelineCache::loadFromDisk() const
+{
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) return {};
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	return buffer;
+}
+
+bool PipelineCache::validateHeader(const std::vector<char>& filedata) const
+{
+	if (filedata.size() <= sizeof(PipelineCacheFileHeader)) return false;
+
+	PipelineCacheFileHeader header;
+	std::memcpy(&header, filedata.data(), sizeof(PipelineCacheFileHeader));
+
+	if (header.magic != PIPELINECACHE_MAGIC || header.version != PIPELINECACHE_VERSION) return false;
+	if (header.dataSize != filedata.size() - sizeof(PipelineCacheFileHeader)) return false;
+
+	if (header.vendorID != deviceProperties.vendorID || header.deviceID != deviceProperties.deviceID) return false;
+	if (header.driverVersion != deviceProperties.driverVersion) return false;
+	if (std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) return false;
+
+	//the driver blob carries its own header (VkPipelineCacheHeaderVersionOne), check it matches as well
+	struct
+	{
+		uint32_t headerSize;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	} blobheader;
+
+	if (header.dataSize < sizeof(blobheader)) return false;
+	std::memcpy(&blobheader, filedata.data() + sizeof(PipelineCacheFileHeader), sizeof(blobheader));
+
+	if (blobheader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return false;
+	if (blobheader.headerSize < sizeof(blobheader) || blobheader.headerSize > header.dataSize) return false;
+	if (blobheader.vendorID != deviceProperties.vendorID || blobheader.deviceID != deviceProperties.deviceID) return false;
+	if (std::memcmp(blobheader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) return false;
+
+	return true;
+}
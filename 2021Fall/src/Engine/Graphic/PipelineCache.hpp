@@ -0,0 +1,47 @@
+#pragma once
+
+//3rd party library
+#include <vulkan/vulkan.h>
+
+//standard library
+#include <string>
+#include <vector>
+
+//written in front of the driver blob so a file from another device or driver is never handed to vulkan
+struct PipelineCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+};
+
+//one VkPipelineCache shared by every pipeline, persisted between runs
+class PipelineCache
+{
+public:
+	PipelineCache(VkDevice device);
+
+	void init(const VkPhysicalDeviceProperties& properties);
+	void close();
+
+	//write the cache back to disk when the driver blob changed since the last load/save
+	void save();
+
+	VkPipelineCache GetPipelineCache() const;
+
+private:
+	std::vector<char> loadFromDisk() const;
+	bool validateHeader(const std::vector<char>& filedata) const;
+
+	VkDevice vulkanDevice;
+	VkPipelineCache vulkanPipelineCache = VK_NULL_HANDLE;
+
+	VkPhysicalDeviceProperties deviceProperties;
+
+	std::string filename;
+	size_t savedSize = 0;
+};
@@ -3,6 +3,7 @@
 
 //standard library
 #include <stdexcept>
+#include <algorithm>
 
 Renderpass::Renderpass(VkDevice device) : vulkanDevice(device) {}
 
@@ -13,6 +14,12 @@ void Renderpass::init()
 
 void Renderpass::createRenderPass()
 {
+    if (!subpasses.empty())
+    {
+        createMultiSubpassRenderPass();
+        return;
+    }
+
     std::vector<VkAttachmentReference> colorattachmentRefs;
     std::vector<VkAttachmentReference> resolvedattachmentRefs;
     VkAttachmentReference depthAttachmentRef;
@@ -74,7 +81,7 @@ void Renderpass::createRenderPass()
     subpass.pColorAttachments = colorattachmentRefs.data();
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
     if (nodepth) subpass.pDepthStencilAttachment = nullptr;
-    subpass.pResolveAttachments = resolvedattachmentRefs.data();
+    subpass.pResolveAttachments = resolvedattachmentRefs.empty() ? nullptr : resolvedattachmentRefs.data();
 
     outputSize = static_cast<uint32_t>(colorattachmentRefs.size());
 
@@ -93,25 +100,112 @@ void Renderpass::createRenderPass()
     }
 }
 
+void Renderpass::createMultiSubpassRenderPass()
+{
+    std::vector<VkAttachmentDescription> attachmentdescription;
+    for (const auto& attach : attachments)
+    {
+        attachmentdescription.push_back(attach.attachmentDescription);
+    }
+
+    auto makeRefs = [](const std::vector<uint32_t>& indices, VkImageLayout layout)
+    {
+        std::vector<VkAttachmentReference> refs;
+        for (uint32_t index : indices)
+        {
+            refs.push_back({ index, layout });
+        }
+        return refs;
+    };
+
+    //references have to outlive vkCreateRenderPass
+    std::vector<std::vector<VkAttachmentReference>> colorRefs, resolveRefs, inputRefs;
+    std::vector<VkAttachmentReference> depthRefs(subpasses.size());
+    std::vector<VkSubpassDescription> subpassDescriptions(subpasses.size());
+
+    for (size_t i = 0; i < subpasses.size(); ++i)
+    {
+        const Subpass& subpass = subpasses[i];
+
+        colorRefs.push_back(makeRefs(subpass.colorAttachments, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+        resolveRefs.push_back(makeRefs(subpass.resolveAttachments, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+        inputRefs.push_back(makeRefs(subpass.inputAttachments, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+
+        VkSubpassDescription& description = subpassDescriptions[i];
+        description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        description.colorAttachmentCount = static_cast<uint32_t>(colorRefs.back().size());
+        description.pColorAttachments = colorRefs.back().data();
+        description.pResolveAttachments = resolveRefs.back().empty() ? nullptr : resolveRefs.back().data();
+        description.inputAttachmentCount = static_cast<uint32_t>(inputRefs.back().size());
+        description.pInputAttachments = inputRefs.back().data();
+
+        if (subpass.depthAttachment.has_value())
+        {
+            depthRefs[i] = { subpass.depthAttachment.value(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+            description.pDepthStencilAttachment = &depthRefs[i];
+        }
+    }
+
+    std::vector<VkSubpassDependency> dependencies;
+
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = 0;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies.push_back(dependency);
+
+    //each fragment only reads what the previous subpass wrote at the same pixel, so the data can stay in tile memory
+    for (uint32_t i = 1; i < subpasses.size(); ++i)
+    {
+        dependency.srcSubpass = i - 1;
+        dependency.dstSubpass = i;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependency.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+        dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+        dependencies.push_back(dependency);
+    }
+
+    outputSize = static_cast<uint32_t>(colorRefs.back().size());
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentdescription.size());
+    renderPassInfo.pAttachments = attachmentdescription.data();
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpassDescriptions.size());
+    renderPassInfo.pSubpasses = subpassDescriptions.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(vulkanDevice, &renderPassInfo, nullptr, &renderPassObject) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create render pass!");
+    }
+}
+
 void Renderpass::createFramebuffers(uint32_t width, uint32_t height, uint32_t layer, uint32_t number)
 {
     extent = { width, height };
+    framebufferLayer = layer;
+    imageless = false;
 
     framebufferObjects.resize(number);
 
+    setupClearValues();
+
     for (uint32_t j = 0; j < number; ++j)
     {
         std::vector<VkImageView> imageAttachments;
         uint32_t attachmentsize = static_cast<uint32_t>(attachments.size());
         imageAttachments.resize(attachmentsize);
-        clearValues.resize(attachmentsize);
 
         for (uint32_t i = 0; i < attachmentsize; ++i)
         {
             imageAttachments[i] = attachments[i].imageViews[j];
-
-            if (attachments[i].type == AttachmentType::ATTACHMENT_DEPTH) clearValues[i].depthStencil = { 1.0f, 0 };
-            else clearValues[i].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
         }
 
         VkFramebufferCreateInfo framebufferInfo{};
@@ -130,6 +224,69 @@ void Renderpass::createFramebuffers(uint32_t width, uint32_t height, uint32_t la
     }
 }
 
+void Renderpass::createImagelessFramebuffer(uint32_t width, uint32_t height, uint32_t layer)
+{
+    extent = { width, height };
+    framebufferLayer = layer;
+    imageless = true;
+
+    setupClearValues();
+
+    uint32_t attachmentsize = static_cast<uint32_t>(attachments.size());
+
+    std::vector<VkFramebufferAttachmentImageInfo> attachmentImageInfos(attachmentsize);
+    for (uint32_t i = 0; i < attachmentsize; ++i)
+    {
+        VkFramebufferAttachmentImageInfo& imageinfo = attachmentImageInfos[i];
+        imageinfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO;
+        imageinfo.usage = attachments[i].usage;
+        imageinfo.width = width;
+        imageinfo.height = height;
+        imageinfo.layerCount = layer;
+        imageinfo.viewFormatCount = 1;
+        imageinfo.pViewFormats = &attachments[i].attachmentDescription.format;
+    }
+
+    VkFramebufferAttachmentsCreateInfo attachmentsInfo{};
+    attachmentsInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO;
+    attachmentsInfo.attachmentImageInfoCount = attachmentsize;
+    attachmentsInfo.pAttachmentImageInfos = attachmentImageInfos.data();
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.pNext = &attachmentsInfo;
+    framebufferInfo.flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT;
+    framebufferInfo.renderPass = renderPassObject;
+    framebufferInfo.attachmentCount = attachmentsize;
+    framebufferInfo.pAttachments = nullptr;
+    framebufferInfo.width = width;
+    framebufferInfo.height = height;
+    framebufferInfo.layers = layer;
+
+    framebufferObjects.resize(1);
+
+    if (vkCreateFramebuffer(vulkanDevice, &framebufferInfo, nullptr, &framebufferObjects[0]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create framebuffer!");
+    }
+}
+
+void Renderpass::resizeFramebuffer(uint32_t width, uint32_t height)
+{
+    if (!imageless)
+    {
+        throw std::runtime_error("only imageless framebuffer can be resized!");
+    }
+
+    for (auto& framebuffer : framebufferObjects)
+    {
+        vkDestroyFramebuffer(vulkanDevice, framebuffer, nullptr);
+    }
+    framebufferObjects.clear();
+
+    createImagelessFramebuffer(width, height, framebufferLayer);
+}
+
 void Renderpass::close()
 {
     for (auto& framebuffer : framebufferObjects)
@@ -145,17 +302,62 @@ void Renderpass::addAttachment(Attachment attachment)
     attachments.push_back(attachment);
 }
 
+void Renderpass::addSubpass(Subpass subpass)
+{
+    subpasses.push_back(subpass);
+}
+
+void Renderpass::setImageViews(uint32_t bindLocation, std::vector<VkImageView> imageViews)
+{
+    for (auto& attach : attachments)
+    {
+        if (attach.bindLocation == bindLocation)
+        {
+            attach.imageViews = imageViews;
+            return;
+        }
+    }
+
+    throw std::runtime_error("renderpass has no attachment at given location!");
+}
+
 VkRenderPass Renderpass::getRenderpass() const
 {
     return renderPassObject;
 }
 
+VkExtent2D Renderpass::getExtent() const
+{
+    return extent;
+}
+
 void Renderpass::beginRenderpass(VkCommandBuffer commandbuffer, uint32_t index)
 {
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPassObject;
-    renderPassInfo.framebuffer = framebufferObjects[index];
+
+    std::vector<VkImageView> imageViews;
+    VkRenderPassAttachmentBeginInfo attachmentBeginInfo{};
+    if (imageless)
+    {
+        //attachment with single view (e.g. depth) is shared by every index
+        for (const auto& attach : attachments)
+        {
+            imageViews.push_back(attach.imageViews[std::min<size_t>(index, attach.imageViews.size() - 1)]);
+        }
+
+        attachmentBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+        attachmentBeginInfo.attachmentCount = static_cast<uint32_t>(imageViews.size());
+        attachmentBeginInfo.pAttachments = imageViews.data();
+
+        renderPassInfo.pNext = &attachmentBeginInfo;
+        renderPassInfo.framebuffer = framebufferObjects[0];
+    }
+    else
+    {
+        renderPassInfo.framebuffer = framebufferObjects[index];
+    }
 
     renderPassInfo.renderArea.offset = { 0,0 };
     renderPassInfo.renderArea.extent = extent;
@@ -164,9 +366,41 @@ void Renderpass::beginRenderpass(VkCommandBuffer commandbuffer, uint32_t index)
     renderPassInfo.pClearValues = clearValues.data();
 
     vkCmdBeginRenderPass(commandbuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    //viewport and scissor are dynamic state in every pipeline
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0,0 };
+    scissor.extent = extent;
+    vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
+}
+
+void Renderpass::nextSubpass(VkCommandBuffer commandbuffer)
+{
+    vkCmdNextSubpass(commandbuffer, VK_SUBPASS_CONTENTS_INLINE);
 }
 
 uint32_t Renderpass::getOutputSize() const
 {
     return outputSize;
 }
+
+void Renderpass::setupClearValues()
+{
+    uint32_t attachmentsize = static_cast<uint32_t>(attachments.size());
+    clearValues.resize(attachmentsize);
+
+    for (uint32_t i = 0; i < attachmentsize; ++i)
+    {
+        if (attachments[i].type == AttachmentType::ATTACHMENT_DEPTH) clearValues[i].depthStencil = { 1.0f, 0 };
+        else clearValues[i].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+    }
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 //standard library
 #include <vector>
+#include <optional>
 
 class Renderpass
 {
@@ -14,6 +15,10 @@ public:
 	void init();
 	void createRenderPass();
 	void createFramebuffers(uint32_t width, uint32_t height, uint32_t layer, uint32_t number = 1);
+	//one framebuffer without image views, attachments are given at beginRenderpass
+	void createImagelessFramebuffer(uint32_t width, uint32_t height, uint32_t layer);
+	//recreate the imageless framebuffer only, renderpass and pipelines built on it stay valid
+	void resizeFramebuffer(uint32_t width, uint32_t height);
 	void close();
 
 public:
@@ -30,12 +35,29 @@ public:
 		uint32_t bindLocation;
 		std::vector<VkImageView> imageViews;
 		VkAttachmentDescription attachmentDescription;
+
+		//must match the images exactly when used with imageless framebuffer
+		VkImageUsageFlags usage = 0;
+	};
+
+	//explicit subpass layout by attachment index, without any the renderpass is one subpass built from the attachment types
+	struct Subpass
+	{
+		std::vector<uint32_t> colorAttachments;
+		std::vector<uint32_t> resolveAttachments;
+		//written by an earlier subpass, read with subpassLoad
+		std::vector<uint32_t> inputAttachments;
+		std::optional<uint32_t> depthAttachment;
 	};
 
 	void addAttachment(Attachment attachment);
+	void addSubpass(Subpass subpass);
+	void setImageViews(uint32_t bindLocation, std::vector<VkImageView> imageViews);
 	VkRenderPass getRenderpass() const;
+	VkExtent2D getExtent() const;
 
 	void beginRenderpass(VkCommandBuffer commandbuffer, uint32_t index = 0);
+	void nextSubpass(VkCommandBuffer commandbuffer);
 	uint32_t getOutputSize() const;
 
 private:
@@ -43,11 +65,19 @@ private:
 	std::vector<VkFramebuffer> framebufferObjects;
 
 	std::vector<Attachment> attachments;
+	std::vector<Subpass> subpasses;
 	std::vector<VkClearValue> clearValues;
 
 	uint32_t outputSize;
 
+	bool imageless = false;
+	uint32_t framebufferLayer = 1;
+
 	VkDevice vulkanDevice;
 
 	VkExtent2D extent;
+
+private:
+	void setupClearValues();
+	void createMultiSubpassRenderPass();
 };
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "ShaderCompiler.hpp"
+
+//standard library
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <algorithm>
+
+//3rd party library
+#include <vulkan/vulkan.h>
+//defined by the build when it links shaderc
+#ifdef SHADERCOMPILER_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+namespace
+{
+	//bump when the compile options change, old cache entries are then never looked up again
+	constexpr uint32_t SHADERCOMPILER_VERSION = 1;
+	constexpr const char* SHADERCOMPILER_DIRECTORY = "data/cache/shaders/";
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+	//deeper than any chain in data/shaders, only there to stop include cycles
+	constexpr uint32_t MAX_INCLUDE_DEPTH = 16;
+
+	std::vector<uint32_t> ReadSPIRV(const std::string& filename)
+	{
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) return {};
+
+		size_t fileSize = static_cast<size_t>(file.tellg());
+		if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) return {};
+
+		std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+		//truncated or foreign file is treated as a miss
+		if (!file || code[0] != SPIRV_MAGIC) return {};
+
+		return code;
+	}
+
+	//the file compileshader.bat writes for the source, every dot of the name removed
+	std::string PrebuiltName(const std::string& filename)
+	{
+		std::filesystem::path path(filename);
+		std::string name = path.filename().string();
+		name.erase(std::remove(name.begin(), name.end(), '.'), name.end());
+
+		return (path.parent_path() / (name + ".spv")).generic_string();
+	}
+
+#ifdef SHADERCOMPILER_SHADERC
+	bool ReadText(const std::string& filename, std::string& text)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open()) return false;
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		text = stream.str();
+
+		return true;
+	}
+
+	//#include "x" is relative to the including file, same as glslc
+	std::string IncludePath(const std::string& requesting, const std::string& requested)
+	{
+		return (std::filesystem::path(requesting).parent_path() / requested).generic_string();
+	}
+
+	uint64_t HashBytes(const std::string& data, uint64_t hash)
+	{
+		//fnv-1a
+		for (unsigned char c : data)
+		{
+			hash ^= c;
+			hash *= 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+
+	//source and everything it includes, depth first, so editing light.glsl changes the key of deferred.frag
+	uint64_t HashSources(const std::string& filename, uint64_t hash, uint32_t depth)
+	{
+		if (depth > MAX_INCLUDE_DEPTH) throw std::runtime_error("include chain of " + filename + " is too deep!");
+
+		std::string source;
+		if (!ReadText(filename, source)) throw std::runtime_error("failed to open shader source " + filename);
+
+		hash = HashBytes(filename, hash);
+		hash = HashBytes(source, hash);
+
+		std::istringstream lines(source);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0) continue;
+
+			size_t open = line.find('"', start);
+			size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+			if (close == std::string::npos) continue;
+
+			hash = HashSources(IncludePath(filename, line.substr(open + 1, close - open - 1)), hash, depth + 1);
+		}
+
+		return hash;
+	}
+
+	void WriteSPIRV(const std::string& filename, const std::vector<uint32_t>& code)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(SHADERCOMPILER_DIRECTORY, error);
+
+		//same as the pipeline cache, a crash while writing never leaves a truncated entry behind
+		std::string tempname = filename + ".tmp";
+		{
+			std::ofstream file(tempname, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::cout << "failed to write shader cache " << tempname << std::endl;
+				return;
+			}
+			file.write(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+		}
+
+		std::filesystem::rename(tempname, filename, error);
+		if (error) std::cout << "failed to write shader cache " << filename << std::endl;
+	}
+
+	shaderc_shader_kind ShaderKind(const std::string& filename)
+	{
+		std::string extension = std::filesystem::path(filename).extension().string();
+
+		if (extension == ".vert") return shaderc_glsl_vertex_shader;
+		if (extension == ".frag") return shaderc_glsl_fragment_shader;
+		if (extension == ".geom") return shaderc_glsl_geometry_shader;
+		if (extension == ".comp") return shaderc_glsl_compute_shader;
+
+		throw std::runtime_error("unknown shader stage of " + filename);
+	}
+
+	class FileIncluder : public shaderc::CompileOptions::IncluderInterface
+	{
+	public:
+		shaderc_include_result* GetInclude(const char* requested_source, shaderc_include_type type, const char* requesting_source, size_t include_depth) override
+		{
+			IncludeData* data = new IncludeData;
+			data->result.user_data = data;
+
+			std::string path = IncludePath(requesting_source, requested_source);
+			if (ReadText(path, data->content))
+			{
+				data->name = path;
+			}
+			else
+			{
+				//empty name tells shaderc the include failed, content is the error
+				data->content = "failed to open " + path;
+			}
+
+			data->result.source_name = data->name.c_str();
+			data->result.source_name_length = data->name.size();
+			data->result.content = data->content.c_str();
+			data->result.content_length = data->content.size();
+
+			return &data->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result* data) override
+		{
+			delete static_cast<IncludeData*>(data->user_data);
+		}
+
+	private:
+		struct IncludeData
+		{
+			shaderc_include_result result{};
+			std::string name;
+			std::string content;
+		};
+	};
+
+	std::vector<uint32_t> Compile(const std::string& filename)
+	{
+		std::string source;
+		if (!ReadText(filename, source)) throw std::runtime_error("failed to open shader source " + filename);
+
+		shaderc::CompileOptions options;
+		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+		//runs the spirv-opt performance passes on the result
+		options.SetOptimizationLevel(shaderc_optimization_level_performance);
+		options.SetIncluder(std::make_unique<FileIncluder>());
+
+		shaderc::Compiler compiler;
+		shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, ShaderKind(filename), filename.c_str(), options);
+
+		if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+		{
+			throw std::runtime_error("failed to compile shader " + filename + "\n" + result.GetErrorMessage());
+		}
+
+		return std::vector<uint32_t>(result.cbegin(), result.cend());
+	}
+#endif
+}
+
+std::vector<uint32_t> ShaderCompiler::LoadSPIRV(const std::string& filename)
+{
+#ifdef SHADERCOMPILER_SHADERC
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	unsigned int spirvversion = 0;
+	unsigned int spirvrevision = 0;
+	shaderc_get_spv_version(&spirvversion, &spirvrevision);
+
+	//shaderc ships with the sdk, the header version stands in for the compiler build
+	std::stringstream compiler;
+	compiler << SHADERCOMPILER_VERSION << " " << VK_HEADER_VERSION_COMPLETE << " " << spirvversion << " " << spirvrevision;
+	hash = HashBytes(compiler.str(), hash);
+	hash = HashSources(filename, hash, 0);
+
+	std::stringstream cachename;
+	cachename << SHADERCOMPILER_DIRECTORY << std::filesystem::path(filename).filename().string() << "_" << std::hex << hash << ".spv";
+
+	std::vector<uint32_t> code = ReadSPIRV(cachename.str());
+	if (!code.empty()) return code;
+
+	code = Compile(filename);
+	WriteSPIRV(cachename.str(), code);
+
+	return code;
+#else
+	std::vector<uint32_t> code = ReadSPIRV(PrebuiltName(filename));
+	if (code.empty()) throw std::runtime_error("failed to open shader " + PrebuiltName(filename) + ", run compileshader.bat or build with shaderc");
+
+	return code;
+#endif
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+//standard library
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//glsl -> optimized spir-v at runtime with shaderc, 2021Fall.vcxproj links shaderc_shared from the vulkan sdk
+//results are cached in data/cache/shaders/ keyed by a hash of the source with every file it includes and the compiler version
+//builds without shaderc load the .spv next to the source written by compileshader.bat instead
+namespace ShaderCompiler
+{
+	//filename is the glsl source, e.g. data/shaders/deferred.frag, the stage follows from the extension
+	std::vector<uint32_t> LoadSPIRV(const std::string& filename);
+}
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "ShaderReflection.hpp"
+
+//standard library
+#include <stdexcept>
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+	constexpr uint32_t SPIRV_HEADER_SIZE = 5;
+
+	//values from the spir-v specification, only the ones read here
+	enum SpvOp : uint32_t
+	{
+		SPV_OP_ENTRY_POINT = 15,
+		SPV_OP_TYPE_INT = 21,
+		SPV_OP_TYPE_FLOAT = 22,
+		SPV_OP_TYPE_VECTOR = 23,
+		SPV_OP_TYPE_MATRIX = 24,
+		SPV_OP_TYPE_IMAGE = 25,
+		SPV_OP_TYPE_SAMPLER = 26,
+		SPV_OP_TYPE_SAMPLED_IMAGE = 27,
+		SPV_OP_TYPE_ARRAY = 28,
+		SPV_OP_TYPE_RUNTIME_ARRAY = 29,
+		SPV_OP_TYPE_STRUCT = 30,
+		SPV_OP_TYPE_POINTER = 32,
+		SPV_OP_CONSTANT = 43,
+		SPV_OP_SPEC_CONSTANT = 50,
+		SPV_OP_FUNCTION = 54,
+		SPV_OP_VARIABLE = 59,
+		SPV_OP_DECORATE = 71,
+		SPV_OP_MEMBER_DECORATE = 72,
+	};
+
+	enum SpvDecoration : uint32_t
+	{
+		SPV_DECORATION_BLOCK = 2,
+		SPV_DECORATION_BUFFER_BLOCK = 3,
+		SPV_DECORATION_ARRAY_STRIDE = 6,
+		SPV_DECORATION_MATRIX_STRIDE = 7,
+		SPV_DECORATION_BUILTIN = 11,
+		SPV_DECORATION_LOCATION = 30,
+		SPV_DECORATION_BINDING = 33,
+		SPV_DECORATION_DESCRIPTOR_SET = 34,
+		SPV_DECORATION_OFFSET = 35,
+	};
+
+	enum SpvStorageClass : uint32_t
+	{
+		SPV_STORAGE_UNIFORM_CONSTANT = 0,
+		SPV_STORAGE_INPUT = 1,
+		SPV_STORAGE_UNIFORM = 2,
+		SPV_STORAGE_PUSH_CONSTANT = 9,
+		SPV_STORAGE_STORAGE_BUFFER = 12,
+	};
+
+	enum SpvDim : uint32_t
+	{
+		SPV_DIM_BUFFER = 5,
+		SPV_DIM_SUBPASS_DATA = 6,
+	};
+
+	struct SpvType
+	{
+		SpvOp opcode;
+		//operands after the result id
+		std::vector<uint32_t> operands;
+	};
+
+	struct SpvDecorations
+	{
+		std::optional<uint32_t> set;
+		std::optional<uint32_t> binding;
+		std::optional<uint32_t> location;
+		std::optional<uint32_t> arrayStride;
+		bool block = false;
+		bool bufferBlock = false;
+		bool builtin = false;
+	};
+
+	struct SpvMemberDecorations
+	{
+		uint32_t offset = 0;
+		std::optional<uint32_t> matrixStride;
+	};
+
+	struct SpvVariable
+	{
+		uint32_t id;
+		uint32_t pointerType;
+		SpvStorageClass storageClass;
+	};
+
+	struct SpvModule
+	{
+		uint32_t executionModel = 0;
+		std::unordered_map<uint32_t, SpvType> types;
+		std::unordered_map<uint32_t, uint32_t> constants;
+		std::unordered_map<uint32_t, SpvDecorations> decorations;
+		//struct id -> members
+		std::unordered_map<uint32_t, std::unordered_map<uint32_t, SpvMemberDecorations>> memberDecorations;
+		//global variables in declaration order
+		std::vector<SpvVariable> variables;
+		std::unordered_set<uint32_t> usedVariables;
+	};
+
+	SpvModule Parse(const std::vector<uint32_t>& code)
+	{
+		if (code.size() < SPIRV_HEADER_SIZE || code[0] != SPIRV_MAGIC) throw std::runtime_error("shader code is not spir-v!");
+
+		SpvModule module;
+		std::unordered_set<uint32_t> variableIds;
+		bool inFunction = false;
+
+		size_t index = SPIRV_HEADER_SIZE;
+		while (index < code.size())
+		{
+			uint32_t wordCount = code[index] >> 16;
+			uint32_t opcode = code[index] & 0xFFFF;
+			if (wordCount == 0 || index + wordCount > code.size()) throw std::runtime_error("spir-v instruction is truncated!");
+
+			const uint32_t* words = &code[index];
+
+			if (inFunction)
+			{
+				//globals are declared before the first function, any operand naming one counts as a static use
+				//a literal that happens to equal a variable id only makes the layout bigger
+				for (uint32_t i = 1; i < wordCount; ++i)
+				{
+					if (variableIds.count(words[i]) != 0) module.usedVariables.insert(words[i]);
+				}
+			}
+			else
+			{
+				switch (opcode)
+				{
+				case SPV_OP_ENTRY_POINT:
+					module.executionModel = words[1];
+					break;
+				case SPV_OP_TYPE_INT:
+				case SPV_OP_TYPE_FLOAT:
+				case SPV_OP_TYPE_VECTOR:
+				case SPV_OP_TYPE_MATRIX:
+				case SPV_OP_TYPE_IMAGE:
+				case SPV_OP_TYPE_SAMPLER:
+				case SPV_OP_TYPE_SAMPLED_IMAGE:
+				case SPV_OP_TYPE_ARRAY:
+				case SPV_OP_TYPE_RUNTIME_ARRAY:
+				case SPV_OP_TYPE_STRUCT:
+				case SPV_OP_TYPE_POINTER:
+					module.types[words[1]] = { static_cast<SpvOp>(opcode), std::vector<uint32_t>(words + 2, words + wordCount) };
+					break;
+				case SPV_OP_CONSTANT:
+				case SPV_OP_SPEC_CONSTANT:
+					//array sizes from a specialization constant use its default
+					if (wordCount > 3) module.constants[words[2]] = words[3];
+					break;
+				case SPV_OP_VARIABLE:
+					module.variables.push_back({ words[2], words[1], static_cast<SpvStorageClass>(words[3]) });
+					variableIds.insert(words[2]);
+					break;
+				case SPV_OP_DECORATE:
+				{
+					SpvDecorations& decoration = module.decorations[words[1]];
+					switch (words[2])
+					{
+					case SPV_DECORATION_BLOCK: decoration.block = true; break;
+					case SPV_DECORATION_BUFFER_BLOCK: decoration.bufferBlock = true; break;
+					case SPV_DECORATION_BUILTIN: decoration.builtin = true; break;
+					case SPV_DECORATION_ARRAY_STRIDE: decoration.arrayStride = words[3]; break;
+					case SPV_DECORATION_LOCATION: decoration.location = words[3]; break;
+					case SPV_DECORATION_BINDING: decoration.binding = words[3]; break;
+					case SPV_DECORATION_DESCRIPTOR_SET: decoration.set = words[3]; break;
+					}
+					break;
+				}
+				case SPV_OP_MEMBER_DECORATE:
+				{
+					SpvMemberDecorations& decoration = module.memberDecorations[words[1]][words[2]];
+					if (words[3] == SPV_DECORATION_OFFSET) decoration.offset = words[4];
+					else if (words[3] == SPV_DECORATION_MATRIX_STRIDE) decoration.matrixStride = words[4];
+					break;
+				}
+				case SPV_OP_FUNCTION:
+					inFunction = true;
+					break;
+				}
+			}
+
+			index += wordCount;
+		}
+
+		return module;
+	}
+
+	const SpvType& GetType(const SpvModule& module, uint32_t id)
+	{
+		auto type = module.types.find(id);
+		if (type == module.types.end()) throw std::runtime_error("spir-v type " + std::to_string(id) + " is not supported!");
+
+		return type->second;
+	}
+
+	uint32_t GetConstant(const SpvModule& module, uint32_t id)
+	{
+		auto constant = module.constants.find(id);
+		if (constant == module.constants.end()) throw std::runtime_error("spir-v array length is not a constant!");
+
+		return constant->second;
+	}
+
+	//bytes of a type in a block, offsets and strides come from the decorations
+	uint32_t TypeSize(const SpvModule& module, uint32_t id, std::optional<uint32_t> matrixStride = std::nullopt)
+	{
+		const SpvType& type = GetType(module, id);
+
+		switch (type.opcode)
+		{
+		case SPV_OP_TYPE_INT:
+		case SPV_OP_TYPE_FLOAT:
+			return type.operands[0] / 8;
+		case SPV_OP_TYPE_VECTOR:
+			return type.operands[1] * TypeSize(module, type.operands[0]);
+		case SPV_OP_TYPE_MATRIX:
+			return type.operands[1] * matrixStride.value_or(TypeSize(module, type.operands[0]));
+		case SPV_OP_TYPE_ARRAY:
+		{
+			auto decoration = module.decorations.find(id);
+			uint32_t stride = (decoration != module.decorations.end() && decoration->second.arrayStride.has_value()) ? decoration->second.arrayStride.value() : TypeSize(module, type.operands[0], matrixStride);
+
+			return GetConstant(module, type.operands[1]) * stride;
+		}
+		case SPV_OP_TYPE_STRUCT:
+		{
+			uint32_t size = 0;
+			auto members = module.memberDecorations.find(id);
+			for (uint32_t i = 0; i < type.operands.size(); ++i)
+			{
+				SpvMemberDecorations member;
+				if (members != module.memberDecorations.end() && members->second.count(i) != 0) member = members->second.at(i);
+
+				size = std::max(size, member.offset + TypeSize(module, type.operands[i], member.matrixStride));
+			}
+			return size;
+		}
+		default:
+			throw std::runtime_error("size of spir-v type " + std::to_string(id) + " is unknown!");
+		}
+	}
+
+	VkDescriptorType DescriptorType(const SpvModule& module, const SpvType& type, uint32_t typeId, SpvStorageClass storageClass)
+	{
+		if (storageClass == SPV_STORAGE_STORAGE_BUFFER) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+		if (storageClass == SPV_STORAGE_UNIFORM)
+		{
+			auto decoration = module.decorations.find(typeId);
+			if (decoration != module.decorations.end() && decoration->second.bufferBlock) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+			return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		}
+
+		switch (type.opcode)
+		{
+		case SPV_OP_TYPE_SAMPLED_IMAGE:
+			return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case SPV_OP_TYPE_SAMPLER:
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case SPV_OP_TYPE_IMAGE:
+		{
+			//operands : sampled type, dim, depth, arrayed, multisampled, sampled (1 with sampler, 2 storage)
+			uint32_t dim = type.operands[1];
+			bool storage = type.operands[5] == 2;
+
+			if (dim == SPV_DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			if (dim == SPV_DIM_BUFFER) return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+
+			return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		default:
+			throw std::runtime_error("descriptor type of spir-v type " + std::to_string(typeId) + " is unknown!");
+		}
+	}
+
+	VkFormat VertexInputFormat(const SpvModule& module, uint32_t id)
+	{
+		const SpvType* type = &GetType(module, id);
+		uint32_t components = 1;
+		if (type->opcode == SPV_OP_TYPE_VECTOR)
+		{
+			components = type->operands[1];
+			type = &GetType(module, type->operands[0]);
+		}
+
+		//32 bit only, index = components - 1
+		static constexpr VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static constexpr VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static constexpr VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (components < 1 || components > 4 || type->operands[0] != 32) throw std::runtime_error("vertex input type " + std::to_string(id) + " is not supported!");
+
+		if (type->opcode == SPV_OP_TYPE_FLOAT) return floatFormats[components - 1];
+		if (type->opcode == SPV_OP_TYPE_INT) return (type->operands[1] != 0) ? intFormats[components - 1] : uintFormats[components - 1];
+
+		throw std::runtime_error("vertex input type " + std::to_string(id) + " is not supported!");
+	}
+
+	VkShaderStageFlagBits ShaderStage(uint32_t executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: throw std::runtime_error("execution model " + std::to_string(executionModel) + " is not supported!");
+		}
+	}
+}
+
+ShaderReflectionData ShaderReflection::Reflect(const std::vector<uint32_t>& code)
+{
+	SpvModule module = Parse(code);
+
+	ShaderReflectionData data;
+	data.stage = ShaderStage(module.executionModel);
+
+	for (const auto& variable : module.variables)
+	{
+		if (module.usedVariables.count(variable.id) == 0) continue;
+
+		const SpvType& pointer = GetType(module, variable.pointerType);
+		uint32_t typeId = pointer.operands[1];
+
+		auto found = module.decorations.find(variable.id);
+		SpvDecorations decoration = (found != module.decorations.end()) ? found->second : SpvDecorations();
+
+		if (variable.storageClass == SPV_STORAGE_PUSH_CONSTANT)
+		{
+			data.pushConstantSize = TypeSize(module, typeId);
+		}
+		else if (variable.storageClass == SPV_STORAGE_INPUT)
+		{
+			if (data.stage != VK_SHADER_STAGE_VERTEX_BIT || decoration.builtin || !decoration.location.has_value()) continue;
+
+			data.vertexInputs.push_back({ decoration.location.value(), VertexInputFormat(module, typeId) });
+		}
+		else if (variable.storageClass == SPV_STORAGE_UNIFORM_CONSTANT || variable.storageClass == SPV_STORAGE_UNIFORM || variable.storageClass == SPV_STORAGE_STORAGE_BUFFER)
+		{
+			if (!decoration.binding.has_value()) throw std::runtime_error("shader resource " + std::to_string(variable.id) + " has no binding!");
+
+			uint32_t count = 1;
+			const SpvType* type = &GetType(module, typeId);
+			while (type->opcode == SPV_OP_TYPE_ARRAY || type->opcode == SPV_OP_TYPE_RUNTIME_ARRAY)
+			{
+				if (type->opcode == SPV_OP_TYPE_RUNTIME_ARRAY) throw std::runtime_error("unsized descriptor arrays are not supported!");
+
+				count *= GetConstant(module, type->operands[1]);
+				typeId = type->operands[0];
+				type = &GetType(module, typeId);
+			}
+
+			data.descriptors.push_back({ decoration.set.value_or(0), decoration.binding.value(), DescriptorType(module, *type, typeId, variable.storageClass), count });
+		}
+	}
+
+	std::sort(data.descriptors.begin(), data.descriptors.end(), [](const ReflectedDescriptor& a, const ReflectedDescriptor& b)
+		{
+			return (a.set != b.set) ? a.set < b.set : a.binding < b.binding;
+		});
+	std::sort(data.vertexInputs.begin(), data.vertexInputs.end(), [](const ReflectedVertexInput& a, const ReflectedVertexInput& b)
+		{
+			return a.location < b.location;
+		});
+
+	return data;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+//3rd party library
+#include <vulkan/vulkan.h>
+
+//standard library
+#include <vector>
+#include <cstdint>
+
+struct ReflectedDescriptor
+{
+	uint32_t set;
+	uint32_t binding;
+	//uniform buffers are never reported as dynamic, spir-v does not know how they are bound
+	VkDescriptorType type;
+	//elements of a descriptor array
+	uint32_t count;
+};
+
+struct ReflectedVertexInput
+{
+	uint32_t location;
+	//32 bit components of the shader variable, the vertex attribute may use any format converting to it
+	VkFormat format;
+};
+
+struct ShaderReflectionData
+{
+	VkShaderStageFlagBits stage;
+	//sorted by set and binding
+	std::vector<ReflectedDescriptor> descriptors;
+	//bytes of the push constant block, 0 without one
+	uint32_t pushConstantSize = 0;
+	//vertex stage only, built-ins are left out
+	std::vector<ReflectedVertexInput> vertexInputs;
+};
+
+//minimal spir-v parser, only what the pipeline layouts need
+namespace ShaderReflection
+{
+	//resources declared but not statically used by any function are left out, so an include like common.glsl
+	//does not add the camera to every shader that has it
+	ShaderReflectionData Reflect(const std::vector<uint32_t>& code);
+}
@@ -1,5 +1,11 @@
 #include "VertexInfo.hpp"
 
+//standard library
+#include <cmath>
+
+//3rd party library
+#include <glm/common.hpp>
+
 VkVertexInputBindingDescription PosNormal::getBindingDescription()
 {
 	VkVertexInputBindingDescription result{};
@@ -33,6 +39,87 @@ bool PosNormal::operator==(const PosNormal& rhs) const
 	return ((position == rhs.position) && (normal == rhs.normal));
 }
 
+VkVertexInputBindingDescription PackedPosition::getBindingDescription()
+{
+	VkVertexInputBindingDescription result{};
+
+	result.binding = BINDING;
+	result.stride = sizeof(PackedPosition);
+	result.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return result;
+}
+
+VkVertexInputAttributeDescription PackedPosition::getAttributeDescription()
+{
+	VkVertexInputAttributeDescription result{};
+
+	result.binding = BINDING;
+	result.location = 0;
+	result.format = FORMAT;
+	result.offset = offsetof(PackedPosition, position);
+
+	return result;
+}
+
+PackedPosition PackedPosition::Pack(glm::vec3 position, glm::vec3 boundsmin, glm::vec3 boundsextent)
+{
+	PackedPosition result{};
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		//flat axis, every vertex decodes to boundsmin
+		float unorm = (boundsextent[axis] > 0.0f) ? (position[axis] - boundsmin[axis]) / boundsextent[axis] : 0.0f;
+		result.position[axis] = static_cast<uint16_t>(std::round(glm::clamp(unorm, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	return result;
+}
+
+VkVertexInputBindingDescription PackedNormal::getBindingDescription()
+{
+	VkVertexInputBindingDescription result{};
+
+	result.binding = BINDING;
+	result.stride = sizeof(PackedNormal);
+	result.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return result;
+}
+
+VkVertexInputAttributeDescription PackedNormal::getAttributeDescription()
+{
+	VkVertexInputAttributeDescription result{};
+
+	result.binding = BINDING;
+	result.location = 1;
+	result.format = FORMAT;
+	result.offset = offsetof(PackedNormal, normal);
+
+	return result;
+}
+
+PackedNormal PackedNormal::Pack(glm::vec3 normal)
+{
+	PackedNormal result{};
+
+	//onto the octahedron, the lower half folded over the diagonals
+	normal /= (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+	glm::vec2 octahedral = glm::vec2(normal.x, normal.y);
+	if (normal.z < 0.0f)
+	{
+		glm::vec2 sign = glm::vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+		octahedral = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * sign;
+	}
+
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		result.normal[axis] = static_cast<int16_t>(std::round(glm::clamp(octahedral[axis], -1.0f, 1.0f) * 32767.0f));
+	}
+
+	return result;
+}
+
 VkVertexInputBindingDescription PosColorTexVertex::getBindingDescription()
 {
 	VkVertexInputBindingDescription result{};
@@ -2,6 +2,7 @@
 
 //standard library
 #include <array>
+#include <cstdint>
 
 //3rd party library
 #include <glm/vec3.hpp>
@@ -22,6 +23,40 @@ struct PosNormal
 	bool operator==(const PosNormal& rhs) const;
 };
 
+//PosNormal in half the size, what every mesh drawn with the object programs is stored as
+//two streams, so the depth only passes fetch nothing but the positions
+//position is unorm16 in the mesh bounds, w unused so the format is one every device can fetch
+struct PackedPosition
+{
+	uint16_t position[4];
+
+	static constexpr uint32_t BINDING = 0;
+	static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_UNORM;
+
+	static VkVertexInputBindingDescription getBindingDescription();
+
+	static VkVertexInputAttributeDescription getAttributeDescription();
+
+	//boundsmin and boundsextent are pushed with the draw to decode it, DrawPushConstants::positionOffset/positionScale
+	static PackedPosition Pack(glm::vec3 position, glm::vec3 boundsmin, glm::vec3 boundsextent);
+};
+
+//octahedral snorm16, decoded in vertexformat.glsl
+struct PackedNormal
+{
+	int16_t normal[2];
+
+	//binding 1 is the instance offsets
+	static constexpr uint32_t BINDING = 2;
+	static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SNORM;
+
+	static VkVertexInputBindingDescription getBindingDescription();
+
+	static VkVertexInputAttributeDescription getAttributeDescription();
+
+	static PackedNormal Pack(glm::vec3 normal);
+};
+
 struct PosColorTexVertex
 {
 	glm::vec3 position;
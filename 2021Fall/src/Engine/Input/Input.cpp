@@ -19,7 +19,10 @@ void Input::init()
 	premousePos = { 0, 0 };
 	mouseMove = { 0, 0 };
 
+	//headless mode has no window to receive input from
 	GLFWwindow* windowptr = Application::APP()->GetWindowPointer();
+	if (windowptr == nullptr) return;
+
 	glfwSetKeyCallback(windowptr, keyCallback);
 	glfwSetMouseButtonCallback(windowptr, mouseCallback);
 	glfwSetCursorPosCallback(windowptr, mouseposCallback);
@@ -101,6 +104,18 @@ Point2D Input::GetMouseMove()
 	return mouseMove;
 }
 
+InputFrame Input::GetFrame()
+{
+	return InputFrame{ pressedKey, triggeredKey, mouseMove };
+}
+
+void Input::SetFrame(const InputFrame& frame)
+{
+	pressedKey = frame.pressedKey;
+	triggeredKey = frame.triggeredKey;
+	mouseMove = frame.mouseMove;
+}
+
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	if (action == GLFW_PRESS)
@@ -28,6 +28,14 @@ struct Point2D
 	float y;
 };
 
+//everything a frame of input consists of, used to record and replay input
+struct InputFrame
+{
+	std::bitset<GLFW_KEY_LAST + GLFW_MOUSE_BUTTON_LAST> pressedKey;
+	std::bitset<GLFW_KEY_LAST + GLFW_MOUSE_BUTTON_LAST> triggeredKey;
+	Point2D mouseMove;
+};
+
 class Input : public System
 {
 public:
@@ -55,6 +63,10 @@ public:
 	static Point2D GetMousePos();
 	static Point2D GetMouseMove();
 
+	static InputFrame GetFrame();
+	//overrides the input of this frame, call after Input::update
+	static void SetFrame(const InputFrame& frame);
+
 private:
 	static std::bitset<GLFW_KEY_LAST + GLFW_MOUSE_BUTTON_LAST> triggeredKey;
 	static std::bitset<GLFW_KEY_LAST + GLFW_MOUSE_BUTTON_LAST> pressedKey;
@@ -64,6 +76,6 @@ private:
 	static Point2D mouseMove;
 };
 
-static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
-static void mouseCallback(GLFWwindow* window, int button, int action, int mods);
-static void mouseposCallback(GLFWwindow* window, double xpos, double ypos);
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void mouseCallback(GLFWwindow* window, int button, int action, int mods);
+void mouseposCallback(GLFWwindow* window, double xpos, double ypos);
@@ -3,11 +3,25 @@
 #include "Engine/Entity/Camera.hpp"
 #include "Engine/Entity/Light.hpp"
 #include "Engine/Input/Input.hpp"
+#include "Engine/Misc/settings.hpp"
+
+//standard library
+#include <random>
+#include <cmath>
+
+//3rd party library
+#include <glm/gtc/constants.hpp>
 
 void Level::init()
 {
 	objManager = new ObjectManager(this);
 
+    if (Settings::benchmark)
+    {
+        initBenchmarkScene();
+        return;
+    }
+
     camera = objManager->addObjectByTemplate<Camera>();
     camera->GetTransform().SetPosition(glm::vec3(0.0f, 3.0f, -5.0f));
 
@@ -70,6 +84,63 @@ void Level::init()
     newobj->SetDrawBehavior(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_OBJ, PROGRAM_ID::PROGRAM_ID_BASERENDER, DRAWTARGET_INDEX::DRAWTARGET_MODEL, UniformBufferIndex::UNIFORM_OBJECT_MATRIX);
 }
 
+void Level::initBenchmarkScene()
+{
+    //every value comes from the seed so the same arguments always build the same scene
+    std::mt19937 random(Settings::benchmarkSeed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    DRAWTARGET_INDEX drawtarget = DRAWTARGET_INDEX::DRAWTARGET_CUBE;
+    if (Settings::benchmarkMesh == "model") drawtarget = DRAWTARGET_INDEX::DRAWTARGET_MODEL;
+    else if (Settings::benchmarkMesh == "instance") drawtarget = DRAWTARGET_INDEX::DRAWTARGET_MODEL_INSTANCE;
+
+    const float spacing = 4.0f;
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(Settings::benchmarkObjectCount))));
+    sceneExtent = std::max(side, 1u) * spacing * 0.5f;
+
+    camera = objManager->addObjectByTemplate<Camera>();
+    camera->GetTransform().SetPosition(glm::vec3(0.0f, 3.0f, -sceneExtent));
+
+    for (uint32_t i = 0; i < Settings::benchmarkLightCount; ++i)
+    {
+        float angle = glm::two_pi<float>() * i / Settings::benchmarkLightCount;
+        float height = 4.0f + 4.0f * unit(random);
+
+        PointLight* newlight = objManager->addObjectByTemplate<PointLight>();
+        newlight->setLightIndex(i, i + 1 == Settings::benchmarkLightCount);
+        newlight->GetTransform().SetPosition(glm::vec3(std::cos(angle) * sceneExtent * 0.6f, height, std::sin(angle) * sceneExtent * 0.6f));
+        newlight->GetTransform().SetScale(glm::vec3(0.2f));
+        newlight->SetDrawBehavior(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_LIGHT_OBJ, PROGRAM_ID::PROGRAM_ID_DIFFUSE, DRAWTARGET_INDEX::DRAWTARGET_CUBE, UniformBufferIndex::UNIFORM_LIGHT_OBJECT_MATRIX);
+    }
+
+    Object* newobj = objManager->addObject();
+    newobj->GetTransform().SetScale(glm::vec3(sceneExtent + spacing, 0.1f, sceneExtent + spacing));
+    newobj->GetTransform().SetPosition(glm::vec3(0.0f, -2.0f, 0.0f));
+    newobj->SetUniform(ObjectUniform{ glm::mat4(1.0f), glm::vec3(0.659777f, 0.608679f, 0.525649f), 1.0f, 1.0f });
+    newobj->SetDrawBehavior(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_OBJ, PROGRAM_ID::PROGRAM_ID_BASERENDER, DRAWTARGET_INDEX::DRAWTARGET_CUBE, UniformBufferIndex::UNIFORM_OBJECT_MATRIX);
+
+    for (uint32_t i = 0; i < Settings::benchmarkObjectCount; ++i)
+    {
+        float x = (i % side + 0.5f) * spacing - sceneExtent + (unit(random) - 0.5f) * spacing * 0.25f;
+        float z = (i / side + 0.5f) * spacing - sceneExtent + (unit(random) - 0.5f) * spacing * 0.25f;
+        float scale = 0.5f + unit(random);
+        float yaw = glm::two_pi<float>() * unit(random);
+
+        newobj = objManager->addObject();
+        newobj->GetTransform().SetScale(glm::vec3(scale));
+        newobj->GetTransform().SetPosition(glm::vec3(x, 0.0f, z));
+        newobj->GetTransform().SetRotation(glm::vec3(0.0f, yaw, 0.0f));
+        //draw into locals, the evaluation order of constructor arguments is unspecified
+        float r = unit(random);
+        float g = unit(random);
+        float b = unit(random);
+        float metal = unit(random);
+        float roughness = 0.1f + 0.9f * unit(random);
+        newobj->SetUniform(ObjectUniform{ glm::mat4(1.0f), glm::vec3(r, g, b), metal, roughness });
+        newobj->SetDrawBehavior(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_OBJ, PROGRAM_ID::PROGRAM_ID_BASERENDER, drawtarget, UniformBufferIndex::UNIFORM_OBJECT_MATRIX);
+    }
+}
+
 void Level::postinit()
 {
     objManager->postinit();
@@ -77,6 +148,16 @@ void Level::postinit()
 
 void Level::update(float dt)
 {
+    //mouse move is accumulated per frame, applying it in every fixed step would repeat it
+    if (Input::isPressed(KeyBinding::MOUSE_RIGHT)) camera->LookAround(Input::GetMouseMove().x * dt, Input::GetMouseMove().y * dt);
+
+	objManager->update(dt);
+}
+
+void Level::fixedupdate(float dt)
+{
+	objManager->fixedupdate(dt);
+
     float cam_speed = 5.0f;
 
     if (Input::isPressed(KeyBinding::KEY_SHIFT)) cam_speed = 30.0f;
@@ -84,9 +165,6 @@ void Level::update(float dt)
     if (Input::isPressed(KeyBinding::KEY_DOWN)) camera->Move(-cam_speed * dt, 0.0f);
     if (Input::isPressed(KeyBinding::KEY_RIGHT)) camera->Move(0.0f, cam_speed * dt);
     if (Input::isPressed(KeyBinding::KEY_LEFT)) camera->Move(0.0f, -cam_speed * dt);
-    if (Input::isPressed(KeyBinding::MOUSE_RIGHT)) camera->LookAround(Input::GetMouseMove().x * dt, Input::GetMouseMove().y * dt);
-
-	objManager->update(dt);
 }
 
 void Level::close()
@@ -99,3 +177,13 @@ ObjectManager* Level::GetObjectManager() const
 {
     return objManager;
 }
+
+Camera* Level::GetCamera() const
+{
+    return camera;
+}
+
+float Level::GetSceneExtent() const
+{
+    return sceneExtent;
+}
@@ -13,12 +13,22 @@ public:
 	void postinit() override;
 
 	void update(float dt) override;
+	//simulation step, overrides call Level::fixedupdate first so objects keep interpolating
+	virtual void fixedupdate(float dt);
 	void close() override;
 
 	ObjectManager* GetObjectManager() const;
+	Camera* GetCamera() const;
+	//half size of the generated benchmark grid
+	float GetSceneExtent() const;
 
 private:
+	//grid of Settings::benchmarkObjectCount meshes lit by Settings::benchmarkLightCount lights
+	void initBenchmarkScene();
+
 	ObjectManager* objManager = nullptr;
 
 	Camera* camera = nullptr;
+
+	float sceneExtent = 30.0f;
 };
\ No newline at end of file
@@ -30,6 +30,11 @@ void LevelManager::update(float dt)
 	currentLevel->update(dt);
 }
 
+void LevelManager::fixedupdate(float dt)
+{
+	currentLevel->fixedupdate(dt);
+}
+
 void LevelManager::close()
 {
 	for (auto& level : levelList)
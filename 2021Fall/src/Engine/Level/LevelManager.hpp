@@ -17,6 +17,7 @@ public:
 	virtual void postinit() override;
 
 	virtual void update(float dt) override;
+	virtual void fixedupdate(float dt) override;
 	virtual void close() override;
 	virtual void drawGUI() override;
 
@@ -3,6 +3,8 @@
 #include "Engine/Graphic/Graphic.hpp"
 #include "Engine/Entity/Light.hpp"
 #include "Engine/Entity/Camera.hpp"
+#include "Engine/Misc/settings.hpp"
+#include "Engine/Common/MatrixBatch.hpp"
 
 ObjectManager::ObjectManager(Level* level) : ownerLevel(level)
 {
@@ -16,32 +18,61 @@ void ObjectManager::postinit()
 {
 	Graphic* graphic = Application::APP()->GetSystem<Graphic>();
 
-	graphic->BeginCmdBuffer(CMD_INDEX::CMD_BASE);
-	graphic->BeginRenderPass(CMD_INDEX::CMD_BASE, RENDERPASS_INDEX::RENDERPASS_PRE);
-
-	for (auto obj : objectList)
+	if (Settings::mergedDeferred)
 	{
-		obj->postinit();
+		//gbuffer and lighting are one renderpass, objects are recorded into every swapchain image's command buffer
+		for (uint32_t i = 0; i < graphic->GetSwapchainImageCount(); ++i)
+		{
+			CMD_INDEX cmdindex = static_cast<CMD_INDEX>(CMD_INDEX::CMD_POST + i);
+
+			graphic->BeginCmdBuffer(cmdindex);
+			graphic->BeginRenderPass(cmdindex, RENDERPASS_INDEX::RENDERPASS_MERGED, i);
+
+			graphic->ResetDescriptorIndices();
+			for (auto obj : objectList)
+			{
+				obj->postinit();
+			}
+
+			graphic->RecordDeferredLighting(cmdindex);
+
+			graphic->EndRenderPass(cmdindex);
+			graphic->EndCmdBuffer(cmdindex);
+		}
 	}
+	else
+	{
+		graphic->BeginCmdBuffer(CMD_INDEX::CMD_BASE);
+		graphic->BeginRenderPass(CMD_INDEX::CMD_BASE, RENDERPASS_INDEX::RENDERPASS_PRE);
 
-	graphic->EndRenderPass(CMD_INDEX::CMD_BASE);
-	graphic->EndCmdBuffer(CMD_INDEX::CMD_BASE);
+		for (auto obj : objectList)
+		{
+			obj->postinit();
+		}
+
+		graphic->EndRenderPass(CMD_INDEX::CMD_BASE);
+		graphic->EndCmdBuffer(CMD_INDEX::CMD_BASE);
+	}
 
 	graphic->BeginCmdBuffer(CMD_INDEX::CMD_SHADOW);
+	//one set for every light, only the pushed light index changes between the passes
+	graphic->SetPassDescriptorSet(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMAP);
 	for (uint32_t i = 0; i < MAX_LIGHT; ++i)
 	{
 		graphic->BeginRenderPass(CMD_INDEX::CMD_SHADOW, RENDERPASS_INDEX::RENDERPASS_DEPTHCUBEMAP, i);
+		graphic->SetDrawLight(i);
 
 		uint32_t index = 0;
 		for (auto obj : objectList)
 		{
 			if (dynamic_cast<Light*>(obj) != nullptr) continue;
 			if (dynamic_cast<Camera*>(obj) != nullptr) continue;
-			graphic->RegisterObject(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_SHADOWMAP, PROGRAM_ID::PROGRAM_ID_SHADOWMAP, obj->drawtargetIndex, { index++, i });
+			graphic->RegisterObject(DESCRIPTORSET_INDEX::DESCRIPTORSET_ID_OBJ, PROGRAM_ID::PROGRAM_ID_SHADOWMAP, obj->drawtargetIndex, index++, &obj->uniform.objectMat);
 		}
 
 		graphic->EndRenderPass(CMD_INDEX::CMD_SHADOW);
 	}
+	if (Settings::shadowMoments) graphic->RecordShadowMoments(CMD_INDEX::CMD_SHADOW);
 	graphic->EndCmdBuffer(CMD_INDEX::CMD_SHADOW);
 }
 
@@ -51,6 +82,27 @@ void ObjectManager::update(float dt)
 	{
 		obj->update(dt);
 	}
+
+	//only moved objects, all in one pass before Graphic copies the uniforms
+	dirtyModels.clear();
+	dirtyNormals.clear();
+	for (auto obj : objectList)
+	{
+		if (!obj->normalMatDirty) continue;
+
+		dirtyModels.push_back(&obj->uniform.objectMat);
+		dirtyNormals.push_back(&obj->uniform.normalMat);
+		obj->normalMatDirty = false;
+	}
+	MatrixBatch::NormalMatrices(dirtyModels.data(), dirtyNormals.data(), dirtyModels.size());
+}
+
+void ObjectManager::fixedupdate(float dt)
+{
+	for (auto& obj : objectList)
+	{
+		obj->fixedupdate(dt);
+	}
 }
 
 void ObjectManager::close()
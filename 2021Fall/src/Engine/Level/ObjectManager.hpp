@@ -18,6 +18,7 @@ public:
 	virtual void postinit() override;
 
 	virtual void update(float dt) override;
+	virtual void fixedupdate(float dt);
 	virtual void close() override;
 
 	Object* addObject(std::string name);
@@ -81,6 +82,10 @@ private:
 	std::vector<Object*> objectList;
 	std::vector<Light*> lightList;
 
+	//objects whose normal matrix is computed this frame, kept to reuse the storage
+	std::vector<const glm::mat4*> dirtyModels;
+	std::vector<glm::mat4*> dirtyNormals;
+
 	unsigned int currentIndex;
 
 	Level* ownerLevel = nullptr;
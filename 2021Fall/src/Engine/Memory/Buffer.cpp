@@ -7,6 +7,7 @@
 #include <cstring>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
 
 VkDevice VulkanMemoryManager::vulkanDevice = VK_NULL_HANDLE;
 VkPhysicalDevice VulkanMemoryManager::vulkanPhysicalDevice = VK_NULL_HANDLE;
@@ -134,6 +135,52 @@ uint32_t VulkanMemoryManager::CreateUniformBuffer(UniformBufferIndex index, size
     return bufferIndex++;
 }
 
+uint32_t VulkanMemoryManager::CreateStorageBuffer(UniformBufferIndex index, size_t memorysize, uint32_t num)
+{
+    VkBuffer buffer;
+    VkDeviceMemory buffermemory;
+
+    VkDeviceSize totalSize = memorysize * num;
+
+    createBuffer(totalSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, buffermemory);
+
+    Buffer* buf = new Buffer();
+
+    buf->memory = buffermemory;
+    buf->buffer = buffer;
+    buf->size = totalSize;
+    buf->type = BUFFERTYPE::BUFFER_STORAGE;
+    buf->offset = memorysize;
+
+    buffers.push_back(buf);
+
+    uniformIndices[index] = bufferIndex;
+
+    return bufferIndex++;
+}
+
+uint32_t VulkanMemoryManager::CreateIndirectBuffer(size_t memorysize)
+{
+    VkBuffer buffer;
+    VkDeviceMemory buffermemory;
+
+    createBuffer(memorysize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, buffermemory);
+
+    Buffer* buf = new Buffer();
+
+    buf->memory = buffermemory;
+    buf->buffer = buffer;
+    buf->size = memorysize;
+    buf->type = BUFFERTYPE::BUFFER_INDIRECT;
+    buf->offset = memorysize;
+
+    buffers.push_back(buf);
+
+    return bufferIndex++;
+}
+
 void VulkanMemoryManager::GetSwapChainImage(VkSwapchainKHR swapchain, uint32_t& imagecount, std::vector<Image*>& images, const VkFormat& format)
 {
     std::vector<VkImage> swapchainimages;
@@ -149,6 +196,7 @@ void VulkanMemoryManager::GetSwapChainImage(VkSwapchainKHR swapchain, uint32_t&
         image->format = format;
         image->image = swapchainimages[i];
         image->imageview = VulkanMemoryManager::createImageView(swapchainimages[i], format, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+        image->usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
         images.push_back(image);
     }
@@ -165,6 +213,7 @@ Image* VulkanMemoryManager::CreateFrameBufferImage(VkImageUsageFlags usage, VkFo
     image->imageview = VulkanMemoryManager::createImageView(image->image, format, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
     image->format = format;
+    image->usage = usage;
 
     return image;
 }
@@ -182,26 +231,106 @@ Image* VulkanMemoryManager::CreateDepthBuffer(VkFormat format, VkSampleCountFlag
         VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, 1);
 
     image->format = format;
+    image->usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 
     return image;
 }
 
-Image* VulkanMemoryManager::CreateShadowMapBuffer()
+Image* VulkanMemoryManager::CreateStencilBuffer(VkFormat format)
 {
-    const uint32_t depthsize = Settings::shadowmapSize;
-    const VkFormat depthFormat = VK_FORMAT_D16_UNORM;
+    Image* image = new Image(Settings::windowWidth, Settings::windowHeight, ImageType::FRAMEBUFFER);
+
+    VulkanMemoryManager::createImage(Settings::windowWidth, Settings::windowHeight, 1, 1, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, image->image, image->memory);
+
+    image->imageview = VulkanMemoryManager::createImageView(image->image, format, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 1);
+
+    VulkanMemoryManager::transitionImageLayout(image->image, format, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, 1);
+
+    image->format = format;
+    image->usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 
+    return image;
+}
+
+Image* VulkanMemoryManager::CreateHistoryImage(VkFormat format)
+{
+    Image* image = new Image(Settings::windowWidth, Settings::windowHeight, ImageType::FRAMEBUFFER);
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    VulkanMemoryManager::createImage(Settings::windowWidth, Settings::windowHeight, 1, 1, VK_SAMPLE_COUNT_1_BIT, format,
+        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, image->image, image->memory);
+
+    image->imageview = VulkanMemoryManager::createImageView(image->image, format, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+    VulkanMemoryManager::transitionImageLayout(image->image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, 1);
+    VulkanMemoryManager::transitionImageLayout(image->image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, 1);
+
+    image->format = format;
+    image->usage = usage;
+
+    return image;
+}
+
+Image* VulkanMemoryManager::CreateShadowMapBuffer(VkFormat depthFormat, uint32_t depthsize)
+{
     Image* image = new Image(depthsize, depthsize, ImageType::FRAMEBUFFER);
 
     VulkanMemoryManager::createImage(depthsize, depthsize, 6, 1, VK_SAMPLE_COUNT_1_BIT, depthFormat, VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, image->image, image->memory);
 
     image->imageview = VulkanMemoryManager::createImageView(image->image, depthFormat, 6, VK_IMAGE_VIEW_TYPE_CUBE, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+    //faces are read texel by texel when the moments are built
+    image->arrayview = VulkanMemoryManager::createImageView(image->image, depthFormat, 6, VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 
-    VulkanMemoryManager::transitionImageLayout(image->image, VK_FORMAT_D16_UNORM, VK_IMAGE_LAYOUT_UNDEFINED,
+    VulkanMemoryManager::transitionImageLayout(image->image, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 6, 1);
 
     image->format = depthFormat;
+    image->usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    return image;
+}
+
+Image* VulkanMemoryManager::CreateShadowMomentImage(VkFormat format, uint32_t size)
+{
+    Image* image = new Image(size, size, ImageType::FRAMEBUFFER);
+
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(size))) + 1;
+    //mip 0 is written by compute, the rest is blitted from it
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    VulkanMemoryManager::createImage(size, size, 6, mipLevels, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
+        usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, image->image, image->memory);
+
+    image->imageview = VulkanMemoryManager::createImageView(image->image, format, 6, VK_IMAGE_VIEW_TYPE_CUBE, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    image->arrayview = VulkanMemoryManager::createImageView(image->image, format, 6, VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+    VulkanMemoryManager::transitionImageLayout(image->image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 6, mipLevels);
+    VulkanMemoryManager::transitionImageLayout(image->image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 6, mipLevels);
+
+    image->format = format;
+    image->usage = usage;
+    image->mipLevels = mipLevels;
+
+    return image;
+}
+
+Image* VulkanMemoryManager::CreateStorageImage(VkFormat format, uint32_t width, uint32_t height, uint32_t layer)
+{
+    Image* image = new Image(width, height, ImageType::FRAMEBUFFER);
+
+    VulkanMemoryManager::createImage(width, height, layer, 1, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, image->image, image->memory);
+
+    image->imageview = VulkanMemoryManager::createImageView(image->image, format, layer, VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+    VulkanMemoryManager::transitionImageLayout(image->image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, layer, 1);
+
+    image->format = format;
+    image->usage = VK_IMAGE_USAGE_STORAGE_BIT;
 
     return image;
 }
@@ -213,7 +342,7 @@ Image* VulkanMemoryManager::CreateTextureImage(int width, int height, unsigned c
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
 
-    uint32_t textureMipLevels = static_cast<uint32_t>(std::floor(std::log2(max(width, height)))) + 1;
+    uint32_t textureMipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
     VkDeviceSize imageSize = width * height * 4;
     VulkanMemoryManager::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
@@ -234,6 +363,8 @@ Image* VulkanMemoryManager::CreateTextureImage(int width, int height, unsigned c
     VulkanMemoryManager::generateMipmaps(image->image, VK_FORMAT_R8G8B8A8_SRGB, width, height, textureMipLevels);
 
     image->imageview = VulkanMemoryManager::createImageView(image->image, VK_FORMAT_R8G8B8A8_SRGB, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, textureMipLevels);
+    image->format = VK_FORMAT_R8G8B8A8_SRGB;
+    image->usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
     return image;
 }
@@ -260,6 +391,70 @@ Buffer* VulkanMemoryManager::GetUniformBuffer(UniformBufferIndex index)
     return buffers[innerindex];
 }
 
+Image* VulkanMemoryManager::CreateOffscreenImage(VkFormat format)
+{
+    Image* image = new Image(Settings::windowWidth, Settings::windowHeight, ImageType::FRAMEBUFFER);
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    VulkanMemoryManager::createImage(Settings::windowWidth, Settings::windowHeight, 1, 1, VK_SAMPLE_COUNT_1_BIT, format,
+        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, image->image, image->memory);
+
+    image->imageview = VulkanMemoryManager::createImageView(image->image, format, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+    image->format = format;
+    image->usage = usage;
+
+    return image;
+}
+
+void VulkanMemoryManager::ReadImage(const Image* image, std::vector<uint8_t>& pixels)
+{
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(image->size.width) * image->size.height * 4;
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+    //renderpass writes were made in an earlier submission
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image->image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { image->size.width, image->size.height, 1 };
+
+    vkCmdCopyImageToBuffer(commandBuffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+
+    endSingleTimeCommands(commandBuffer);
+
+    pixels.resize(static_cast<size_t>(imageSize));
+
+    void* data;
+    vkMapMemory(vulkanDevice, stagingBufferMemory, 0, imageSize, 0, &data);
+    memcpy(pixels.data(), data, static_cast<size_t>(imageSize));
+    vkUnmapMemory(vulkanDevice, stagingBufferMemory);
+
+    FreeBuffer(stagingBuffer, stagingBufferMemory);
+}
+
 void VulkanMemoryManager::Init(VkDevice device)
 {
     vulkanDevice = device;
@@ -460,6 +655,14 @@ void VulkanMemoryManager::transitionImageLayout(VkImage image, VkFormat format,
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
+    else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+    {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    }
     else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
     {
         barrier.srcAccessMask = 0;
@@ -641,6 +844,15 @@ void VulkanMemoryManager::MapMemory(uint32_t index, void* data, size_t size, uin
     vkUnmapMemory(vulkanDevice, memory);
 }
 
+void VulkanMemoryManager::MapBufferMemory(uint32_t bufferindex, const void* data, size_t size, size_t offset)
+{
+    void* temp;
+    VkDeviceMemory memory = GetBuffer(bufferindex)->GetMemory();
+    vkMapMemory(vulkanDevice, memory, offset, size, 0, &temp);
+    memcpy(temp, data, size);
+    vkUnmapMemory(vulkanDevice, memory);
+}
+
 Buffer::Buffer() {}
 
 VkDescriptorBufferInfo Buffer::GetDescriptorInfo() const
@@ -653,3 +865,14 @@ VkDescriptorBufferInfo Buffer::GetDescriptorInfo() const
 
     return result;
 }
+
+VkDescriptorBufferInfo Buffer::GetArrayDescriptorInfo() const
+{
+    VkDescriptorBufferInfo result;
+
+    result.buffer = buffer;
+    result.offset = 0;
+    result.range = size;
+
+    return result;
+}
@@ -11,6 +11,9 @@ enum BUFFERTYPE
 	BUFFER_VERTEX,
 	BUFFER_INDEX,
 	BUFFER_UNIFORM,
+	BUFFER_STORAGE,
+	//draw arguments and per draw vertex data the cpu rewrites every frame
+	BUFFER_INDIRECT,
 	BUFFER_MAX,
 };
 
@@ -37,12 +40,29 @@ public:
 	static uint32_t CreateVertexBuffer(void* memory, size_t memorysize);
 	static uint32_t CreateIndexBuffer(void* memory, size_t memorysize);
 	static uint32_t CreateUniformBuffer(UniformBufferIndex index, size_t memorysize, uint32_t num = 1);
+	//host visible like the uniform buffers, for arrays indexed in the shader that may outgrow maxUniformBufferRange
+	static uint32_t CreateStorageBuffer(UniformBufferIndex index, size_t memorysize, uint32_t num = 1);
+	//host visible, usable as indirect argument and vertex buffer, written with MapBufferMemory
+	static uint32_t CreateIndirectBuffer(size_t memorysize);
 	
 	static void GetSwapChainImage(VkSwapchainKHR swapchain, uint32_t& imagecount, std::vector<Image*>& images, const VkFormat& format);
 	static Image* CreateFrameBufferImage(VkImageUsageFlags usage, VkFormat format, VkSampleCountFlagBits sample);
 	static Image* CreateDepthBuffer(VkFormat format, VkSampleCountFlagBits sample);
-	static Image* CreateShadowMapBuffer();
+	//single sample depth/stencil where only the stencil is used, e.g. masking pixels of a fullscreen pass
+	static Image* CreateStencilBuffer(VkFormat format);
+	//sampled copy destination, left in SHADER_READ_ONLY_OPTIMAL so it can be read before the first copy
+	static Image* CreateHistoryImage(VkFormat format);
+	static Image* CreateShadowMapBuffer(VkFormat format, uint32_t size);
+	//mipmapped cube written per layer by compute, left in SHADER_READ_ONLY_OPTIMAL
+	static Image* CreateShadowMomentImage(VkFormat format, uint32_t size);
+	//2d array only accessed as storage image, left in GENERAL
+	static Image* CreateStorageImage(VkFormat format, uint32_t width, uint32_t height, uint32_t layer);
 	static Image* CreateTextureImage(int width, int height, unsigned char* pixels);
+	//render target standing in for a swapchain image in headless mode
+	static Image* CreateOffscreenImage(VkFormat format);
+
+	//copy a 4 byte per pixel image in TRANSFER_SRC_OPTIMAL layout back to the cpu, waits for the queue
+	static void ReadImage(const Image* image, std::vector<uint8_t>& pixels);
 
 	static Buffer* GetBuffer(uint32_t index);
 	static Buffer* GetUniformBuffer(UniformBufferIndex index);
@@ -82,6 +102,8 @@ public:
 	static void MapMemory(VkDeviceMemory devicememory, size_t size, void* data);
 
 	static void MapMemory(uint32_t index, void* data, size_t size = 0, uint32_t offset = 0);
+	//index returned by the Create functions instead of a uniform index
+	static void MapBufferMemory(uint32_t bufferindex, const void* data, size_t size, size_t offset = 0);
 };
 
 class Buffer
@@ -94,7 +116,10 @@ public:
 	VkBuffer GetBuffer() const;
 	VkDeviceMemory GetMemory() const;
 
+	//one element, the stride of a dynamic uniform
 	VkDescriptorBufferInfo GetDescriptorInfo() const;
+	//every element, for arrays the shader indexes itself
+	VkDescriptorBufferInfo GetArrayDescriptorInfo() const;
 
 private:
 	Buffer();
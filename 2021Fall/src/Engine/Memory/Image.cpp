@@ -2,6 +2,8 @@
 
 void Image::close()
 {
+	if (arrayview != VK_NULL_HANDLE) VulkanMemoryManager::FreeImage(VK_NULL_HANDLE, arrayview, VK_NULL_HANDLE);
+
 	if (type == ImageType::SWAPCHAIN)
 	{
 		VulkanMemoryManager::FreeImage(nullptr, imageview, memory);
@@ -12,16 +14,41 @@ void Image::close()
 	}
 }
 
+VkImage Image::GetImage() const
+{
+	return image;
+}
+
 VkImageView Image::GetImageView() const
 {
 	return imageview;
 }
 
+VkImageView Image::GetArrayView() const
+{
+	return arrayview;
+}
+
 VkFormat Image::GetFormat() const
 {
 	return format;
 }
 
+VkImageUsageFlags Image::GetUsage() const
+{
+	return usage;
+}
+
+VkExtent2D Image::GetExtent() const
+{
+	return size;
+}
+
+uint32_t Image::GetMipLevels() const
+{
+	return mipLevels;
+}
+
 Image::Image(uint32_t width, uint32_t height, ImageType t)
 {
 	size.width = width;
@@ -21,8 +21,14 @@ public:
 	friend class VulkanMemoryManager;
 
 public:
+	VkImage GetImage() const;
 	VkImageView GetImageView() const;
+	//mip 0 of every layer as 2d array, only for cube images that are also read or written per layer
+	VkImageView GetArrayView() const;
 	VkFormat GetFormat() const;
+	VkImageUsageFlags GetUsage() const;
+	VkExtent2D GetExtent() const;
+	uint32_t GetMipLevels() const;
 
 private:
 	Image(uint32_t width, uint32_t height, ImageType t);
@@ -31,10 +37,13 @@ private:
 	VkImage image;
 	VkDeviceMemory memory;
 	VkImageView imageview;
+	VkImageView arrayview = VK_NULL_HANDLE;
 
 	VkSampler sampler;
 	VkFormat format;
+	VkImageUsageFlags usage = 0;
 	VkExtent2D size;
+	uint32_t mipLevels = 1;
 
 	ImageType type;
 };
\ No newline at end of file
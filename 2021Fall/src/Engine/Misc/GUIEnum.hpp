@@ -8,6 +8,8 @@ namespace GUI_ENUM
 		DEFERRED_NORMAL = 1,
 		DEFERRED_ALBEDO = 2,
 		DEFERRED_LIGHT = 3,
+		//lit, pixels shaded per sample in red
+		DEFERRED_EDGE = 4,
 	};
 
 	enum LIGHT_COMPUTATION_TYPE
@@ -16,4 +18,20 @@ namespace GUI_ENUM
 		LIGHT_COMPUTE_BASIC,
 		LIGHT_COMPUTE_MAX,
 	};
+
+	enum SHADOW_FILTER_TYPE
+	{
+		//20 fixed taps compared in the shader
+		SHADOW_FILTER_MANUAL = 0,
+		//rotated poisson taps through a compare sampler
+		SHADOW_FILTER_COMPARE = 1,
+		//one filtered lookup of the blurred moments, needs Settings::shadowMoments
+		SHADOW_FILTER_MOMENTS = 2,
+	};
+
+	enum SHADOW_MOMENT_TYPE
+	{
+		SHADOW_MOMENT_VSM = 0,
+		SHADOW_MOMENT_EVSM = 1,
+	};
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "PNGWriter.hpp"
+
+//standard library
+#include <vector>
+#include <array>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+namespace
+{
+	//largest payload of a stored deflate block
+	constexpr uint32_t DEFLATE_STORED_MAX = 65535;
+
+	const std::array<uint32_t, 256>& CRCTable()
+	{
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> result{};
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (uint32_t k = 0; k < 8; ++k)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				result[n] = c;
+			}
+			return result;
+		}();
+
+		return table;
+	}
+
+	uint32_t CRC32(const uint8_t* data, size_t size, uint32_t crc = 0xFFFFFFFFu)
+	{
+		const auto& table = CRCTable();
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	void PushBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	void WriteChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> chunk;
+		PushBigEndian(chunk, static_cast<uint32_t>(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+
+		//crc covers type and data, not the length
+		uint32_t crc = CRC32(chunk.data() + 4, chunk.size() - 4) ^ 0xFFFFFFFFu;
+		PushBigEndian(chunk, crc);
+
+		file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+	}
+}
+
+bool PNGWriter::WriteRGBA8(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels)
+{
+	//every scanline starts with filter type 0 (none)
+	size_t rowSize = static_cast<size_t>(width) * 4;
+	std::vector<uint8_t> raw;
+	raw.reserve((rowSize + 1) * height);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+	}
+
+	//zlib stream made of stored deflate blocks
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	size_t offset = 0;
+	do
+	{
+		uint32_t blockSize = static_cast<uint32_t>(std::min<size_t>(DEFLATE_STORED_MAX, raw.size() - offset));
+		bool last = (offset + blockSize == raw.size());
+
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back(static_cast<uint8_t>(blockSize & 0xFF));
+		zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+		zlib.push_back(static_cast<uint8_t>(~blockSize & 0xFF));
+		zlib.push_back(static_cast<uint8_t>((~blockSize >> 8) & 0xFF));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+		offset += blockSize;
+	} while (offset < raw.size());
+
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+	for (uint8_t byte : raw)
+	{
+		adlerA = (adlerA + byte) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	PushBigEndian(zlib, (adlerB << 16) | adlerA);
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<uint8_t> header;
+	PushBigEndian(header, width);
+	PushBigEndian(header, height);
+	header.push_back(8); //bit depth
+	header.push_back(6); //color type rgba
+	header.push_back(0); //compression
+	header.push_back(0); //filter
+	header.push_back(0); //interlace
+	WriteChunk(file, "IHDR", header);
+
+	WriteChunk(file, "IDAT", zlib);
+	WriteChunk(file, "IEND", {});
+
+	return file.good();
+}
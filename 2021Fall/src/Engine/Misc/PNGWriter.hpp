@@ -0,0 +1,12 @@
+#pragma once
+
+//standard library
+#include <string>
+#include <cstdint>
+
+//minimal png encoder (8 bit rgba, uncompressed deflate blocks), enough for frame captures
+namespace PNGWriter
+{
+	//pixels are tightly packed rows of rgba, top row first
+	bool WriteRGBA8(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels);
+}
@@ -0,0 +1,59 @@
+#include "ThreadPool.hpp"
+
+//standard library
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadnum)
+{
+	if (threadnum == 0)
+	{
+		uint32_t hardwarethread = std::thread::hardware_concurrency();
+		threadnum = std::max(hardwarethread, 2u) - 1;
+	}
+
+	workers.reserve(threadnum);
+	for (uint32_t i = 0; i < threadnum; ++i)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stop = true;
+	}
+	condition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::GetThreadNum() const
+{
+	return static_cast<uint32_t>(workers.size());
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			condition.wait(lock, [this]() { return stop || !jobs.empty(); });
+
+			//finish queued jobs before leaving so no future is left unsatisfied
+			if (stop && jobs.empty()) return;
+
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+
+		job();
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+//standard library
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+//fixed number of worker threads consuming a shared job queue
+class ThreadPool
+{
+public:
+	//0 -> one worker per hardware thread except the main thread
+	ThreadPool(uint32_t threadnum = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template <class F>
+	auto Submit(F&& job) -> std::future<decltype(job())>
+	{
+		using ResultType = decltype(job());
+
+		auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(job));
+		std::future<ResultType> result = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			jobs.emplace([task]() { (*task)(); });
+		}
+		condition.notify_one();
+
+		return result;
+	}
+
+	uint32_t GetThreadNum() const;
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+
+	std::mutex queueMutex;
+	std::condition_variable condition;
+	bool stop = false;
+};
@@ -3,7 +3,6 @@
 //standard library
 #include <vector>
 #include <fstream>
-#include <chrono>
 
 namespace Helper
 {
@@ -27,19 +26,4 @@ namespace Helper
 
 		return buffer;
 	}
-
-	//return millisecond, true->reset timer
-	static float GetDeltaTime(bool timestamp = false)
-	{
-		static auto prev = std::chrono::high_resolution_clock::now();
-		static auto current = std::chrono::high_resolution_clock::now();
-
-		current = std::chrono::high_resolution_clock::now();
-		
-		float result = (float)(std::chrono::duration<double, std::milli>(current - prev).count());
-
-		if(timestamp) prev = current;
-
-		return result;
-	}
 }
\ No newline at end of file
@@ -1,11 +1,209 @@
 #include "settings.hpp"
 
+//standard library
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
 unsigned int Settings::windowWidth = 1280;
 unsigned int Settings::windowHeight = 720;
 
 unsigned int Settings::shadowmapSize = 1024;
+bool Settings::shadowHardwareCompare = true;
+unsigned int Settings::shadowTaps = 12;
+bool Settings::shadowMoments = false;
+unsigned int Settings::shadowMomentSize = 256;
+
+unsigned int Settings::msaaSamples = 4;
+bool Settings::msaaEdgeLighting = true;
+bool Settings::temporalAA = false;
+
+bool Settings::mergedDeferred = false;
+
+bool Settings::shaderVariants = true;
+
+unsigned int Settings::targetFrameRate = 0;
+unsigned int Settings::idleFrameRate = 10;
+bool Settings::idleWhenUnfocused = true;
+unsigned int Settings::fixedUpdateRate = 60;
+float Settings::fixedFrameDelta = 0.0f;
+
+unsigned int Settings::maxObjectCount = 20;
+unsigned int Settings::modelInstanceCount = 1;
+float Settings::lodPixelError = 1.0f;
+
+bool Settings::headless = false;
+unsigned int Settings::headlessFrameCount = 300;
+unsigned int Settings::offscreenImageCount = 3;
+std::vector<unsigned int> Settings::dumpFrames;
+std::string Settings::dumpDirectory = "data/capture/";
+
+bool Settings::benchmark = false;
+unsigned int Settings::benchmarkObjectCount = 64;
+unsigned int Settings::benchmarkLightCount = 4;
+std::string Settings::benchmarkMesh = "cube";
+unsigned int Settings::benchmarkSeed = 1;
+unsigned int Settings::benchmarkWarmupFrames = 60;
+unsigned int Settings::benchmarkFrameCount = 600;
+std::string Settings::benchmarkCameraPath;
+std::string Settings::benchmarkOutput = "data/benchmark/result.json";
+
+std::string Settings::recordInputFile;
+std::string Settings::replayInputFile;
 
 float Settings::GetAspectRatio()
 {
     return static_cast<float>(windowWidth) / static_cast<float>(windowHeight);
 }
+
+bool Settings::ParseCommandLine(int argc, char** argv)
+{
+    auto readNumber = [&](int& index, unsigned int& value) -> bool
+    {
+        if (index + 1 >= argc) return false;
+
+        try
+        {
+            value = static_cast<unsigned int>(std::stoul(argv[++index]));
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+
+        return true;
+    };
+
+    auto readFloat = [&](int& index, float& value) -> bool
+    {
+        if (index + 1 >= argc) return false;
+
+        try
+        {
+            value = std::stof(argv[++index]);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+
+        return true;
+    };
+
+    auto readString = [&](int& index, std::string& value) -> bool
+    {
+        if (index + 1 >= argc) return false;
+
+        value = argv[++index];
+
+        return true;
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool valid = true;
+
+        if (arg == "--headless") headless = true;
+        else if (arg == "--frames") valid = readNumber(i, headlessFrameCount);
+        else if (arg == "--width") valid = readNumber(i, windowWidth);
+        else if (arg == "--height") valid = readNumber(i, windowHeight);
+        else if (arg == "--offscreen-images") valid = readNumber(i, offscreenImageCount) && offscreenImageCount > 0;
+        else if (arg == "--dump-dir" && i + 1 < argc) dumpDirectory = std::string(argv[++i]) + "/";
+        else if (arg == "--dump" && i + 1 < argc)
+        {
+            //comma separated frame numbers
+            std::stringstream list(argv[++i]);
+            std::string frame;
+            while (valid && std::getline(list, frame, ','))
+            {
+                try
+                {
+                    dumpFrames.push_back(static_cast<unsigned int>(std::stoul(frame)));
+                }
+                catch (const std::exception&)
+                {
+                    valid = false;
+                }
+            }
+        }
+        else if (arg == "--merged-deferred") mergedDeferred = true;
+        else if (arg == "--no-shader-variants") shaderVariants = false;
+        else if (arg == "--msaa") valid = readNumber(i, msaaSamples) && msaaSamples > 0 && msaaSamples <= 64 && (msaaSamples & (msaaSamples - 1)) == 0;
+        else if (arg == "--no-edge-lighting") msaaEdgeLighting = false;
+        else if (arg == "--taa") temporalAA = true;
+        else if (arg == "--shadow-manual") shadowHardwareCompare = false;
+        else if (arg == "--shadow-taps") valid = readNumber(i, shadowTaps) && shadowTaps > 0 && shadowTaps <= 32;
+        else if (arg == "--shadow-moments") shadowMoments = true;
+        else if (arg == "--shadow-moment-size") valid = readNumber(i, shadowMomentSize) && shadowMomentSize >= 8 && shadowMomentSize <= 4096;
+        else if (arg == "--fixed-dt") valid = readFloat(i, fixedFrameDelta) && fixedFrameDelta >= 0.0f;
+        else if (arg == "--lod-error") valid = readFloat(i, lodPixelError) && lodPixelError >= 0.0f;
+        else if (arg == "--benchmark") benchmark = true;
+        else if (arg == "--bench-objects") valid = readNumber(i, benchmarkObjectCount);
+        else if (arg == "--bench-instances") valid = readNumber(i, modelInstanceCount) && modelInstanceCount > 0;
+        else if (arg == "--bench-lights") valid = readNumber(i, benchmarkLightCount);
+        else if (arg == "--bench-mesh") valid = readString(i, benchmarkMesh) && (benchmarkMesh == "cube" || benchmarkMesh == "model" || benchmarkMesh == "instance");
+        else if (arg == "--bench-seed") valid = readNumber(i, benchmarkSeed);
+        else if (arg == "--bench-warmup") valid = readNumber(i, benchmarkWarmupFrames);
+        else if (arg == "--bench-frames") valid = readNumber(i, benchmarkFrameCount) && benchmarkFrameCount > 0;
+        else if (arg == "--bench-camera") valid = readString(i, benchmarkCameraPath);
+        else if (arg == "--bench-output") valid = readString(i, benchmarkOutput);
+        else if (arg == "--record-input") valid = readString(i, recordInputFile);
+        else if (arg == "--replay-input") valid = readString(i, replayInputFile);
+        else valid = false;
+
+        if (!valid)
+        {
+            std::cerr << "invalid argument : " << arg << std::endl;
+            std::cerr << "usage : [--headless] [--frames N] [--width W] [--height H] [--offscreen-images N] [--dump 1,2,3] [--dump-dir path] [--fixed-dt sec]" << std::endl;
+            std::cerr << "        [--msaa 1|2|4|8|16|32|64] [--no-edge-lighting] [--taa] [--merged-deferred] [--shadow-manual] [--shadow-taps 1~32]" << std::endl;
+            std::cerr << "        [--shadow-moments] [--shadow-moment-size 8~4096] [--no-shader-variants] [--lod-error px]" << std::endl;
+            std::cerr << "        [--benchmark] [--bench-objects N] [--bench-instances N] [--bench-lights N] [--bench-mesh cube|model|instance] [--bench-seed N]" << std::endl;
+            std::cerr << "        [--bench-warmup N] [--bench-frames N] [--bench-camera path] [--bench-output file] [--record-input file] [--replay-input file]" << std::endl;
+            return false;
+        }
+    }
+
+    //merged renderpass lights straight into the swapchain, there is no scene color to accumulate
+    if (temporalAA && mergedDeferred)
+    {
+        std::cerr << "--taa can not be used with --merged-deferred" << std::endl;
+        return false;
+    }
+
+    if (benchmark)
+    {
+        //shader side light array is MAX_LIGHT(8) long
+        if (benchmarkLightCount == 0 || benchmarkLightCount > 8)
+        {
+            std::cerr << "benchmark light count has to be 1 ~ 8" << std::endl;
+            return false;
+        }
+
+        //generated objects and the floor
+        maxObjectCount = std::max(maxObjectCount, benchmarkObjectCount + 1);
+
+        //same simulation on every machine, the timing is what differs
+        if (fixedFrameDelta == 0.0f) fixedFrameDelta = 1.0f / 60.0f;
+
+        //headless exits on its own frame count, leave room for the last results to be read back
+        headlessFrameCount = std::max(headlessFrameCount, benchmarkWarmupFrames + benchmarkFrameCount + 1);
+    }
+
+    if (!recordInputFile.empty() && !replayInputFile.empty())
+    {
+        std::cerr << "input can not be recorded and replayed at the same time" << std::endl;
+        return false;
+    }
+
+    //a replay is only the same path if every frame advances the same time as when it was recorded
+    if ((!recordInputFile.empty() || !replayInputFile.empty()) && fixedFrameDelta == 0.0f) fixedFrameDelta = 1.0f / 60.0f;
+
+    if (windowWidth == 0 || windowHeight == 0)
+    {
+        std::cerr << "invalid resolution" << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -3,12 +3,87 @@
 //3rd party library
 #include <vulkan/vulkan.h>
 
+//standard library
+#include <string>
+#include <vector>
+
 namespace Settings
 {
 	extern unsigned int windowWidth;
 	extern unsigned int windowHeight;
 
 	extern unsigned int shadowmapSize;
+	//shadow lookups with a compare sampler and a rotated poisson disk instead of 20 manual compares
+	extern bool shadowHardwareCompare;
+	//poisson taps per light with shadowHardwareCompare, 1 ~ 32
+	extern unsigned int shadowTaps;
+	//light depth is rendered at shadowMomentSize and filtered into mipmapped variance moments, can be switched at runtime
+	extern bool shadowMoments;
+	//at least 8, one compute group
+	extern unsigned int shadowMomentSize;
+
+	//requested gbuffer samples, power of two, lowered to what the device supports
+	extern unsigned int msaaSamples;
+	//light plain pixels once and only edge pixels per sample straight from the msaa gbuffer instead of lighting the resolve
+	//ignored when the gbuffer has a single sample or with mergedDeferred
+	extern bool msaaEdgeLighting;
+
+	//single sample gbuffer with jittered camera and history resolve instead of msaa, can be switched at runtime
+	extern bool temporalAA;
+
+	//gbuffer and lighting as two subpasses of one renderpass, the gbuffer never leaves tile memory on tilers
+	extern bool mergedDeferred;
+
+	//lighting debug views and shadow filters are specialization constants, changing them compiles a new lighting pipeline
+	//false keeps one pipeline that branches on the gui setting
+	extern bool shaderVariants;
+
+	//0 -> uncapped
+	extern unsigned int targetFrameRate;
+	//cap while no window has focus
+	extern unsigned int idleFrameRate;
+	extern bool idleWhenUnfocused;
+	//Hz of System::fixedupdate
+	extern unsigned int fixedUpdateRate;
+	//simulated second per frame regardless of the real frame time, 0 -> real time
+	extern float fixedFrameDelta;
+
+	//per object uniform slots
+	extern unsigned int maxObjectCount;
+	//bunny copies drawn by DRAWTARGET_MODEL_INSTANCE
+	extern unsigned int modelInstanceCount;
+	//screen space error in pixels a model detail level may show in its view, 0 -> always the full mesh
+	extern float lodPixelError;
+
+	//no window/surface/swapchain, post pass renders to an offscreen image ring
+	extern bool headless;
+	//frames rendered before exit in headless mode
+	extern unsigned int headlessFrameCount;
+	extern unsigned int offscreenImageCount;
+	//frame numbers written as png in headless mode
+	extern std::vector<unsigned int> dumpFrames;
+	extern std::string dumpDirectory;
+
+	//generated scene, scripted camera and a timing summary written on exit
+	extern bool benchmark;
+	extern unsigned int benchmarkObjectCount;
+	extern unsigned int benchmarkLightCount;
+	//cube, model or instance
+	extern std::string benchmarkMesh;
+	extern unsigned int benchmarkSeed;
+	//frames rendered before timing starts, pipelines and caches settle here
+	extern unsigned int benchmarkWarmupFrames;
+	extern unsigned int benchmarkFrameCount;
+	//one control point per line "px py pz tx ty tz", empty -> orbit around the scene
+	extern std::string benchmarkCameraPath;
+	extern std::string benchmarkOutput;
+
+	//per frame input, a replay drives the camera instead of the camera path
+	extern std::string recordInputFile;
+	extern std::string replayInputFile;
 
 	float GetAspectRatio();
+
+	//false on unknown or malformed argument
+	bool ParseCommandLine(int argc, char** argv);
 };